@@ -0,0 +1,156 @@
+#include "alert_manager.h"
+
+// Sorted by priority: severity descending, then oldest first
+static Alert alerts[ALERT_CAPACITY];
+static int alert_count = 0;
+static int visible_count = 0; // unacknowledged alerts
+static int page = 0;
+static unsigned long page_shown_at = 0;
+
+static_assert(sizeof(alerts) + sizeof(alert_count) + sizeof(visible_count) + sizeof(page) + sizeof(page_shown_at) ==
+                  ALERT_STATIC_BYTES,
+              "ALERT_STATIC_BYTES must count every static above");
+
+static bool higher_priority(const Alert& a, const Alert& b) {
+    if (a.severity != b.severity) return a.severity > b.severity;
+    return (long)(b.raised_at - a.raised_at) > 0;
+}
+
+static int find_index(const char* source) {
+    for (int i = 0; i < alert_count; i++) {
+        if (alerts[i].source == source || strcmp(alerts[i].source, source) == 0) return i;
+    }
+    return -1;
+}
+
+static void recount_visible() {
+    visible_count = 0;
+    for (int i = 0; i < alert_count; i++) {
+        if (!alerts[i].acknowledged) visible_count++;
+    }
+    if (page >= alert_page_count()) page = 0;
+}
+
+// Move the entry at `i` to its sorted position
+static void reposition(int i) {
+    Alert moving = alerts[i];
+    while (i > 0 && higher_priority(moving, alerts[i - 1])) {
+        alerts[i] = alerts[i - 1];
+        i--;
+    }
+    while (i < alert_count - 1 && higher_priority(alerts[i + 1], moving)) {
+        alerts[i] = alerts[i + 1];
+        i++;
+    }
+    alerts[i] = moving;
+}
+
+bool alert_raise(const char* source, const char* message, AlertSeverity severity) {
+    int i = find_index(source);
+    if (i >= 0) {
+        Alert& a = alerts[i];
+        bool escalated = severity > a.severity;
+        AlertText text(message);
+        bool changed = !a.message.equals(text.c_str()) || severity != a.severity;
+        a.message = text;
+        a.severity = severity;
+        if (escalated && a.acknowledged) {
+            a.acknowledged = false;
+            changed = true;
+        }
+        bool visible = !a.acknowledged;
+        reposition(i);
+        recount_visible();
+        return changed && visible;
+    }
+
+    if (alert_count == ALERT_CAPACITY) {
+        // Evict the lowest-priority alert if the new one outranks it
+        if (severity <= alerts[alert_count - 1].severity) return false;
+        alert_count--;
+    }
+    Alert& a = alerts[alert_count++];
+    a.source = source;
+    a.message.assign(message);
+    a.severity = severity;
+    a.raised_at = millis();
+    a.acknowledged = false;
+    reposition(alert_count - 1);
+    recount_visible();
+    return true;
+}
+
+bool alert_clear(const char* source) {
+    int i = find_index(source);
+    if (i < 0) return false;
+    bool was_visible = !alerts[i].acknowledged;
+    for (; i < alert_count - 1; i++) {
+        alerts[i] = alerts[i + 1];
+    }
+    alert_count--;
+    recount_visible();
+    return was_visible;
+}
+
+bool alert_acknowledge_all() {
+    bool changed = visible_count > 0;
+    for (int i = 0; i < alert_count; i++) {
+        alerts[i].acknowledged = true;
+    }
+    recount_visible();
+    return changed;
+}
+
+bool alert_rotate(unsigned long now) {
+    int pages = alert_page_count();
+    if (pages <= 1 || now - page_shown_at < ALERT_ROTATE_MS) return false;
+    page = (page + 1) % pages;
+    page_shown_at = now;
+    return true;
+}
+
+bool alert_any_visible() {
+    return visible_count > 0;
+}
+
+bool alert_any_critical_visible() {
+    for (int i = 0; i < alert_count && alerts[i].severity == ALERT_CRITICAL; i++) {
+        if (!alerts[i].acknowledged) return true;
+    }
+    return false;
+}
+
+int alert_visible_count() {
+    return visible_count;
+}
+
+int alert_active_count() {
+    return alert_count;
+}
+
+const Alert* alert_find(const char* source) {
+    int i = find_index(source);
+    return i >= 0 ? &alerts[i] : nullptr;
+}
+
+int alert_page(const Alert* out[ALERT_STACK_LINES]) {
+    int skip = page * ALERT_STACK_LINES;
+    int n = 0;
+    for (int i = 0; i < alert_count && n < ALERT_STACK_LINES; i++) {
+        if (alerts[i].acknowledged) continue;
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        out[n++] = &alerts[i];
+    }
+    return n;
+}
+
+int alert_page_index() {
+    return page;
+}
+
+int alert_page_count() {
+    return (visible_count + ALERT_STACK_LINES - 1) / ALERT_STACK_LINES;
+}
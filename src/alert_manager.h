@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include "fixed_string.h"
+
+// ======= Alert Manager =======
+// Keeps every active alert in a fixed-capacity queue ordered by severity and
+// age. The screen shows up to ALERT_STACK_LINES alerts at a time and rotates
+// through pages when more are active. Mutators report whether the visible
+// set changed so callers redraw only when needed.
+
+enum AlertSeverity : uint8_t {
+    ALERT_INFO,
+    ALERT_WARNING,
+    ALERT_CRITICAL
+};
+
+const int ALERT_CAPACITY = 32;             // Concurrent alerts
+const int ALERT_MESSAGE_MAX = 31;          // Characters, longer messages are truncated
+const int ALERT_STACK_LINES = 2;           // Alerts shown per page
+const unsigned long ALERT_ROTATE_MS = 3000; // Page rotation period
+
+typedef FixedString<ALERT_MESSAGE_MAX> AlertText;
+
+struct Alert {
+    const char* source;      // Identifies the sensor, e.g. its status topic
+    AlertText message;
+    AlertSeverity severity;
+    unsigned long raised_at;
+    bool acknowledged;
+};
+
+// The alert table, the counts and the page rotation
+const size_t ALERT_STATIC_BYTES = sizeof(Alert) * ALERT_CAPACITY + 3 * sizeof(int) + sizeof(unsigned long);
+
+// Raise or update the alert for `source`. Returns true if the visible set changed.
+bool alert_raise(const char* source, const char* message, AlertSeverity severity);
+
+// Clear the alert for `source`. Returns true if the visible set changed.
+bool alert_clear(const char* source);
+
+// Hide all current alerts until they are raised again with a higher severity
+bool alert_acknowledge_all();
+
+// Advance the page rotation. Returns true if a different page is now visible.
+bool alert_rotate(unsigned long now);
+
+bool alert_any_visible();
+bool alert_any_critical_visible();
+int alert_visible_count();
+int alert_active_count();
+const Alert* alert_find(const char* source);
+
+// Visible alerts on the current page, highest priority first
+int alert_page(const Alert* out[ALERT_STACK_LINES]);
+int alert_page_index();
+int alert_page_count();
@@ -0,0 +1,157 @@
+#include "broker_pool.h"
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const BrokerConfig* broker_table = nullptr;
+static int broker_count = 0;
+static BrokerStatus status[BROKER_POOL_MAX] = {};
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t probe_task = nullptr;
+
+// Failback hysteresis, only touched from loop()
+static int failback_candidate = -1;
+static unsigned long failback_since = 0;
+
+static_assert(sizeof(broker_table) + sizeof(broker_count) + sizeof(status) + sizeof(status_lock) +
+                      sizeof(probe_task) + sizeof(failback_candidate) + sizeof(failback_since) ==
+                  BROKER_POOL_STATIC_BYTES,
+              "BROKER_POOL_STATIC_BYTES must count every static above");
+
+// Unknown RTTs sort after every measured one
+static uint32_t rtt_rank(const BrokerStatus& s) {
+    return s.rtt_us ? s.rtt_us : UINT32_MAX;
+}
+
+// ======= Probe Task =======
+static void record_probe(int index, bool ok, uint32_t rtt_us) {
+    portENTER_CRITICAL(&status_lock);
+    BrokerStatus& s = status[index];
+    s.probes++;
+    if (ok) {
+        // EWMA with 1/8 weight, seeded by the first sample
+        s.rtt_us = s.rtt_us ? s.rtt_us - s.rtt_us / 8 + rtt_us / 8 : rtt_us;
+        s.failures = 0;
+        s.healthy = true;
+    } else {
+        if (s.failures < 255) s.failures++;
+        if (s.failures >= BROKER_UNHEALTHY_PROBES) s.healthy = false;
+    }
+    portEXIT_CRITICAL(&status_lock);
+}
+
+static void probe_brokers(void*) {
+    WiFiClient probe;
+    int next = 0;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(BROKER_PROBE_INTERVAL / broker_count));
+        if (WiFi.status() != WL_CONNECTED) continue;
+
+        const BrokerConfig& broker = broker_table[next];
+        uint32_t start = micros();
+        bool ok = probe.connect(broker.host, broker.port, BROKER_PROBE_TIMEOUT);
+        uint32_t rtt_us = micros() - start;
+        probe.stop();
+        record_probe(next, ok, rtt_us);
+        next = (next + 1) % broker_count;
+    }
+}
+
+void broker_pool_begin(const BrokerConfig* brokers, int count) {
+    broker_table = brokers;
+    broker_count = min(count, BROKER_POOL_MAX);
+    for (int i = 0; i < broker_count; i++) {
+        status[i].healthy = true;
+    }
+    if (broker_count > 1 && !probe_task) {
+        // Priority 1 on core 0, next to the log drain, so a slow connect never stalls loop()
+        xTaskCreatePinnedToCore(probe_brokers, "broker_probe", 3072, nullptr, 1, &probe_task, 0);
+    }
+}
+
+// ======= Selection =======
+int broker_pool_select() {
+    int best = 0;
+    portENTER_CRITICAL(&status_lock);
+    for (int i = 1; i < broker_count; i++) {
+        const BrokerStatus& s = status[i];
+        const BrokerStatus& b = status[best];
+        if (s.healthy != b.healthy) {
+            if (s.healthy) best = i;
+        } else if (s.healthy ? rtt_rank(s) < rtt_rank(b) : s.failures < b.failures) {
+            best = i;
+        }
+    }
+    portEXIT_CRITICAL(&status_lock);
+    return best;
+}
+
+void broker_pool_report(int index, bool ok) {
+    if (index < 0 || index >= broker_count) return;
+    portENTER_CRITICAL(&status_lock);
+    BrokerStatus& s = status[index];
+    if (ok) {
+        s.failures = 0;
+        s.healthy = true;
+    } else {
+        if (s.failures < 255) s.failures++;
+        s.healthy = false;
+    }
+    portEXIT_CRITICAL(&status_lock);
+    failback_candidate = -1;
+}
+
+int broker_pool_failback(int current, unsigned long now) {
+    if (current < 0 || current >= broker_count) return -1;
+
+    int best = broker_pool_select();
+    bool clearly_better = false;
+    if (best != current) {
+        portENTER_CRITICAL(&status_lock);
+        uint32_t current_rtt = status[current].rtt_us;
+        uint32_t best_rtt = status[best].rtt_us;
+        bool best_healthy = status[best].healthy;
+        portEXIT_CRITICAL(&status_lock);
+        uint32_t margin = max(BROKER_FAILBACK_MARGIN_US, current_rtt / 100 * BROKER_FAILBACK_MARGIN_PCT);
+        clearly_better = best_healthy && best_rtt && current_rtt && best_rtt + margin < current_rtt;
+    }
+
+    if (!clearly_better) {
+        failback_candidate = -1;
+        return -1;
+    }
+    if (best != failback_candidate) {
+        failback_candidate = best;
+        failback_since = now;
+        return -1;
+    }
+    if (now - failback_since < BROKER_FAILBACK_HOLD) return -1;
+    failback_candidate = -1;
+    return best;
+}
+
+// ======= Status =======
+int broker_pool_count() {
+    return broker_count;
+}
+
+const BrokerConfig& broker_pool_config(int index) {
+    return broker_table[index];
+}
+
+BrokerStatus broker_pool_status(int index) {
+    portENTER_CRITICAL(&status_lock);
+    BrokerStatus copy = status[index];
+    portEXIT_CRITICAL(&status_lock);
+    return copy;
+}
+
+void broker_pool_print(Print& out, int current) {
+    for (int i = 0; i < broker_count; i++) {
+        BrokerStatus s = broker_pool_status(i);
+        out.printf("%c %s:%u rtt=%luus probes=%lu failures=%u %s\n",
+                   i == current ? '*' : ' ', broker_table[i].host, broker_table[i].port,
+                   (unsigned long)s.rtt_us, (unsigned long)s.probes, s.failures,
+                   s.healthy ? "healthy" : "down");
+    }
+}
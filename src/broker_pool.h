@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ======= Broker Pool =======
+// Keeps the panel on the lowest-latency healthy MQTT broker. A probe task on
+// core 0 TCP-connects to each configured broker in turn and keeps a smoothed
+// connect RTT. reconnect_mqtt() asks the pool which broker to use, and loop()
+// asks whether a better broker has stayed clearly better for long enough to
+// be worth moving back to.
+
+const int BROKER_POOL_MAX = 4;
+const unsigned long BROKER_PROBE_INTERVAL = 5000;  // Every broker is probed once per interval
+const unsigned long BROKER_PROBE_TIMEOUT = 1000;   // TCP connect timeout per probe
+const uint8_t BROKER_UNHEALTHY_PROBES = 2;         // Consecutive failed probes before a broker is skipped
+const unsigned long BROKER_FAILBACK_HOLD = 60000;  // A better broker must stay better this long
+const uint32_t BROKER_FAILBACK_MARGIN_US = 2000;   // and beat the current RTT by this much
+const uint32_t BROKER_FAILBACK_MARGIN_PCT = 25;    // or this fraction of it, whichever is larger
+
+struct BrokerConfig {
+    const char* host;
+    uint16_t port;
+};
+
+struct BrokerStatus {
+    uint32_t rtt_us;    // Smoothed TCP connect time, 0 until the first successful probe
+    uint32_t probes;
+    uint8_t failures;   // Consecutive failed probes or MQTT connects
+    bool healthy;
+};
+
+// The status table, its lock, the probe task and the failback hysteresis in broker_pool.cpp
+const size_t BROKER_POOL_STATIC_BYTES = BROKER_POOL_MAX * sizeof(BrokerStatus) + sizeof(const BrokerConfig*) +
+                                        2 * sizeof(int) + sizeof(portMUX_TYPE) + sizeof(TaskHandle_t) +
+                                        sizeof(unsigned long);
+
+// Start probing `brokers`, which must outlive the pool. A single broker is
+// not probed; there is nothing to choose between.
+void broker_pool_begin(const BrokerConfig* brokers, int count);
+
+// Lowest-RTT healthy broker, or the one with the fewest failures if none is healthy
+int broker_pool_select();
+
+// Record the outcome of an MQTT connect, or a lost connection (ok = false).
+// A failure marks the broker unhealthy until a probe succeeds again.
+void broker_pool_report(int index, bool ok);
+
+// Broker to fail back to while connected to `current`, or -1 to stay
+int broker_pool_failback(int current, unsigned long now);
+
+int broker_pool_count();
+const BrokerConfig& broker_pool_config(int index);
+BrokerStatus broker_pool_status(int index);
+
+// Print one line per broker, marking `current`
+void broker_pool_print(Print& out, int current);
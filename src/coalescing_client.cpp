@@ -0,0 +1,83 @@
+#include "coalescing_client.h"
+
+bool CoalescingClient::send_buffered() {
+    if (buffered == 0) return true;
+    size_t sent = inner.write(buffer, buffered);
+    counters.sends++;
+    counters.bytes += sent;
+    bool ok = sent == buffered;
+    buffered = 0;
+    return ok;
+}
+
+// ======= Client Interface =======
+int CoalescingClient::connect(IPAddress ip, uint16_t port) {
+    buffered = 0;
+    return inner.connect(ip, port);
+}
+
+int CoalescingClient::connect(const char* host, uint16_t port) {
+    buffered = 0;
+    return inner.connect(host, port);
+}
+
+size_t CoalescingClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t CoalescingClient::write(const uint8_t* buf, size_t size) {
+    counters.writes++;
+    if (buffered > 0 && (buffered + size > COALESCE_BUFFER_SIZE ||
+                         micros() - first_write_us >= COALESCE_MAX_DELAY_US)) {
+        if (!send_buffered()) return 0;
+    }
+    if (size > COALESCE_BUFFER_SIZE) {
+        // Larger than the buffer, e.g. a streamed log chunk; pass it through
+        size_t sent = inner.write(buf, size);
+        counters.sends++;
+        counters.bytes += sent;
+        return sent;
+    }
+    if (buffered == 0) first_write_us = micros();
+    memcpy(buffer + buffered, buf, size);
+    buffered += size;
+    return size;
+}
+
+int CoalescingClient::available() {
+    // A reader may be waiting for the reply to what is still buffered
+    send_buffered();
+    return inner.available();
+}
+
+int CoalescingClient::read() {
+    send_buffered();
+    return inner.read();
+}
+
+int CoalescingClient::read(uint8_t* buf, size_t size) {
+    send_buffered();
+    return inner.read(buf, size);
+}
+
+int CoalescingClient::peek() {
+    send_buffered();
+    return inner.peek();
+}
+
+void CoalescingClient::flush() {
+    send_buffered();
+}
+
+void CoalescingClient::stop() {
+    buffered = 0;
+    inner.stop();
+}
+
+uint8_t CoalescingClient::connected() {
+    return inner.connected();
+}
+
+CoalescingClient::operator bool() {
+    return (bool)inner;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+
+// ======= Write Coalescing =======
+// Client wrapper that sits between MqttSession and the network client and
+// gathers the packets written during one loop() iteration into one send.
+// MqttSession writes each packet on its own, so power_off_all_devices()
+// would otherwise leave as one small TCP segment per device. Buffered bytes
+// go out when loop() calls flush(), before anything is read (CONNECT must
+// not sit in the buffer while waiting for CONNACK), when the buffer is full,
+// and on the next write once the oldest byte has waited
+// COALESCE_MAX_DELAY_US. The socket runs with TCP_NODELAY so a flush is one
+// segment on the wire without waiting for Nagle.
+
+const size_t COALESCE_BUFFER_SIZE = 512;
+const uint32_t COALESCE_MAX_DELAY_US = 2000;
+
+struct CoalesceStats {
+    uint32_t writes;  // write() calls from MqttSession
+    uint32_t sends;   // Writes handed to the network client
+    uint32_t bytes;
+};
+
+class CoalescingClient : public Client {
+public:
+    explicit CoalescingClient(Client& inner) : inner(inner) {}
+
+    const CoalesceStats& stats() const { return counters; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;  // Sends buffered bytes; never touches the receive side
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    bool send_buffered();
+
+    Client& inner;
+    uint8_t buffer[COALESCE_BUFFER_SIZE];
+    size_t buffered = 0;
+    uint32_t first_write_us = 0;
+    CoalesceStats counters = {0, 0, 0};
+};
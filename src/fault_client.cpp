@@ -0,0 +1,184 @@
+#include "fault_client.h"
+#include "mqtt_codec.h"
+
+// ======= Client Wrapper =======
+void FaultClient::set_fault(FaultMode new_mode, uint32_t new_param) {
+    mode = new_mode;
+    param = new_param;
+    if (mode == FAULT_BROKER_RESTART) {
+        stop();
+    }
+}
+
+int FaultClient::connect(IPAddress ip, uint16_t port) {
+    if (mode == FAULT_BROKER_RESTART) return 0;
+    packet_left = 0;
+    return inner.connect(ip, port);
+}
+
+int FaultClient::connect(const char* host, uint16_t port) {
+    if (mode == FAULT_BROKER_RESTART) return 0;
+    packet_left = 0;
+    return inner.connect(host, port);
+}
+
+// MqttSession starts every packet on a new write() and never puts two in
+// one, so the header is at the front of `buf`
+void FaultClient::start_packet(const uint8_t* buf, size_t size) {
+    MqttHeader header;
+    if (mqtt_parse_header(buf, size, &header) == MQTT_PARSE_OK) {
+        packet_left = header.header_len + header.remaining;
+    } else {
+        packet_left = size; // Not a packet start we can read; treat the write as one
+    }
+    dropping = drop_packet(buf[0]);
+}
+
+bool FaultClient::drop_packet(uint8_t first_byte) {
+    bool drop = false;
+    if (mode == FAULT_HALF_OPEN) {
+        drop = true;
+    } else if (mode == FAULT_PACKET_LOSS) {
+        drop = (uint32_t)random(100) < param;
+    }
+    if (drop && (first_byte >> 4) == MQTT_PKT_PUBLISH) {
+        dropped_publish_count++;
+    }
+    return drop;
+}
+
+size_t FaultClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t FaultClient::write(const uint8_t* buf, size_t size) {
+    if (mode == FAULT_LATENCY) {
+        delay(param);
+    }
+    size_t done = 0;
+    while (done < size) {
+        if (packet_left == 0) {
+            start_packet(buf + done, size - done);
+        }
+        size_t span = min(packet_left, size - done);
+        // Dropped bytes pretend to have gone out
+        if (!dropping && inner.write(buf + done, span) != span) {
+            packet_left = 0;
+            return done;
+        }
+        done += span;
+        packet_left -= span;
+    }
+    return size;
+}
+
+int FaultClient::available() {
+    return mode == FAULT_HALF_OPEN ? 0 : inner.available();
+}
+
+int FaultClient::read() {
+    return mode == FAULT_HALF_OPEN ? -1 : inner.read();
+}
+
+int FaultClient::read(uint8_t* buf, size_t size) {
+    return mode == FAULT_HALF_OPEN ? -1 : inner.read(buf, size);
+}
+
+int FaultClient::peek() {
+    return mode == FAULT_HALF_OPEN ? -1 : inner.peek();
+}
+
+void FaultClient::flush() {
+    inner.flush();
+}
+
+void FaultClient::stop() {
+    packet_left = 0;
+    inner.stop();
+}
+
+uint8_t FaultClient::connected() {
+    if (mode == FAULT_HALF_OPEN) return 1;
+    if (mode == FAULT_BROKER_RESTART) return 0;
+    return inner.connected();
+}
+
+FaultClient::operator bool() {
+    return connected();
+}
+
+// ======= Scenario Runner =======
+static const FaultScenario scenarios[] = {
+    {"latency_200ms",  FAULT_LATENCY,        200, 30000},
+    {"loss_30pct",     FAULT_PACKET_LOSS,    30,  30000},
+    {"half_open",      FAULT_HALF_OPEN,      0,   60000},
+    {"broker_restart", FAULT_BROKER_RESTART, 0,   10000}
+};
+static const int num_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+struct ScenarioRun {
+    const FaultScenario* scenario;
+    unsigned long start;
+    unsigned long detected_at;  // 0 until the client notices the fault
+    unsigned long recovered_at; // 0 until reconnected after the fault cleared
+    uint32_t dropped_at_start;
+    uint32_t commands;
+    uint32_t max_loop_us;
+    bool fault_cleared;
+};
+
+static ScenarioRun run = {nullptr, 0, 0, 0, 0, 0, 0, false};
+static int next_scenario = 0;
+
+static void print_results(FaultClient& client) {
+    unsigned long detect = run.detected_at ? run.detected_at - run.start : 0;
+    unsigned long recover = run.recovered_at ? run.recovered_at - run.start : 0;
+    Serial.printf("FAULT %s: detect_ms=%lu recover_ms=%lu commands=%lu lost=%lu max_stall_ms=%lu\n",
+                  run.scenario->name,
+                  detect,
+                  recover,
+                  (unsigned long)run.commands,
+                  (unsigned long)(client.dropped_publishes() - run.dropped_at_start),
+                  (unsigned long)(run.max_loop_us / 1000));
+}
+
+void fault_sim_start_next(FaultClient& client) {
+    if (run.scenario) {
+        Serial.println("FAULT scenario already running");
+        return;
+    }
+    const FaultScenario& sc = scenarios[next_scenario];
+    next_scenario = (next_scenario + 1) % num_scenarios;
+
+    run = {&sc, millis(), 0, 0, client.dropped_publishes(), 0, 0, false};
+    Serial.printf("FAULT start %s for %lu ms\n", sc.name, sc.duration_ms);
+    client.set_fault(sc.mode, sc.param);
+}
+
+void fault_sim_observe(FaultClient& client, bool mqtt_connected, uint32_t loop_us) {
+    if (!run.scenario) return;
+
+    unsigned long now = millis();
+    if (loop_us > run.max_loop_us) {
+        run.max_loop_us = loop_us;
+    }
+    if (!mqtt_connected && !run.detected_at) {
+        run.detected_at = now;
+    }
+    if (!run.fault_cleared && now - run.start >= run.scenario->duration_ms) {
+        client.set_fault(FAULT_NONE, 0);
+        run.fault_cleared = true;
+    }
+    if (run.fault_cleared && mqtt_connected) {
+        // Faults that were never detected count as recovered when cleared
+        run.recovered_at = now;
+        print_results(client);
+        run.scenario = nullptr;
+    }
+}
+
+void fault_sim_count_command() {
+    if (run.scenario) {
+        run.commands++;
+    }
+}
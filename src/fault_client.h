@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+
+// ======= Fault Injection =======
+// Client wrapper that sits between MqttSession and WiFiClient and injects
+// latency, packet loss, half-open connections and broker restarts. Enabled
+// with -DFAULT_INJECTION; scenarios are started over Serial and report
+// time-to-detect, time-to-recover, lost commands and the longest loop stall.
+// Loss is decided once per MQTT packet, so a publish written as a header
+// and then a streamed payload is dropped whole or not at all. The wrapper
+// itself is portable and is unit tested on the host (env:native).
+
+enum FaultMode {
+    FAULT_NONE,
+    FAULT_LATENCY,        // param: added milliseconds per write
+    FAULT_PACKET_LOSS,    // param: drop probability in percent
+    FAULT_HALF_OPEN,      // writes vanish, nothing is read, socket looks alive
+    FAULT_BROKER_RESTART  // connection dropped, connects refused while active
+};
+
+struct FaultScenario {
+    const char* name;
+    FaultMode mode;
+    uint32_t param;
+    unsigned long duration_ms;
+};
+
+class FaultClient : public Client {
+public:
+    explicit FaultClient(Client& inner) : inner(inner) {}
+
+    void set_fault(FaultMode mode, uint32_t param);
+    FaultMode fault() const { return mode; }
+    uint32_t dropped_publishes() const { return dropped_publish_count; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    void start_packet(const uint8_t* buf, size_t size);
+    bool drop_packet(uint8_t first_byte);
+
+    Client& inner;
+    FaultMode mode = FAULT_NONE;
+    uint32_t param = 0;
+    uint32_t dropped_publish_count = 0;
+    size_t packet_left = 0;  // Bytes of the current packet not yet written
+    bool dropping = false;   // Whether they go to the inner client or nowhere
+};
+
+// Start the next scripted scenario against `client`
+void fault_sim_start_next(FaultClient& client);
+
+// Call once per loop() with the MQTT connection state and loop duration.
+// Ends the active scenario and prints its results when done.
+void fault_sim_observe(FaultClient& client, bool mqtt_connected, uint32_t loop_us);
+
+// Count a command issued while a scenario is running
+void fault_sim_count_command();
@@ -0,0 +1,107 @@
+#pragma once
+#include <Arduino.h>
+#include <ctype.h>
+#include <strings.h>
+
+// ======= Fixed String =======
+// Inline, fixed-capacity string for UI text. Never allocates; anything past
+// Capacity characters is dropped and remembered in truncated().
+
+template <size_t Capacity>
+class FixedString {
+public:
+    FixedString() { clear(); }
+    FixedString(const char* s) { assign(s); }
+
+    void clear() {
+        buf[0] = '\0';
+        len = 0;
+        was_truncated = false;
+    }
+
+    FixedString& assign(const char* s) {
+        clear();
+        return append(s);
+    }
+
+    FixedString& assign(const char* s, size_t n) {
+        clear();
+        return append(s, n);
+    }
+
+    FixedString& append(const char* s) {
+        return append(s, strlen(s));
+    }
+
+    FixedString& append(const char* s, size_t n) {
+        size_t room = Capacity - len;
+        if (n > room) {
+            n = room;
+            was_truncated = true;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = '\0';
+        return *this;
+    }
+
+    FixedString& append(char c) {
+        return append(&c, 1);
+    }
+
+    // Replace the contents with printf-style output
+    FixedString& format(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        clear();
+        append_vformat(fmt, args);
+        va_end(args);
+        return *this;
+    }
+
+    FixedString& append_format(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        append_vformat(fmt, args);
+        va_end(args);
+        return *this;
+    }
+
+    // Strip leading and trailing whitespace in place
+    void trim() {
+        size_t start = 0;
+        while (start < len && isspace((unsigned char)buf[start])) start++;
+        size_t end = len;
+        while (end > start && isspace((unsigned char)buf[end - 1])) end--;
+        len = end - start;
+        memmove(buf, buf + start, len);
+        buf[len] = '\0';
+    }
+
+    bool equals(const char* s) const { return strcmp(buf, s) == 0; }
+    bool equals_ignore_case(const char* s) const { return strcasecmp(buf, s) == 0; }
+
+    const char* c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+    bool truncated() const { return was_truncated; }
+    static size_t capacity() { return Capacity; }
+
+private:
+    void append_vformat(const char* fmt, va_list args) {
+        int n = vsnprintf(buf + len, Capacity - len + 1, fmt, args);
+        if (n < 0) {
+            buf[len] = '\0';
+            return;
+        }
+        if ((size_t)n > Capacity - len) {
+            was_truncated = true;
+            n = Capacity - len;
+        }
+        len += n;
+    }
+
+    char buf[Capacity + 1];
+    size_t len;
+    bool was_truncated;
+};
@@ -0,0 +1,153 @@
+#include "heap_monitor.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static HeapSample last_sample = {0, 0, 0, 0};
+static unsigned long last_sample_time = 0;
+static bool sampled_once = false;
+
+static TaskHandle_t steady_task = nullptr;
+static unsigned long steady_since = 0;
+static uint32_t steady_allocations = 0;
+static uint32_t checked_allocations = 0;
+static uint8_t allowed_depth = 0; // Open HeapAllocAllowed scopes on the loop task
+
+// ======= Allocation Tracking =======
+#ifdef HEAP_ALLOC_CHECK
+static HeapCallSite call_sites[HEAP_CALL_SITES] = {};
+
+static void IRAM_ATTR track_allocation(void* caller, size_t bytes) {
+    if (!steady_task || allowed_depth || xTaskGetCurrentTaskHandle() != steady_task) return;
+    steady_allocations++;
+    for (int i = 0; i < HEAP_CALL_SITES; i++) {
+        HeapCallSite& site = call_sites[i];
+        if (site.caller == 0) site.caller = (uintptr_t)caller;
+        if (site.caller == (uintptr_t)caller) {
+            site.allocations++;
+            site.bytes += bytes;
+            return;
+        }
+    }
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* IRAM_ATTR __wrap_malloc(size_t size) {
+    track_allocation(__builtin_return_address(0), size);
+    return __real_malloc(size);
+}
+
+void* IRAM_ATTR __wrap_calloc(size_t count, size_t size) {
+    track_allocation(__builtin_return_address(0), count * size);
+    return __real_calloc(count, size);
+}
+
+void* IRAM_ATTR __wrap_realloc(void* ptr, size_t size) {
+    track_allocation(__builtin_return_address(0), size);
+    return __real_realloc(ptr, size);
+}
+}
+#endif
+
+static_assert(sizeof(last_sample) + sizeof(last_sample_time) + sizeof(sampled_once) + sizeof(steady_task) +
+                      sizeof(steady_since) + sizeof(steady_allocations) + sizeof(checked_allocations) +
+                      sizeof(allowed_depth)
+#ifdef HEAP_ALLOC_CHECK
+                      + sizeof(call_sites)
+#endif
+                  == HEAP_MONITOR_STATIC_BYTES,
+              "HEAP_MONITOR_STATIC_BYTES must count every static in this file");
+
+void heap_monitor_mark_steady_state() {
+    steady_since = millis();
+    steady_task = xTaskGetCurrentTaskHandle();
+}
+
+uint32_t heap_steady_state_allocations() {
+    return steady_allocations;
+}
+
+bool heap_monitor_check() {
+    if (steady_allocations == checked_allocations) return true;
+    checked_allocations = steady_allocations;
+    return millis() - steady_since < HEAP_ALLOC_WARMUP_MS;
+}
+
+HeapAllocAllowed::HeapAllocAllowed() {
+    allowed_depth++;
+}
+
+HeapAllocAllowed::~HeapAllocAllowed() {
+    allowed_depth--;
+}
+
+// ======= Sampling =======
+bool heap_monitor_poll() {
+    unsigned long now = millis();
+    if (sampled_once && now - last_sample_time < HEAP_SAMPLE_INTERVAL) {
+        return false;
+    }
+    last_sample_time = now;
+    sampled_once = true;
+
+    last_sample.free_heap = ESP.getFreeHeap();
+    last_sample.largest_block = ESP.getMaxAllocHeap();
+    last_sample.min_free_heap = ESP.getMinFreeHeap();
+    last_sample.fragmentation_pct = last_sample.free_heap == 0 ? 0 :
+        (uint8_t)(100 - (uint64_t)last_sample.largest_block * 100 / last_sample.free_heap);
+    return true;
+}
+
+const HeapSample& heap_monitor_last() {
+    return last_sample;
+}
+
+size_t heap_monitor_format(char* buf, size_t len) {
+    int n = snprintf(buf, len,
+                     "{\"free\":%lu,\"largest\":%lu,\"min_free\":%lu,\"frag\":%u",
+                     (unsigned long)last_sample.free_heap,
+                     (unsigned long)last_sample.largest_block,
+                     (unsigned long)last_sample.min_free_heap,
+                     (unsigned)last_sample.fragmentation_pct);
+#ifdef HEAP_ALLOC_CHECK
+    if (n > 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - n, ",\"loop_allocs\":%lu,\"sites\":{", (unsigned long)steady_allocations);
+    }
+    for (int i = 0; i < HEAP_CALL_SITES && call_sites[i].caller && n > 0 && (size_t)n < len; i++) {
+        n += snprintf(buf + n, len - n, "%s\"0x%08lx\":[%lu,%lu]",
+                      i ? "," : "", (unsigned long)call_sites[i].caller,
+                      (unsigned long)call_sites[i].allocations,
+                      (unsigned long)call_sites[i].bytes);
+    }
+    if (n > 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - n, "}");
+    }
+#endif
+    if (n > 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - n, "}");
+    }
+    if (n < 0) return 0;
+    return (size_t)n < len ? (size_t)n : len - 1;
+}
+
+void heap_monitor_print(Print& out) {
+    out.printf("Heap: free=%lu largest=%lu min_free=%lu frag=%u%%",
+               (unsigned long)last_sample.free_heap,
+               (unsigned long)last_sample.largest_block,
+               (unsigned long)last_sample.min_free_heap,
+               (unsigned)last_sample.fragmentation_pct);
+#ifdef HEAP_ALLOC_CHECK
+    out.printf(" loop_allocs=%lu\n", (unsigned long)steady_allocations);
+    for (int i = 0; i < HEAP_CALL_SITES && call_sites[i].caller; i++) {
+        out.printf("  caller 0x%08lx: %lu allocs, %lu bytes\n",
+                   (unsigned long)call_sites[i].caller,
+                   (unsigned long)call_sites[i].allocations,
+                   (unsigned long)call_sites[i].bytes);
+    }
+#else
+    out.printf("\n");
+#endif
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ======= Heap Monitor =======
+// Periodically samples free heap, largest free block and the minimum-ever
+// free heap so fragmentation can be correlated with message volume.
+//
+// Builds with HEAP_ALLOC_CHECK link malloc/calloc/realloc through wrappers
+// (see the m5stack-core2-alloc-check environment). After setup() the loop
+// task is expected to make no heap allocations; any that happen are counted
+// per caller address so the offending call site can be found with addr2line.
+// Once HEAP_ALLOC_WARMUP_MS has passed, heap_monitor_check() fails on the
+// first new allocation outside a HeapAllocAllowed scope.
+
+struct HeapSample {
+    uint32_t free_heap;
+    uint32_t largest_block;
+    uint32_t min_free_heap;
+    uint8_t fragmentation_pct; // 100 - largest_block * 100 / free_heap
+};
+
+struct HeapCallSite {
+    uintptr_t caller;  // return address of the allocating call
+    uint32_t allocations;
+    uint32_t bytes;
+};
+
+const unsigned long HEAP_SAMPLE_INTERVAL = 60000; // 1 minute
+const int HEAP_CALL_SITES = 8;                    // Distinct callers tracked
+const unsigned long HEAP_ALLOC_WARMUP_MS = 10000; // Allocations this soon after setup() are counted, not failed
+// The last sample, the steady-state bookkeeping, and the call sites where they are counted
+const size_t HEAP_MONITOR_STATIC_BYTES = sizeof(HeapSample) + 2 * sizeof(unsigned long) + sizeof(bool) +
+                                         sizeof(TaskHandle_t) + 2 * sizeof(uint32_t) + sizeof(uint8_t)
+#ifdef HEAP_ALLOC_CHECK
+                                         + sizeof(HeapCallSite) * HEAP_CALL_SITES
+#endif
+    ;
+
+// Call at the end of setup(); allocations on the calling task are tracked from here on
+void heap_monitor_mark_steady_state();
+
+// Allocations seen on the loop task since heap_monitor_mark_steady_state();
+// always 0 without HEAP_ALLOC_CHECK
+uint32_t heap_steady_state_allocations();
+
+// Returns false when the loop task allocated since the last call and warm-up
+// is over. Each allocation fails the check once.
+bool heap_monitor_check();
+
+// Marks code that is allowed to allocate, such as opening a socket or
+// applying an OTA update. Allocations inside the scope are not counted.
+struct HeapAllocAllowed {
+    HeapAllocAllowed();
+    ~HeapAllocAllowed();
+};
+
+// Take a sample if the interval elapsed; returns true when a new sample is ready.
+bool heap_monitor_poll();
+
+const HeapSample& heap_monitor_last();
+
+// Write the latest sample as compact JSON. The steady-state allocation
+// counters ("loop_allocs" and "sites") are only included in HEAP_ALLOC_CHECK
+// builds; elsewhere nothing counts them, and a zero would read as a result.
+size_t heap_monitor_format(char* buf, size_t len);
+void heap_monitor_print(Print& out);
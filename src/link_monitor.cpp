@@ -0,0 +1,119 @@
+#include "link_monitor.h"
+
+static uint32_t srtt_us = 0;
+static uint32_t rttvar_us = 0;
+static uint32_t probe_seq = 0;
+static bool outstanding = false;       // The latest probe has neither echoed nor timed out
+static unsigned long sent_at = 0;
+static unsigned long probe_timeout = 0; // Timeout the outstanding probe was sent with
+static unsigned long next_probe = 0;
+static uint8_t misses = 0;
+static int last_rssi = 0;
+static LinkStats stats = {};
+
+static_assert(sizeof(srtt_us) + sizeof(rttvar_us) + sizeof(probe_seq) + sizeof(outstanding) + sizeof(sent_at) +
+                      sizeof(probe_timeout) + sizeof(next_probe) + sizeof(misses) + sizeof(last_rssi) +
+                      sizeof(stats) == LINK_MONITOR_STATIC_BYTES,
+              "LINK_MONITOR_STATIC_BYTES must count every static above");
+
+static unsigned long current_timeout() {
+    unsigned long timeout = srtt_us ? (srtt_us + 4 * rttvar_us) / 1000 : LINK_TIMEOUT_INITIAL;
+    timeout = constrain(timeout, LINK_TIMEOUT_MIN, LINK_TIMEOUT_MAX);
+    // RSSI reads 0 while disconnected, so only a real weak reading counts
+    if (last_rssi != 0 && last_rssi < LINK_WEAK_RSSI) {
+        timeout = min(timeout * 2, LINK_TIMEOUT_MAX);
+    }
+    return timeout;
+}
+
+void link_monitor_set_rssi(int rssi) {
+    last_rssi = rssi;
+}
+
+void link_monitor_reset(unsigned long now) {
+    outstanding = false;
+    misses = 0;
+    next_probe = now; // First sample straight away
+}
+
+// ======= Probing =======
+LinkAction link_monitor_poll(unsigned long now, char* payload, size_t size, size_t* len) {
+    if (outstanding && now - sent_at >= probe_timeout) {
+        outstanding = false;
+        if (++misses >= LINK_DEAD_PROBES) {
+            misses = 0;
+            stats.dead++;
+            return LINK_DEAD;
+        }
+        next_probe = now; // Confirm a miss at once rather than a full interval later
+    }
+    if (outstanding || (long)(now - next_probe) < 0) return LINK_IDLE;
+
+    // The echo carries its own send time, so a late echo still gives a sample
+    probe_seq++;
+    *len = snprintf(payload, size, "%lu %lu", (unsigned long)probe_seq, (unsigned long)micros());
+    outstanding = true;
+    sent_at = now;
+    probe_timeout = current_timeout();
+    next_probe = now + LINK_PROBE_INTERVAL;
+    stats.probes++;
+    return LINK_SEND_PROBE;
+}
+
+void link_monitor_echo(const uint8_t* payload, size_t len) {
+    char text[24];
+    if (len >= sizeof(text)) return;
+    memcpy(text, payload, len);
+    text[len] = '\0';
+    char* end;
+    uint32_t seq = strtoul(text, &end, 10);
+    uint32_t sent_us = strtoul(end, nullptr, 10);
+    uint32_t rtt_us = micros() - sent_us;
+
+    // Smoothed RTT and mean deviation as in RFC 6298
+    if (srtt_us == 0) {
+        srtt_us = max(rtt_us, (uint32_t)1);
+        rttvar_us = rtt_us / 2;
+    } else {
+        uint32_t delta = rtt_us > srtt_us ? rtt_us - srtt_us : srtt_us - rtt_us;
+        rttvar_us = rttvar_us - rttvar_us / 4 + delta / 4;
+        srtt_us = srtt_us - srtt_us / 8 + rtt_us / 8;
+    }
+
+    // Any echo, even a late one, shows the connection is still alive
+    misses = 0;
+    stats.echoes++;
+    if (outstanding && seq == probe_seq) {
+        outstanding = false;
+    } else {
+        stats.late++;
+    }
+}
+
+// ======= Keepalive =======
+// The panel notices a dead broker within one interval plus two timeouts;
+// asking for a keepalive of about that long lets the broker drop a silent
+// panel on a similar scale
+uint16_t link_monitor_keepalive() {
+    unsigned long detect_ms = LINK_PROBE_INTERVAL + LINK_DEAD_PROBES * current_timeout();
+    return constrain((detect_ms + 999) / 1000, (unsigned long)LINK_KEEPALIVE_MIN,
+                     (unsigned long)LINK_KEEPALIVE_MAX);
+}
+
+// ======= Status =======
+LinkStats link_monitor_stats() {
+    LinkStats s = stats;
+    s.srtt_us = srtt_us;
+    s.rttvar_us = rttvar_us;
+    s.timeout_ms = current_timeout();
+    s.rssi = last_rssi;
+    return s;
+}
+
+void link_monitor_print(Print& out) {
+    LinkStats s = link_monitor_stats();
+    out.printf("Link: rtt=%luus var=%luus timeout=%lums keepalive=%us rssi=%d probes=%lu echoes=%lu late=%lu dead=%lu\n",
+               (unsigned long)s.srtt_us, (unsigned long)s.rttvar_us, (unsigned long)s.timeout_ms,
+               link_monitor_keepalive(), s.rssi, (unsigned long)s.probes, (unsigned long)s.echoes,
+               (unsigned long)s.late, (unsigned long)s.dead);
+}
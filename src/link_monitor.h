@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+// ======= Link Monitor =======
+// Measures broker RTT with a small publish to a per-panel loopback topic
+// and declares the connection dead when probes go unanswered. A half-open
+// connection then drops within seconds instead of waiting out 1.5x the
+// MQTT keepalive. The probe timeout follows the measured RTT the way TCP's
+// retransmission timeout does (smoothed RTT plus four deviations) and is
+// doubled on a weak signal, where retries at the WiFi layer stretch RTT.
+// The keepalive for the next connect is derived from the same numbers so
+// the broker gives up on the panel about as quickly as the panel gives up
+// on the broker.
+
+const unsigned long LINK_PROBE_INTERVAL = 5000;   // Between probes while healthy
+const unsigned long LINK_TIMEOUT_INITIAL = 3000;  // Until the first RTT sample
+const unsigned long LINK_TIMEOUT_MIN = 1000;      // Covers a loop() stalled by drawing
+const unsigned long LINK_TIMEOUT_MAX = 10000;
+const int LINK_WEAK_RSSI = -75;                   // dBm; below this the timeout is doubled
+const uint8_t LINK_DEAD_PROBES = 2;               // Consecutive misses before the link is dead
+const uint16_t LINK_KEEPALIVE_MIN = 5;            // Seconds
+const uint16_t LINK_KEEPALIVE_MAX = 60;
+
+enum LinkAction {
+    LINK_IDLE,
+    LINK_SEND_PROBE,  // Publish the payload from link_monitor_poll() on the loopback topic
+    LINK_DEAD         // Drop the connection and reconnect
+};
+
+struct LinkStats {
+    uint32_t srtt_us;     // Smoothed RTT, 0 until the first echo
+    uint32_t rttvar_us;
+    uint32_t timeout_ms;  // Current probe timeout
+    uint32_t probes;
+    uint32_t echoes;
+    uint32_t late;        // Echoes that arrived after their timeout
+    uint32_t dead;        // Connections declared dead
+    int rssi;
+};
+
+// The estimator, probe and RSSI state in link_monitor.cpp, object by object
+const size_t LINK_MONITOR_STATIC_BYTES = 3 * sizeof(uint32_t) + sizeof(bool) + 3 * sizeof(unsigned long) +
+                                         sizeof(uint8_t) + sizeof(int) + sizeof(LinkStats);
+
+// Start over on a new connection; RTT history is kept across reconnects
+void link_monitor_reset(unsigned long now);
+
+// Latest WiFi RSSI in dBm, sampled by the caller whenever it reads it anyway
+void link_monitor_set_rssi(int rssi);
+
+// Call from loop() while connected. On LINK_SEND_PROBE, `payload` holds
+// `*len` bytes to publish on the loopback topic.
+LinkAction link_monitor_poll(unsigned long now, char* payload, size_t size, size_t* len);
+
+// Feed a message received on the loopback topic
+void link_monitor_echo(const uint8_t* payload, size_t len);
+
+// Keepalive in seconds to request on the next connect
+uint16_t link_monitor_keepalive();
+
+LinkStats link_monitor_stats();
+void link_monitor_print(Print& out);
@@ -0,0 +1,105 @@
+#include "log.h"
+#include "log_shipper.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static char ring[LOG_BUFFER_SIZE];
+static size_t ring_head = 0; // next write position
+static size_t ring_tail = 0; // next byte to drain
+static size_t ring_used = 0;
+static LogStats stats = {0, 0, 0};
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drain_task = nullptr;
+
+static_assert(sizeof(ring) + sizeof(ring_head) + sizeof(ring_tail) + sizeof(ring_used) + sizeof(stats) +
+                      sizeof(ring_lock) + sizeof(drain_task) == LOG_STATIC_BYTES,
+              "LOG_STATIC_BYTES must count every static above");
+
+static const char level_tags[] = {'-', 'E', 'W', 'I', 'D'};
+
+// ======= Drain Task =======
+static void log_drain(void*) {
+    char chunk[64];
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        for (;;) {
+            size_t n = 0;
+            portENTER_CRITICAL(&ring_lock);
+            while (n < sizeof(chunk) && ring_used > 0) {
+                chunk[n++] = ring[ring_tail];
+                ring_tail = (ring_tail + 1) % LOG_BUFFER_SIZE;
+                ring_used--;
+            }
+            portEXIT_CRITICAL(&ring_lock);
+            if (n == 0) break;
+            Serial.write((const uint8_t*)chunk, n);
+        }
+    }
+}
+
+void log_begin() {
+    if (drain_task) return;
+    // Priority 1 on core 0 keeps UART writes away from loop() on core 1
+    xTaskCreatePinnedToCore(log_drain, "log_drain", 2048, nullptr, 1, &drain_task, 0);
+}
+
+// ======= Record Formatting =======
+void log_write(int level, const char* fmt, ...) {
+    char line[LOG_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "[%lu] %c ", millis(),
+                     level_tags[level >= 0 && level <= LOG_LEVEL_DEBUG ? level : 0]);
+    va_list args;
+    va_start(args, fmt);
+    int body = vsnprintf(line + n, sizeof(line) - n - 1, fmt, args);
+    va_end(args);
+    if (body < 0) body = 0;
+    n += min(body, (int)(sizeof(line) - n - 2));
+    line[n++] = '\n';
+
+    bool stored = false;
+    portENTER_CRITICAL(&ring_lock);
+    if (ring_used + n <= LOG_BUFFER_SIZE) {
+        for (int i = 0; i < n; i++) {
+            ring[ring_head] = line[i];
+            ring_head = (ring_head + 1) % LOG_BUFFER_SIZE;
+        }
+        ring_used += n;
+        if (ring_used > stats.high_water) stats.high_water = ring_used;
+        stats.records++;
+        stored = true;
+    } else {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&ring_lock);
+
+    log_ship_append(level, line, n);
+
+    if (stored && drain_task) {
+        xTaskNotifyGive(drain_task);
+    }
+}
+
+LogStats log_stats() {
+    portENTER_CRITICAL(&ring_lock);
+    LogStats copy = stats;
+    portEXIT_CRITICAL(&ring_lock);
+    return copy;
+}
+
+// ======= Print Adapter =======
+size_t LogPrint::write(uint8_t c) {
+    if (level > PANEL_LOG_LEVEL || c == '\r') return 1;
+    if (c == '\n') {
+        flush();
+    } else if (len < sizeof(line) - 1) {
+        line[len++] = c;
+    }
+    return 1;
+}
+
+void LogPrint::flush() {
+    if (len == 0) return;
+    line[len] = '\0';
+    len = 0;
+    log_write(level, "%s", line);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ======= Logging =======
+// Leveled logging with compile-time filtering. Records below PANEL_LOG_LEVEL
+// compile to nothing (their arguments are still type-checked); enabled
+// records are formatted into a RAM ring buffer and drained to Serial by a
+// low-priority task, so callers never wait on UART.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef PANEL_LOG_LEVEL
+#ifdef __PLATFORMIO_BUILD_DEBUG__
+#define PANEL_LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define PANEL_LOG_LEVEL LOG_LEVEL_INFO // Release builds drop debug records
+#endif
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096
+#endif
+
+const int LOG_LINE_MAX = 128; // Longer records are truncated
+
+struct LogStats {
+    uint32_t records;
+    uint32_t dropped;      // records rejected because the ring was full
+    uint32_t high_water;   // most bytes ever pending
+};
+
+// The ring with its positions, lock and drain task
+const size_t LOG_STATIC_BYTES = LOG_BUFFER_SIZE + 3 * sizeof(size_t) + sizeof(LogStats) + sizeof(portMUX_TYPE) +
+                                sizeof(TaskHandle_t);
+
+// Start the drain task. Records logged earlier are kept until it runs.
+void log_begin();
+
+void log_write(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+LogStats log_stats();
+
+// Print that logs each line it is given as one record at `level`, for the
+// reports that take a Print& (heap monitor, memory budget). Lines above
+// PANEL_LOG_LEVEL are dropped like the macros drop them.
+class LogPrint : public Print {
+public:
+    explicit LogPrint(int level) : level(level) {}
+    ~LogPrint() { flush(); }
+
+    size_t write(uint8_t c) override;
+    void flush() override; // Logs a partial line
+    using Print::write;
+
+private:
+    int level;
+    char line[LOG_LINE_MAX];
+    size_t len = 0;
+};
+
+#if PANEL_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do { if (0) log_write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#endif
+
+#if PANEL_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { if (0) log_write(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#endif
+
+#if PANEL_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { if (0) log_write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+
+#if PANEL_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if (0) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
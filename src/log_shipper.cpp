@@ -0,0 +1,173 @@
+#include "log.h"
+#include "log_shipper.h"
+#include <freertos/FreeRTOS.h>
+
+static char batch[2][LOG_SHIP_BUFFER];
+static size_t batch_len[2] = {0, 0};
+static int active = 0;             // batch receiving new records
+static bool outbox_pending = false; // the other batch awaits publishing
+static portMUX_TYPE ship_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t chunk[LOG_SHIP_CHUNK_MAX];
+static size_t chunk_len = 0;
+static bool chunk_ready = false;
+
+static LogShipStats stats = {0, 0, 0, 0};
+static uint32_t tokens = LOG_SHIP_BURST;
+static unsigned long last_refill = 0;
+static unsigned long last_flush = 0;
+
+// ======= Record Intake =======
+void log_ship_append(int level, const char* line, size_t len) {
+    if (level > LOG_SHIP_LEVEL || len > LOG_SHIP_BUFFER) return;
+
+    portENTER_CRITICAL(&ship_lock);
+    if (batch_len[active] + len > LOG_SHIP_BUFFER && !outbox_pending) {
+        // Rotate a full batch into the outbox
+        outbox_pending = true;
+        active ^= 1;
+        batch_len[active] = 0;
+    }
+    if (batch_len[active] + len <= LOG_SHIP_BUFFER) {
+        memcpy(batch[active] + batch_len[active], line, len);
+        batch_len[active] += len;
+    } else {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&ship_lock);
+}
+
+// ======= Compression =======
+#if LOG_SHIP_COMPRESS
+// LZSS: a flag byte precedes every 8 items, bit set = literal byte, bit clear =
+// 2-byte match (12-bit distance, 4-bit length - 3) within the batch.
+static const int LZ_MIN_MATCH = 3;
+static const int LZ_MAX_MATCH = 18;
+static const int LZ_WINDOW = 4096;
+static const int LZ_HASH_SIZE = LOG_SHIP_HASH_SIZE;
+static uint16_t lz_last[LZ_HASH_SIZE];
+
+static size_t lzss_compress(const uint8_t* src, size_t len, uint8_t* dst) {
+    memset(lz_last, 0xff, sizeof(lz_last));
+    size_t out = 0;
+    size_t flag_pos = 0;
+    int item = 8;
+    size_t i = 0;
+    while (i < len) {
+        if (item == 8) {
+            flag_pos = out++;
+            dst[flag_pos] = 0;
+            item = 0;
+        }
+        int best_len = 0;
+        size_t best_dist = 0;
+        if (i + LZ_MIN_MATCH <= len) {
+            uint32_t h = ((src[i] << 6) ^ (src[i + 1] << 3) ^ src[i + 2]) & (LZ_HASH_SIZE - 1);
+            uint16_t cand = lz_last[h];
+            lz_last[h] = (uint16_t)i;
+            if (cand != 0xffff && i - cand <= LZ_WINDOW) {
+                size_t limit = min((size_t)LZ_MAX_MATCH, len - i);
+                size_t n = 0;
+                while (n < limit && src[cand + n] == src[i + n]) n++;
+                if (n >= (size_t)LZ_MIN_MATCH) {
+                    best_len = (int)n;
+                    best_dist = i - cand;
+                }
+            }
+        }
+        if (best_len) {
+            uint16_t code = (uint16_t)(((best_dist - 1) << 4) | (best_len - LZ_MIN_MATCH));
+            dst[out++] = code >> 8;
+            dst[out++] = code & 0xff;
+            i += best_len;
+        } else {
+            dst[flag_pos] |= 1 << item;
+            dst[out++] = src[i++];
+        }
+        item++;
+    }
+    return out;
+}
+#endif
+
+static_assert(sizeof(batch) + sizeof(batch_len) + sizeof(active) + sizeof(outbox_pending) + sizeof(ship_lock) +
+                      sizeof(chunk) + sizeof(chunk_len) + sizeof(chunk_ready) + sizeof(stats) + sizeof(tokens) +
+                      sizeof(last_refill) + sizeof(last_flush)
+#if LOG_SHIP_COMPRESS
+                      + sizeof(lz_last)
+#endif
+                  == LOG_SHIP_STATIC_BYTES,
+              "LOG_SHIP_STATIC_BYTES must count every static in this file");
+
+// ======= Chunk Release =======
+bool log_ship_poll(unsigned long last_control_publish, const uint8_t** data, size_t* len) {
+    unsigned long now = millis();
+
+    // Refill the token bucket
+    uint32_t refill = (uint32_t)((uint64_t)(now - last_refill) * LOG_SHIP_RATE_BPS / 1000);
+    if (refill > 0) {
+        tokens = min(LOG_SHIP_BURST, tokens + refill);
+        last_refill = now;
+    }
+
+    if (!chunk_ready) {
+        portENTER_CRITICAL(&ship_lock);
+        if (!outbox_pending && batch_len[active] > 0 &&
+            now - last_flush >= LOG_SHIP_FLUSH_INTERVAL) {
+            // Flush interval expired, ship the partial batch
+            outbox_pending = true;
+            active ^= 1;
+            batch_len[active] = 0;
+        }
+        bool have_outbox = outbox_pending;
+        portEXIT_CRITICAL(&ship_lock);
+        if (!have_outbox) return false;
+
+        // The outbox is not touched by log_ship_append() until it is released
+        const uint8_t* raw = (const uint8_t*)batch[active ^ 1];
+        size_t raw_len = batch_len[active ^ 1];
+        size_t packed = 0;
+#if LOG_SHIP_COMPRESS
+        packed = lzss_compress(raw, raw_len, chunk + 1);
+#endif
+        if (packed > 0 && packed < raw_len) {
+            chunk[0] = 'Z';
+            chunk_len = 1 + packed;
+        } else {
+            chunk[0] = 'T';
+            memcpy(chunk + 1, raw, raw_len);
+            chunk_len = 1 + raw_len;
+        }
+        stats.raw_bytes += raw_len;
+        chunk_ready = true;
+    }
+
+    // Keep log traffic out of the way of commands
+    if (now - last_control_publish < LOG_SHIP_QUIET_MS) return false;
+    if (tokens < chunk_len && tokens < LOG_SHIP_BURST) return false;
+
+    *data = chunk;
+    *len = chunk_len;
+    return true;
+}
+
+void log_ship_done(bool published) {
+    if (!published || !chunk_ready) return;
+    tokens = tokens > chunk_len ? tokens - chunk_len : 0;
+    stats.chunks++;
+    stats.sent_bytes += chunk_len;
+    chunk_ready = false;
+    last_flush = millis();
+
+    portENTER_CRITICAL(&ship_lock);
+    batch_len[active ^ 1] = 0;
+    outbox_pending = false;
+    portEXIT_CRITICAL(&ship_lock);
+}
+
+LogShipStats log_ship_stats() {
+    portENTER_CRITICAL(&ship_lock);
+    LogShipStats copy = stats;
+    portEXIT_CRITICAL(&ship_lock);
+    return copy;
+}
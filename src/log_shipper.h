@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// ======= Log Shipping =======
+// Batches log records in RAM and hands them out as chunks for the per-panel
+// log topic. A chunk is released when the batch is mostly full or the flush
+// interval expires, subject to a byte-rate token bucket and a quiet window
+// after control traffic. Chunks start with 'T' (plain text) or 'Z' (LZSS,
+// decode with tools/log_unpack.py).
+
+#ifndef LOG_SHIP_LEVEL
+#define LOG_SHIP_LEVEL LOG_LEVEL_INFO // Most verbose level shipped
+#endif
+
+#ifndef LOG_SHIP_COMPRESS
+#define LOG_SHIP_COMPRESS 1
+#endif
+
+const size_t LOG_SHIP_BUFFER = 1536;                // Bytes per batch
+const unsigned long LOG_SHIP_FLUSH_INTERVAL = 30000; // Ship partial batches after 30 s
+const uint32_t LOG_SHIP_RATE_BPS = 512;              // Sustained shipping rate
+const uint32_t LOG_SHIP_BURST = 2048;                // Token bucket depth
+const unsigned long LOG_SHIP_QUIET_MS = 250;         // Hold off after control publishes
+const size_t LOG_SHIP_CHUNK_MAX = 1 + LOG_SHIP_BUFFER + LOG_SHIP_BUFFER / 8 + 1; // Worst-case LZSS growth
+const int LOG_SHIP_HASH_SIZE = 1024;                  // LZSS match finder entries
+
+struct LogShipStats {
+    uint32_t chunks;
+    uint32_t raw_bytes;
+    uint32_t sent_bytes;
+    uint32_t dropped;   // records rejected while both batches were full
+};
+
+// Both batches, the chunk, their bookkeeping, the byte bucket and the match finder
+const size_t LOG_SHIP_STATIC_BYTES = 2 * LOG_SHIP_BUFFER + 2 * sizeof(size_t) + sizeof(int) + sizeof(bool) +
+                                     sizeof(portMUX_TYPE) + LOG_SHIP_CHUNK_MAX + sizeof(size_t) + sizeof(bool) +
+                                     sizeof(LogShipStats) + sizeof(uint32_t) + 2 * sizeof(unsigned long) +
+                                     (LOG_SHIP_COMPRESS ? LOG_SHIP_HASH_SIZE * sizeof(uint16_t) : 0);
+
+// Append one formatted record (called from log_write)
+void log_ship_append(int level, const char* line, size_t len);
+
+// Returns true and fills `data`/`len` when a chunk should be published now.
+// `last_control_publish` is the millis() of the latest non-log publish.
+bool log_ship_poll(unsigned long last_control_publish, const uint8_t** data, size_t* len);
+
+// Report whether the chunk from log_ship_poll() was published
+void log_ship_done(bool published);
+
+LogShipStats log_ship_stats();
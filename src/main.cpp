@@ -1,7 +1,27 @@
 #include <M5Unified.h>
 #include <WiFi.h>
-#include <PubSubClient.h>
 #include "credentials.h" // Ensure this file contains your WiFi and MQTT credentials
+#include "alert_manager.h"
+#include "broker_pool.h"
+#include "coalescing_client.h"
+#include "fixed_string.h"
+#include "heap_monitor.h"
+#include "link_monitor.h"
+#include "log.h"
+#include "log_shipper.h"
+#include "memory_budget.h"
+#include "metrics.h"
+#include "mqtt_session.h"
+#include "ota_delta.h"
+#include "outbound.h"
+#include "state_store.h"
+#include "subscriptions.h"
+#include "timer_wheel.h"
+#include "trace.h"
+#include "ui_latency.h"
+#ifdef FAULT_INJECTION
+#include "fault_client.h"
+#endif
 
 // ======= Constants =======
 const char* SOFTWARE_VERSION = "1.0.0";
@@ -10,6 +30,11 @@ const int SCREEN_HEIGHT = 240;
 const int LINE_HEIGHT = 30;
 const int MENU_TOP_OFFSET = 40;
 const int STATUS_BAR_HEIGHT = 40;
+const int TOAST_TEXT_MAX = 25;  // Characters that fit one line at text size 2
+
+typedef FixedString<TOAST_TEXT_MAX> ToastText;
+typedef FixedString<63> PayloadText; // Longer payloads are truncated
+typedef FixedString<127> OtaUrl;
 
 // ======= Timeout Parameters =======
 const unsigned long SCREEN_TIMEOUT = 30000; // 30 seconds
@@ -17,30 +42,139 @@ unsigned long last_activity_time = 0;       // Timestamp of the last user intera
 bool screen_asleep = false;                 // Screen state
 
 // ======= MQTT Topics =======
-const char* fridge_status_topic = "home/m5stack/core2/fridge_door/status";
-const char* freezer_status_topic = "home/m5stack/core2/freezer_door/status";
-const char* scenes_control_topic = "home/m5stack/core2/scenes/control";
+const char* scenes_control_topic = "home/m5stack/core2/scenes/control"; // Relay for scenes without local targets
+const char* alert_escalation_topic = "home/m5stack/core2/alerts/escalation";
+const char* ota_topic = "home/m5stack/core2/ota"; // Payload is the URL of a delta from tools/ota_delta.py
+// Per-panel topics, so a fleet sharing a broker can be told apart
+char heap_status_topic[48] = ""; // Retained heap telemetry, "home/m5stack/core2/heap/<mac>"
+char metrics_topic[48] = "";     // "home/m5stack/core2/metrics/<mac>"
+char log_topic[48] = "";         // "home/m5stack/core2/log/<mac>"
+char rtt_topic[48] = "";         // Loopback for RTT probes, "home/m5stack/core2/rtt/<mac>"
+unsigned long last_control_publish = 0; // millis() of the latest non-log publish
+
+// High-volume feeds to subscribe to. They go on the telemetry connection when
+// there is one, so a flood of readings never queues ahead of a door alert.
+const char* const telemetry_subscriptions[] = {
+    // "home/energy/+/power", // Per-circuit power readings
+    nullptr
+};
+
+// ======= MQTT Brokers =======
+// Listed in order of preference until probe RTTs are known. The panel
+// connects to the lowest-latency healthy broker and fails over when it drops.
+const BrokerConfig brokers[] = {
+    {MQTT_SERVER, MQTT_PORT},
+#ifdef MQTT_STANDBY_SERVER
+    {MQTT_STANDBY_SERVER, MQTT_STANDBY_PORT}, // Optional standby, from credentials.h
+#endif
+};
+const int num_brokers = sizeof(brokers) / sizeof(brokers[0]);
+int current_broker = -1;             // Index into brokers, -1 while disconnected
+unsigned long mqtt_lost_time = 0;    // millis() when the connection was last lost
+char mqtt_client_id[24] = "";        // "M5Core2-<mac>", so panels sharing a broker don't evict each other
+
+// Reconnects are spread out so a fleet of panels doesn't stampede a broker
+// that has just restarted
+const unsigned long RECONNECT_SPREAD = 3000;       // First attempt after a loss waits 0..3 s
+const unsigned long RECONNECT_BACKOFF_MIN = 2000;  // Wait after every broker has failed once
+const unsigned long RECONNECT_BACKOFF_MAX = 60000; // Ceiling for the doubling backoff
+unsigned long next_connect_attempt = 0;            // millis() of the next attempt
+unsigned long reconnect_backoff = RECONNECT_BACKOFF_MIN;
+int failed_connect_attempts = 0;                   // Failures since the last full round of brokers
+
+// ======= Timers =======
+const unsigned long DOOR_ESCALATION_TIME = 120000;  // Escalate a door left open for 2 minutes
+const unsigned long SENSOR_STALE_TIME = 1800000;    // Flag a sensor silent for 30 minutes
+const unsigned long ALERT_FLASH_INTERVAL = 500;     // Critical alert flash period
+TimerWheel timers;
+Timer alert_flash_timer;
+
+// ======= OTA =======
+OtaUrl pending_ota_url; // Set from the MQTT callback, applied from loop()
+
+// Deltas must be signed with the matching private key; `tools/ota_delta.py
+// keygen` prints the define for credentials.h. Without it OTA is off.
+#ifdef OTA_SIGNING_KEY
+const char* ota_signing_key = OTA_SIGNING_KEY;
+#else
+const char* ota_signing_key = nullptr;
+#endif
+
+// ======= Door Sensors =======
+struct DoorSensor {
+    const char* name;
+    const char* status_topic;
+    unsigned long settle_time;      // A reported state must hold this long to be accepted
+    unsigned long open_alert_delay; // The door must stay open this long before alerting
+    bool reported_open;             // Latest raw report; the debounced state is in the state store
+    Timer settle_timer;
+    Timer open_alert_timer;
+    Timer escalation_timer; // Fires when the door stays open too long
+    Timer stale_timer;      // Fires when the sensor goes quiet
+};
+
+DoorSensor door_sensors[] = {
+    {"Fridge", "home/m5stack/core2/fridge_door/status", 500, 5000, false},
+    {"Freezer", "home/m5stack/core2/freezer_door/status", 500, 5000, false}
+};
+const int num_door_sensors = sizeof(door_sensors) / sizeof(door_sensors[0]);
+enum { FRIDGE_SENSOR, FREEZER_SENSOR };
 
 // ======= Devices and Scenes =======
 struct Device {
     const char* name;
     const char* control_topic;
-    bool is_active;
+    const char* state_topic;     // Retained ON/OFF reported by the device, followed on the Devices screen
+    unsigned long auto_off_time; // Turn off automatically after this long, 0 = never
+    Timer auto_off_timer;
 };
 
 Device devices[] = {
-    {"Hallway Lights", "home/m5stack/core2/devices/hallway/control", false},
-    {"Living Room Tree", "home/m5stack/core2/devices/living_tree/control", false},
-    {"Left Lamp", "home/m5stack/core2/devices/left_lamp/control", false},
-    {"Right Lamp 1", "home/m5stack/core2/devices/right_lamp1/control", false},
-    {"Right Lamp 2", "home/m5stack/core2/devices/right_lamp2/control", false},
-    {"Spotlight", "home/m5stack/core2/devices/spotlight/control", false}
+    {"Hallway Lights", "home/m5stack/core2/devices/hallway/control",
+     "home/m5stack/core2/devices/hallway/state", 900000},
+    {"Living Room Tree", "home/m5stack/core2/devices/living_tree/control",
+     "home/m5stack/core2/devices/living_tree/state", 0},
+    {"Left Lamp", "home/m5stack/core2/devices/left_lamp/control",
+     "home/m5stack/core2/devices/left_lamp/state", 0},
+    {"Right Lamp 1", "home/m5stack/core2/devices/right_lamp1/control",
+     "home/m5stack/core2/devices/right_lamp1/state", 0},
+    {"Right Lamp 2", "home/m5stack/core2/devices/right_lamp2/control",
+     "home/m5stack/core2/devices/right_lamp2/state", 0},
+    {"Spotlight", "home/m5stack/core2/devices/spotlight/control",
+     "home/m5stack/core2/devices/spotlight/state", 1800000}
 };
 const int num_devices = sizeof(devices) / sizeof(devices[0]);
 
-const char* scenes[] = {
-    "Bright/Normal", "Christmas", "Freezer/Fridge", "Seahawks", "Sounders",
-    "Vibes", "Warm", "Warm Bright", "Custom Scene 1", "Custom Scene 2"
+static_assert(sizeof(door_sensors) / sizeof(door_sensors[0]) <= STATE_MAX_DOORS, "Too many doors for the state store");
+static_assert(sizeof(devices) / sizeof(devices[0]) <= STATE_MAX_DEVICES, "Too many devices for the state store");
+
+// Debounced door and device states live in the state store, see state_store.h
+bool door_open(const DoorSensor& sensor) {
+    return state_door_open(state_current(), &sensor - door_sensors);
+}
+
+bool device_on(const Device& device) {
+    return state_device_on(state_current(), &device - devices);
+}
+
+// Target state per device, in devices[] order: '1' = ON, '0' = OFF, '-' = leave as is.
+// Scenes without targets are relayed by name on scenes_control_topic.
+struct Scene {
+    const char* name;
+    const char* targets;
+};
+
+Scene scenes[] = {
+    {"Bright/Normal", "111110"},
+    {"Christmas", "111000"},
+    {"Freezer/Fridge", "100000"},
+    {"Seahawks", "001111"},
+    {"Sounders", "001111"},
+    {"Vibes", "01100-"},
+    {"Warm", "01110-"},
+    {"Warm Bright", "111110"},
+    {"Custom Scene 1", nullptr},
+    {"Custom Scene 2", nullptr}
 };
 const int num_scenes = sizeof(scenes) / sizeof(scenes[0]);
 
@@ -50,45 +184,148 @@ const char* devices_menu_items[] = {"Hallway Lights", "Living Room Tree", "Left
 const char* scenes_menu_items[] = {"Bright/Normal", "Christmas", "Freezer/Fridge", "Seahawks", "Sounders", "Vibes", "Warm", "Warm Bright", "Custom Scene 1", "Custom Scene 2", "< Back>"};
 
 // ======= Global Variables =======
+// The current menu, selection and scroll position are in the state store
 enum MenuState { MAIN_MENU, DEVICES_MENU, SCENES_MENU };
-MenuState current_menu = MAIN_MENU;
 
-int selected_index = 0; // Currently selected item in the menu
-int scroll_offset = 0;  // Tracks the first visible item in the menu
 const int max_visible_items = (SCREEN_HEIGHT - MENU_TOP_OFFSET - STATUS_BAR_HEIGHT) / LINE_HEIGHT;
+const int DEVICE_STATE_X = SCREEN_WIDTH - 46; // "OFF" right-aligned at text size 2
+
+// What render_ui() last painted
+uint32_t drawn_versions[SLICE_COUNT]; // Slice versions on the LCD now
+bool render_all = true;               // Something outside the renderer covered the screen
 
-bool fridge_open = false;  // Fridge door status
-bool freezer_open = false; // Freezer door status
 
-bool alert_active = false; // Alert state
-String alert_message = "";  // Alert message to display
+// Receive buffers bound the largest inbound message, an OTA URL; longer
+// publishes are streamed past the transmit buffer
+const size_t MQTT_RX_BUFFER_SIZE = 512;
+const size_t MQTT_TX_BUFFER_SIZE = 256;
 
 WiFiClient espClient;
-PubSubClient mqtt_client(espClient);
+CoalescingClient mqtt_transport(espClient); // Sends each loop()'s packets together, see coalescing_client.h
+uint8_t mqtt_rx_buffer[MQTT_RX_BUFFER_SIZE];
+uint8_t mqtt_tx_buffer[MQTT_TX_BUFFER_SIZE];
+#ifdef FAULT_INJECTION
+FaultClient fault_client(mqtt_transport); // Injects network faults per packet, see fault_client.h
+MqttSession mqtt_client(fault_client, mqtt_rx_buffer, sizeof(mqtt_rx_buffer), mqtt_tx_buffer, sizeof(mqtt_tx_buffer));
+#else
+MqttSession mqtt_client(mqtt_transport, mqtt_rx_buffer, sizeof(mqtt_rx_buffer), mqtt_tx_buffer,
+                        sizeof(mqtt_tx_buffer));
+#endif
+
+#ifdef TELEMETRY_CONNECTION
+// ======= Telemetry Connection =======
+// Built with -DTELEMETRY_CONNECTION, heap, metrics and log publishes and the
+// telemetry subscriptions use a second connection to the same broker. Bulk
+// traffic then queues in its own socket and is read by its own client, while
+// the control connection keeps its short keepalive for door alerts and
+// device commands.
+const uint16_t TELEMETRY_KEEPALIVE = 60;              // Seconds; a late-noticed drop only delays telemetry
+const unsigned long TELEMETRY_RETRY_INTERVAL = 5000;
+WiFiClient telemetry_net;
+uint8_t telemetry_rx_buffer[MQTT_RX_BUFFER_SIZE];
+uint8_t telemetry_tx_buffer[MQTT_TX_BUFFER_SIZE];
+MqttSession telemetry_client(telemetry_net, telemetry_rx_buffer, sizeof(telemetry_rx_buffer), telemetry_tx_buffer,
+                             sizeof(telemetry_tx_buffer));
+char telemetry_client_id[28] = "";    // "M5Core2-<mac>-tm"
+int telemetry_broker = -1;            // Broker the telemetry connection is on, -1 while disconnected
+unsigned long next_telemetry_attempt = 0;
+#endif
+
+// ======= Memory Budget =======
+const size_t DISPLAY_SPRITE_BYTES = 0; // Add width * height * 2 for every sprite created
+const size_t DEVICE_TABLE_BYTES = sizeof(devices) + sizeof(door_sensors) + sizeof(scenes) +
+                                  sizeof(main_menu_items) + sizeof(devices_menu_items) + sizeof(scenes_menu_items);
+const size_t MQTT_STATIC_BYTES = sizeof(espClient) + sizeof(mqtt_transport) + sizeof(mqtt_client) + sizeof(mqtt_rx_buffer) +
+                                 sizeof(mqtt_tx_buffer) + sizeof(heap_status_topic) + sizeof(metrics_topic) +
+                                 sizeof(log_topic) + sizeof(rtt_topic) + sizeof(brokers) + BROKER_POOL_STATIC_BYTES +
+                                 OUTBOUND_STATIC_BYTES + LINK_MONITOR_STATIC_BYTES + SUBS_STATIC_BYTES
+#ifdef FAULT_INJECTION
+                                 + sizeof(fault_client)
+#endif
+#ifdef TELEMETRY_CONNECTION
+                                 + sizeof(telemetry_net) + sizeof(telemetry_client) + sizeof(telemetry_rx_buffer) +
+                                 sizeof(telemetry_tx_buffer) + sizeof(telemetry_client_id)
+#endif
+                                 ;
+const size_t UI_TEXT_BYTES = ALERT_STATIC_BYTES + STATE_STORE_STATIC_BYTES + sizeof(drawn_versions);
+const size_t TIMER_BYTES = sizeof(TimerWheel) + sizeof(alert_flash_timer);
+const size_t LOGGING_BYTES = LOG_STATIC_BYTES + LOG_SHIP_STATIC_BYTES;
+const size_t DIAGNOSTICS_BYTES = TRACE_STATIC_BYTES + METRICS_STATIC_BYTES + HEAP_MONITOR_STATIC_BYTES +
+                                 UI_LATENCY_STATIC_BYTES;
+const size_t OTA_BYTES = OTA_STATIC_BYTES + sizeof(pending_ota_url);
+
+static_assert(DEVICE_TABLE_BYTES <= BUDGET_DEVICE_TABLES, "Device tables exceed BUDGET_DEVICE_TABLES");
+static_assert(MQTT_STATIC_BYTES <= BUDGET_MQTT, "MQTT buffers exceed BUDGET_MQTT");
+static_assert(DISPLAY_SPRITE_BYTES <= BUDGET_DISPLAY, "Display buffers exceed BUDGET_DISPLAY");
+static_assert(UI_TEXT_BYTES <= BUDGET_UI_TEXT, "UI text buffers exceed BUDGET_UI_TEXT");
+static_assert(TIMER_BYTES <= BUDGET_TIMERS, "Timers exceed BUDGET_TIMERS");
+static_assert(LOGGING_BYTES <= BUDGET_LOGGING, "Logging buffers exceed BUDGET_LOGGING");
+static_assert(DIAGNOSTICS_BYTES <= BUDGET_DIAGNOSTICS, "Diagnostics buffers exceed BUDGET_DIAGNOSTICS");
+static_assert(OTA_BYTES <= BUDGET_OTA, "OTA buffers exceed BUDGET_OTA");
+static_assert(DEVICE_TABLE_BYTES + MQTT_STATIC_BYTES + DISPLAY_SPRITE_BYTES + UI_TEXT_BYTES +
+              TIMER_BYTES + LOGGING_BYTES + DIAGNOSTICS_BYTES + OTA_BYTES <= BUDGET_TOTAL,
+              "Static allocations exceed BUDGET_TOTAL");
+
+const MemoryBudget memory_budgets[] = {
+    {"Device tables", DEVICE_TABLE_BYTES, BUDGET_DEVICE_TABLES},
+    {"MQTT", MQTT_STATIC_BYTES, BUDGET_MQTT},
+    {"Display", DISPLAY_SPRITE_BYTES, BUDGET_DISPLAY},
+    {"UI text", UI_TEXT_BYTES, BUDGET_UI_TEXT},
+    {"Timers", TIMER_BYTES, BUDGET_TIMERS},
+    {"Logging", LOGGING_BYTES, BUDGET_LOGGING},
+    {"Diagnostics", DIAGNOSTICS_BYTES, BUDGET_DIAGNOSTICS},
+    {"OTA", OTA_BYTES, BUDGET_OTA}
+};
+const int num_memory_budgets = sizeof(memory_budgets) / sizeof(memory_budgets[0]);
 
 // ======= Function Prototypes =======
 void setup_wifi();
 void reconnect_mqtt();
-void mqtt_callback(char* topic, byte* payload, unsigned int length);
-void draw_menu(const char* title, const char* items[], int num_items);
+void mqtt_callback(const MqttPublish& message);
+void draw_menu(const UiState& state);
+void draw_device_states(const UiState& state);
+void render_ui();
+void render_invalidate();
 void navigate_menu(int direction);
 void select_menu_item();
 void toggle_device(int index);
+bool set_device(Device& device, bool on, OutboundLane lane = LANE_COMMAND);
 void apply_scene(int index);
 void power_off_all_devices();
-void draw_status_bar();
-void update_fridge_freezer_status(const char* topic, bool is_open);
-void handle_alert();
+void show_toast(const ToastText& text, unsigned long duration);
+void draw_status_bar(const UiState& state);
+void report_door_status(DoorSensor& sensor, bool is_open);
+void settle_door_status(void* arg);
+void update_door_status(DoorSensor& sensor, bool is_open);
+void raise_door_alert(void* arg);
+void escalate_door_alert(void* arg);
+void flag_stale_sensor(void* arg);
+void flash_alerts(void* arg);
+void auto_off_device(void* arg);
+void handle_alert(const UiState& state);
 void clear_alert();
 void handle_screen_timeout();
 void wakeup_screen();
 void sleep_screen();
+void report_heap();
+void report_metrics();
+void handle_serial_commands();
+void ship_logs();
+void run_pending_ota();
+bool mqtt_publish(OutboundLane lane, const char* topic, const char* payload, bool retained = false);
+bool mqtt_publish(OutboundLane lane, const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+bool mqtt_send(OutboundLane lane, const char* topic, const uint8_t* payload, size_t length, bool retained);
+MqttSession& telemetry_mqtt();
+void maintain_telemetry_connection();
+void monitor_link();
+void draw_link_rtt(bool force);
 
 // ======= Setup =======
 void setup() {
     auto cfg = M5.config();
     cfg.serial_baudrate = 115200;
     M5.begin(cfg);
+    log_begin();
 
     M5.Lcd.setRotation(1);
     M5.Lcd.fillScreen(TFT_BLACK);
@@ -98,28 +335,97 @@ void setup() {
 
     setup_wifi();  // Connect to Wi-Fi
 
-    mqtt_client.setServer(MQTT_SERVER, MQTT_PORT);
-    mqtt_client.setCallback(mqtt_callback);  // Set the callback function for MQTT messages
+    // Per-panel identity from the MAC address
+    uint8_t mac[6];
+    char mac_hex[13];
+    WiFi.macAddress(mac);
+    snprintf(mac_hex, sizeof(mac_hex), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(heap_status_topic, sizeof(heap_status_topic), "home/m5stack/core2/heap/%s", mac_hex);
+    snprintf(metrics_topic, sizeof(metrics_topic), "home/m5stack/core2/metrics/%s", mac_hex);
+    snprintf(log_topic, sizeof(log_topic), "home/m5stack/core2/log/%s", mac_hex);
+    snprintf(rtt_topic, sizeof(rtt_topic), "home/m5stack/core2/rtt/%s", mac_hex);
+    snprintf(mqtt_client_id, sizeof(mqtt_client_id), "M5Core2-%s", mac_hex);
+
+    // Door alerts, OTA and the RTT loopback stay subscribed; device states
+    // only while the Devices screen is up
+    subs_begin(mqtt_client);
+    for (int i = 0; i < num_door_sensors; i++) {
+        subs_add(door_sensors[i].status_topic, SUB_ALWAYS);
+    }
+    if (ota_signing_key) {
+        subs_add(ota_topic, SUB_ALWAYS);
+    } else {
+        LOG_WARN("OTA: no OTA_SIGNING_KEY in credentials.h, updates disabled");
+    }
+    subs_add(rtt_topic, SUB_ALWAYS);
+#ifndef TELEMETRY_CONNECTION
+    for (int i = 0; telemetry_subscriptions[i]; i++) {
+        subs_add(telemetry_subscriptions[i], SUB_ALWAYS);
+    }
+#endif
+    for (int i = 0; i < num_devices; i++) {
+        subs_add(devices[i].state_topic, DEVICES_MENU);
+    }
+    subs_set_screen(state_current().menu);
+
+    broker_pool_begin(brokers, num_brokers);
+    outbound_begin(mqtt_send);
+    mqtt_client.set_callback(mqtt_callback);  // Set the callback function for MQTT messages
+#ifdef TELEMETRY_CONNECTION
+    snprintf(telemetry_client_id, sizeof(telemetry_client_id), "M5Core2-%s-tm", mac_hex);
+    telemetry_client.set_keepalive(TELEMETRY_KEEPALIVE);
+    telemetry_client.set_callback(mqtt_callback);
+#endif
 
     last_activity_time = millis(); // Initialize the last activity timestamp
 
-    // Connect to MQTT Broker
+    // Start staleness detection for every door sensor
+    timers.begin(millis());
+    for (int i = 0; i < num_door_sensors; i++) {
+        timers.arm(door_sensors[i].stale_timer, SENSOR_STALE_TIME, flag_stale_sensor, &door_sensors[i]);
+    }
+
+    // First attempt to connect to the MQTT broker; loop() retries from here on
+    M5.Lcd.println("Connecting to MQTT...");
     reconnect_mqtt();
 
     // Draw the Main Menu
-    draw_menu("Main Menu", main_menu_items, 4);
+    render_ui();
+
+    LogPrint budget_log(LOG_LEVEL_INFO);
+    memory_budget_print(budget_log, memory_budgets, num_memory_budgets);
+
+    // From here on the loop task should not touch the heap
+    heap_monitor_mark_steady_state();
 }
 
 // ======= Main Loop =======
 void loop() {
-    // Handle MQTT connection
+    unsigned long loop_start = micros();
+
+    // Handle MQTT connection, moving back to a faster broker once it has proven stable
     if (!mqtt_client.connected()) {
         reconnect_mqtt();
+    } else {
+        int better = broker_pool_failback(current_broker, millis());
+        if (better >= 0) {
+            LOG_INFO("MQTT: failing back to %s:%u", brokers[better].host, brokers[better].port);
+            mqtt_client.disconnect();
+            current_broker = -1; // Deliberate, not counted against the old broker
+            mqtt_lost_time = millis();
+            reconnect_mqtt();
+        }
     }
     mqtt_client.loop();
+    monitor_link();
+    maintain_telemetry_connection();
+
+    // Send queued commands and scenes the rate limits now allow
+    outbound_poll();
 
     // Handle M5Stack Core2 tasks
     M5.update();
+    uint32_t input_us = micros(); // When this iteration's button presses were read
 
     // Detect any user interactions
     bool any_button_pressed = false;
@@ -133,18 +439,79 @@ void loop() {
         if (screen_asleep) {
             wakeup_screen();
         }
-        if (alert_active) {
+        if (alert_any_visible()) {
             clear_alert();
         }
     }
 
-    // Handle specific button presses for navigation and selection
-    if (M5.BtnA.wasPressed()) navigate_menu(-1); // Move up
-    if (M5.BtnC.wasPressed()) navigate_menu(1);  // Move down
-    if (M5.BtnB.wasPressed()) select_menu_item(); // Select item
+    // Handle specific button presses for navigation and selection, timing
+    // each one until its first frame has been pushed to the LCD
+    if (M5.BtnA.wasPressed()) {
+        ui_latency_input(UI_ACTION_NAVIGATE, input_us);
+        navigate_menu(-1); // Move up
+    }
+    if (M5.BtnC.wasPressed()) {
+        ui_latency_input(UI_ACTION_NAVIGATE, input_us);
+        navigate_menu(1);  // Move down
+    }
+    if (M5.BtnB.wasPressed()) {
+        ui_latency_input(UI_ACTION_SELECT, input_us);
+        select_menu_item(); // Select item
+    }
+
+    // Run due escalation, auto-off and staleness timers
+    timers.advance(millis());
+
+    // Rotate through alert pages when more alerts are active than fit on screen
+    if (alert_rotate(millis())) {
+        state_alerts_changed();
+    }
 
     // Handle screen timeout
     handle_screen_timeout();
+
+    // Repaint what this iteration changed; a press that changed nothing
+    // on screen is not timed
+    render_ui();
+    ui_latency_discard();
+
+    // Subscribe to what the visible screen shows, and drop what it no longer does
+    subs_set_screen(screen_asleep ? SUBS_SCREEN_OFF : state_current().menu);
+
+    // Handle diagnostic requests over Serial
+    handle_serial_commands();
+
+    // Ship batched logs when the link is quiet
+    ship_logs();
+
+    // Apply a requested firmware update
+    run_pending_ota();
+
+    // Sample heap and publish telemetry
+    if (heap_monitor_poll()) {
+        report_heap();
+    }
+
+    uint32_t loop_us = micros() - loop_start;
+    metrics_record_loop(loop_us);
+#ifdef FAULT_INJECTION
+    fault_sim_observe(fault_client, mqtt_client.connected(), loop_us);
+#endif
+    if (metrics_poll()) {
+        report_metrics();
+    }
+
+    // Send everything published this iteration in one write
+    mqtt_transport.flush();
+
+#ifdef HEAP_ALLOC_CHECK
+    // Stop at the first allocation after warm-up, with its caller on Serial
+    if (!heap_monitor_check()) {
+        heap_monitor_print(Serial);
+        Serial.flush();
+        abort();
+    }
+#endif
 }
 
 // ======= WiFi Setup =======
@@ -164,140 +531,328 @@ void setup_wifi() {
 }
 
 // ======= MQTT Reconnect =======
+// Called from loop() while disconnected. Makes at most one connection
+// attempt per call so the UI and timers keep running during an outage.
 void reconnect_mqtt() {
-    // Loop until reconnected
-    while (!mqtt_client.connected()) {
-        M5.Lcd.print("Attempting MQTT connection...");
-        // Attempt to connect
-        if (MQTT_USER[0] != '\0') {
-            // If username is set
-            if (mqtt_client.connect("M5StackCore2", MQTT_USER, MQTT_PASSWORD)) {
-                M5.Lcd.println("connected");
-                // Subscribe to fridge and freezer status topics
-                mqtt_client.subscribe(fridge_status_topic);
-                mqtt_client.subscribe(freezer_status_topic);
-            } else {
-                M5.Lcd.print("failed, rc=");
-                M5.Lcd.print(mqtt_client.state());
-                M5.Lcd.println(" try again in 5 seconds");
-                delay(5000);
-            }
-        } else {
-            // If no username
-            if (mqtt_client.connect("M5StackCore2")) {
-                M5.Lcd.println("connected");
-                // Subscribe to fridge and freezer status topics
-                mqtt_client.subscribe(fridge_status_topic);
-                mqtt_client.subscribe(freezer_status_topic);
-            } else {
-                M5.Lcd.print("failed, rc=");
-                M5.Lcd.print(mqtt_client.state());
-                M5.Lcd.println(" try again in 5 seconds");
-                delay(5000);
-            }
+    TRACE_SCOPE(TRACE_RECONNECT_MQTT);
+    HeapAllocAllowed allow_alloc; // Opening a socket allocates in lwIP
+    // A dropped connection counts against the broker so the next attempt
+    // goes to a standby instead of waiting for this one to come back.
+    // Every panel loses its connection at the same moment when a broker
+    // restarts, so the first attempt is spread over RECONNECT_SPREAD.
+    if (current_broker >= 0) {
+        LOG_WARN("MQTT: lost connection to %s:%u", brokers[current_broker].host, brokers[current_broker].port);
+        broker_pool_report(current_broker, false);
+        current_broker = -1;
+        mqtt_lost_time = millis();
+        next_connect_attempt = mqtt_lost_time + random(RECONNECT_SPREAD);
+        reconnect_backoff = RECONNECT_BACKOFF_MIN;
+        failed_connect_attempts = 0;
+        return;
+    }
+    if ((long)(millis() - next_connect_attempt) < 0) return;
+
+    int index = broker_pool_select();
+    const BrokerConfig& broker = brokers[index];
+    mqtt_client.set_server(broker.host, broker.port);
+    // Keepalive follows the RTT and signal measured on earlier connections
+    link_monitor_set_rssi(WiFi.RSSI());
+    mqtt_client.set_keepalive(link_monitor_keepalive());
+    // Attempt to connect, with credentials if a username is set
+    bool connected = MQTT_USER[0] != '\0' ? mqtt_client.connect(mqtt_client_id, MQTT_USER, MQTT_PASSWORD)
+                                           : mqtt_client.connect(mqtt_client_id);
+    broker_pool_report(index, connected);
+    if (connected) {
+        current_broker = index;
+        failed_connect_attempts = 0;
+        espClient.setNoDelay(true); // Writes are already coalesced; don't wait on Nagle
+        LOG_INFO("MQTT: %s connected to %s:%u in %lu ms", mqtt_client_id, broker.host, broker.port,
+                 millis() - mqtt_lost_time);
+        metrics_count_reconnect();
+        // Always-on topics and the current screen's, packed into as few SUBSCRIBEs as fit
+        subs_connected();
+        link_monitor_reset(millis());
+        return;
+    }
+
+    LOG_WARN("MQTT: connect to %s:%u failed, rc=%d", broker.host, broker.port, mqtt_client.state());
+    // Try the next broker straight away; once all have failed, back off
+    // with full jitter so retries from many panels don't line up
+    if (++failed_connect_attempts >= num_brokers) {
+        failed_connect_attempts = 0;
+        unsigned long wait = random(RECONNECT_BACKOFF_MIN, reconnect_backoff + 1);
+        next_connect_attempt = millis() + wait;
+        reconnect_backoff = min(reconnect_backoff * 2, RECONNECT_BACKOFF_MAX);
+        LOG_WARN("MQTT: all brokers failed, retrying in %lu ms", wait);
+    }
+}
+
+// ======= Telemetry Connection =======
+// Connection that carries LANE_TELEMETRY publishes
+MqttSession& telemetry_mqtt() {
+#ifdef TELEMETRY_CONNECTION
+    return telemetry_client;
+#else
+    return mqtt_client;
+#endif
+}
+
+// Keeps the telemetry connection on the control connection's broker. Called
+// from loop(); does nothing unless built with -DTELEMETRY_CONNECTION.
+void maintain_telemetry_connection() {
+#ifdef TELEMETRY_CONNECTION
+    if (telemetry_broker != current_broker || !telemetry_client.connected()) {
+        if (telemetry_broker >= 0) {
+            telemetry_client.disconnect();
+            telemetry_broker = -1;
+        }
+        if (current_broker < 0 || (long)(millis() - next_telemetry_attempt) < 0) return;
+
+        // Spaced out so a broker refusing the second client can't stall loop()
+        next_telemetry_attempt = millis() + TELEMETRY_RETRY_INTERVAL;
+        HeapAllocAllowed allow_alloc;
+        const BrokerConfig& broker = brokers[current_broker];
+        telemetry_client.set_server(broker.host, broker.port);
+        bool connected = MQTT_USER[0] != '\0'
+                             ? telemetry_client.connect(telemetry_client_id, MQTT_USER, MQTT_PASSWORD)
+                             : telemetry_client.connect(telemetry_client_id);
+        if (!connected) {
+            LOG_WARN("MQTT: telemetry connect to %s:%u failed, rc=%d", broker.host, broker.port,
+                     telemetry_client.state());
+            return;
+        }
+        telemetry_broker = current_broker;
+        LOG_INFO("MQTT: %s connected to %s:%u", telemetry_client_id, broker.host, broker.port);
+        for (int i = 0; telemetry_subscriptions[i]; i++) {
+            telemetry_client.subscribe(telemetry_subscriptions[i]);
         }
     }
+    telemetry_client.loop();
+#endif
+}
+
+// ======= Link Monitor =======
+// Probes the control connection through the loopback topic and drops it
+// when probes stop echoing, see link_monitor.h
+void monitor_link() {
+    if (!mqtt_client.connected()) return;
+    char payload[24];
+    size_t len;
+    switch (link_monitor_poll(millis(), payload, sizeof(payload), &len)) {
+        case LINK_SEND_PROBE:
+            mqtt_publish(LANE_COMMAND, rtt_topic, (const uint8_t*)payload, len, false);
+            mqtt_transport.flush(); // Don't hold the probe until the end of loop()
+            break;
+        case LINK_DEAD:
+            LOG_WARN("MQTT: probes to %s:%u unanswered, dropping connection", brokers[current_broker].host,
+                     brokers[current_broker].port);
+            mqtt_client.disconnect();
+            draw_link_rtt(false);
+            break;
+        case LINK_IDLE:
+            break;
+    }
+}
+
+// RTT in the corner of the status bar, redrawn only when the text changes
+void draw_link_rtt(bool force) {
+    static char shown[24] = "";
+    if (screen_asleep || alert_any_visible()) return;
+
+    char text[24];
+    LinkStats s = link_monitor_stats();
+    if (mqtt_client.connected() && s.srtt_us) {
+        snprintf(text, sizeof(text), "RTT %lums", (unsigned long)(s.srtt_us + 500) / 1000);
+    } else {
+        snprintf(text, sizeof(text), "RTT --");
+    }
+    if (!force && strcmp(text, shown) == 0) return;
+    strcpy(shown, text);
+
+    const int top = SCREEN_HEIGHT - STATUS_BAR_HEIGHT + 30;
+    M5.Lcd.fillRect(SCREEN_WIDTH - 70, top, 70, 8, TFT_DARKGRAY);
+    M5.Lcd.setTextSize(1);
+    M5.Lcd.setTextColor(TFT_WHITE, TFT_DARKGRAY);
+    M5.Lcd.setCursor(SCREEN_WIDTH - 4 - 6 * strlen(text), top);
+    M5.Lcd.print(text);
 }
 
 // ======= MQTT Callback =======
-void mqtt_callback(char* topic, byte* payload, unsigned int length) {
-    // Safely convert payload to String without modifying the original buffer
-    String msg;
-    for (unsigned int i = 0; i < length; i++) {
-        msg += (char)payload[i];
+// Topic and payload point into the session's receive buffer
+void mqtt_callback(const MqttPublish& message) {
+    TRACE_SCOPE(TRACE_MQTT_CALLBACK);
+    metrics_count_in();
+    const MqttView& topic = message.topic;
+
+    // Probe echoes are timed, so handle them before anything else
+    if (topic.equals(rtt_topic)) {
+        link_monitor_echo(message.payload.data, message.payload.len);
+        draw_link_rtt(false);
+        return;
     }
+
+    // Copy the payload into a fixed buffer without modifying the original
+    PayloadText msg;
+    msg.assign((const char*)message.payload.data, message.payload.len);
     msg.trim(); // Remove any leading/trailing whitespace
 
-    // Debugging: Print received MQTT message
-    Serial.print("Received message on topic: ");
-    Serial.print(topic);
-    Serial.print(" with payload: ");
-    Serial.println(msg);
+    LOG_DEBUG("Received message on topic: %.*s with payload: %s", (int)topic.len, (const char*)topic.data,
+              msg.c_str());
 
-    // Handle Fridge status update
-    if (strcmp(topic, fridge_status_topic) == 0) {
-        update_fridge_freezer_status(topic, msg.equalsIgnoreCase("OPEN"));
+    // Handle door sensor status updates
+    for (int i = 0; i < num_door_sensors; i++) {
+        if (topic.equals(door_sensors[i].status_topic)) {
+            report_door_status(door_sensors[i], msg.equals_ignore_case("OPEN"));
+        }
     }
 
-    // Handle Freezer status update
-    if (strcmp(topic, freezer_status_topic) == 0) {
-        update_fridge_freezer_status(topic, msg.equalsIgnoreCase("OPEN"));
+    // Device state reports, only subscribed while the Devices screen is up
+    for (int i = 0; i < num_devices; i++) {
+        if (topic.equals(devices[i].state_topic)) {
+            state_set_device(i, msg.equals_ignore_case("ON"));
+        }
     }
-}
 
-// ======= Update Fridge/Freezer Status =======
-void update_fridge_freezer_status(const char* topic, bool is_open) {
-    if (strcmp(topic, fridge_status_topic) == 0) {
-        fridge_open = is_open;
-        if (is_open) {
-            alert_active = true;
-            alert_message = "Fridge Door Open!";
-        } else {
-            alert_active = false;
-            alert_message = "";
+    // Firmware update requests are deferred to loop() so the download does
+    // not run inside the client's callback
+    if (topic.equals(ota_topic)) {
+        pending_ota_url.assign((const char*)message.payload.data, message.payload.len);
+        pending_ota_url.trim();
+        if (pending_ota_url.truncated()) {
+            LOG_ERROR("OTA URL too long, ignored");
+            pending_ota_url.clear();
         }
     }
-    if (strcmp(topic, freezer_status_topic) == 0) {
-        freezer_open = is_open;
-        if (is_open) {
-            alert_active = true;
-            alert_message = "Freezer Door Open!";
-        } else {
-            alert_active = false;
-            alert_message = "";
+}
+
+// ======= Door Status Debounce =======
+void report_door_status(DoorSensor& sensor, bool is_open) {
+    // Any message proves the sensor is alive
+    timers.arm(sensor.stale_timer, SENSOR_STALE_TIME, flag_stale_sensor, &sensor);
+    if (alert_clear(sensor.name)) {
+        state_alerts_changed();
+    }
+
+    // Accept a change once the sensor has disagreed with the debounced
+    // state for the whole settle time. The timer is armed by the first
+    // disagreeing report and not pushed back by later ones, so a chattering
+    // reed switch is still accepted; a report back at the debounced state
+    // cancels it.
+    sensor.reported_open = is_open;
+    if (is_open == door_open(sensor)) {
+        timers.cancel(sensor.settle_timer);
+    } else if (sensor.settle_time == 0) {
+        update_door_status(sensor, is_open);
+    } else if (!TimerWheel::armed(sensor.settle_timer)) {
+        timers.arm(sensor.settle_timer, sensor.settle_time, settle_door_status, &sensor);
+    }
+}
+
+void settle_door_status(void* arg) {
+    DoorSensor& sensor = *(DoorSensor*)arg;
+    update_door_status(sensor, sensor.reported_open);
+}
+
+// ======= Update Door Status =======
+void update_door_status(DoorSensor& sensor, bool is_open) {
+    if (is_open == door_open(sensor)) return;
+    state_set_door(&sensor - door_sensors, is_open);
+
+    if (is_open) {
+        timers.arm(sensor.open_alert_timer, sensor.open_alert_delay, raise_door_alert, &sensor);
+        timers.arm(sensor.escalation_timer, DOOR_ESCALATION_TIME, escalate_door_alert, &sensor);
+    } else {
+        timers.cancel(sensor.open_alert_timer);
+        timers.cancel(sensor.escalation_timer);
+        if (alert_clear(sensor.status_topic)) {
+            state_alerts_changed();
         }
     }
-    draw_status_bar();
-    draw_menu(
-        (current_menu == MAIN_MENU) ? "Main Menu" :
-        (current_menu == DEVICES_MENU) ? "Devices" :
-        "Scenes",
-        (current_menu == MAIN_MENU) ? main_menu_items :
-        (current_menu == DEVICES_MENU) ? devices_menu_items :
-        scenes_menu_items,
-        (current_menu == MAIN_MENU) ? 4 :
-        (current_menu == DEVICES_MENU) ? (num_devices + 1) :
-        (num_scenes + 1)
-    );
+}
+
+// ======= Door Alert =======
+void raise_door_alert(void* arg) {
+    DoorSensor& sensor = *(DoorSensor*)arg;
+    AlertText message;
+    message.format("%s Door Open!", sensor.name);
+    if (alert_raise(sensor.status_topic, message.c_str(), ALERT_WARNING)) {
+        state_alerts_changed();
+    }
+}
+
+// ======= Door Escalation =======
+void escalate_door_alert(void* arg) {
+    DoorSensor& sensor = *(DoorSensor*)arg;
+    AlertText message;
+    message.format("%s Open > %lu min!", sensor.name, DOOR_ESCALATION_TIME / 60000);
+    LOG_WARN("%s", message.c_str());
+
+    if (mqtt_client.connected()) {
+        mqtt_publish(LANE_COMMAND, alert_escalation_topic, message.c_str());
+    }
+    if (alert_raise(sensor.status_topic, message.c_str(), ALERT_CRITICAL)) {
+        state_alerts_changed();
+    }
+    if (!TimerWheel::armed(alert_flash_timer)) {
+        timers.arm(alert_flash_timer, ALERT_FLASH_INTERVAL, flash_alerts, nullptr);
+    }
+}
+
+// ======= Flash Critical Alerts =======
+void flash_alerts(void*) {
+    if (!alert_any_critical_visible()) {
+        state_set_alert_flash(false);
+        return;
+    }
+    state_set_alert_flash(!state_current().alert_flash_hidden);
+    timers.arm(alert_flash_timer, ALERT_FLASH_INTERVAL, flash_alerts, nullptr);
+}
+
+// ======= Sensor Staleness =======
+void flag_stale_sensor(void* arg) {
+    DoorSensor& sensor = *(DoorSensor*)arg;
+    AlertText message;
+    message.format("%s Sensor Offline", sensor.name);
+    LOG_WARN("%s", message.c_str());
+    if (alert_raise(sensor.name, message.c_str(), ALERT_INFO)) {
+        state_alerts_changed();
+    }
 }
 
 // ======= Handle Alert =======
-void handle_alert() {
-    if (alert_active) {
-        // Display alert message
-        M5.Lcd.setTextSize(3);
-        M5.Lcd.setTextColor(TFT_RED, TFT_BLACK);
-        M5.Lcd.setCursor(10, SCREEN_HEIGHT / 2 - 20);
-        M5.Lcd.printf("%s", alert_message.c_str());
+void handle_alert(const UiState& state) {
+    const Alert* page[ALERT_STACK_LINES];
+    int n = alert_page(page);
+    if (n == 0) return;
 
-        // Optionally, add more visual indicators like flashing text or changing background color
+    // Stack the alerts on this page, most severe first
+    M5.Lcd.setTextSize(2);
+    for (int i = 0; i < n; i++) {
+        uint16_t color = page[i]->severity == ALERT_CRITICAL ? (state.alert_flash_hidden ? TFT_BLACK : TFT_RED) :
+                         page[i]->severity == ALERT_WARNING ? TFT_ORANGE : TFT_WHITE;
+        M5.Lcd.setTextColor(color, TFT_BLACK);
+        M5.Lcd.setCursor(10, SCREEN_HEIGHT / 2 - 20 + i * 24);
+        M5.Lcd.print(page[i]->message.c_str());
+    }
+    if (alert_page_count() > 1) {
+        M5.Lcd.setTextColor(TFT_WHITE, TFT_BLACK);
+        M5.Lcd.setCursor(10, SCREEN_HEIGHT / 2 - 20 + ALERT_STACK_LINES * 24);
+        M5.Lcd.printf("(%d/%d, %d alerts)", alert_page_index() + 1, alert_page_count(), alert_visible_count());
     }
 }
 
 // ======= Clear Alert =======
 void clear_alert() {
-    alert_active = false;
-    alert_message = "";
-
-    // Clear the alert message from the display
-    // Redraw the current menu
-    draw_menu(
-        (current_menu == MAIN_MENU) ? "Main Menu" :
-        (current_menu == DEVICES_MENU) ? "Devices" :
-        "Scenes",
-        (current_menu == MAIN_MENU) ? main_menu_items :
-        (current_menu == DEVICES_MENU) ? devices_menu_items :
-        scenes_menu_items,
-        (current_menu == MAIN_MENU) ? 4 :
-        (current_menu == DEVICES_MENU) ? (num_devices + 1) :
-        (num_scenes + 1)
-    );
+    // Acknowledge the visible alerts; the menu is redrawn without them
+    if (alert_acknowledge_all()) {
+        state_alerts_changed();
+    }
 }
 
 // ======= Handle Screen Timeout =======
 void handle_screen_timeout() {
     unsigned long current_time = millis();
-    if (!alert_active && (current_time - last_activity_time > SCREEN_TIMEOUT) && !screen_asleep) {
+    if (!alert_any_visible() && (current_time - last_activity_time > SCREEN_TIMEOUT) && !screen_asleep) {
         sleep_screen();
     } else if ((current_time - last_activity_time <= SCREEN_TIMEOUT) && screen_asleep) {
         wakeup_screen();
@@ -309,43 +864,81 @@ void sleep_screen() {
     M5.Lcd.sleep();                       // Put the LCD to sleep
     M5.Lcd.fillScreen(TFT_BLACK);        // Ensure the screen is blacked out
     screen_asleep = true;
-    Serial.println("Screen asleep due to inactivity.");
+    LOG_DEBUG("Screen asleep due to inactivity.");
 }
 
 // ======= Wake Up Screen =======
 void wakeup_screen() {
     M5.Lcd.wakeup();                      // Wake the LCD up
     M5.Lcd.fillScreen(TFT_BLACK);        // Redraw the screen if necessary
-    draw_menu(
-        (current_menu == MAIN_MENU) ? "Main Menu" :
-        (current_menu == DEVICES_MENU) ? "Devices" :
-        "Scenes",
-        (current_menu == MAIN_MENU) ? main_menu_items :
-        (current_menu == DEVICES_MENU) ? devices_menu_items :
-        scenes_menu_items,
-        (current_menu == MAIN_MENU) ? 4 :
-        (current_menu == DEVICES_MENU) ? (num_devices + 1) :
-        (num_scenes + 1)
-    );
+    render_invalidate();
     screen_asleep = false;
-    Serial.println("Screen woke up due to user interaction.");
+    LOG_DEBUG("Screen woke up due to user interaction.");
+}
+
+// ======= Renderer =======
+// Paints the state store. Each call takes one snapshot and compares its
+// slice versions with those last drawn: a new screen, selection or alert
+// set repaints the whole menu; otherwise only the device state column, the
+// status bar or the flashing alert lines are redrawn, if they changed.
+void render_ui() {
+    if (screen_asleep) return;
+    UiState state;
+    state_snapshot(&state);
+
+    bool changed[SLICE_COUNT];
+    for (int i = 0; i < SLICE_COUNT; i++) {
+        changed[i] = render_all || state.slice_version[i] != drawn_versions[i];
+    }
+    bool alerts = alert_any_visible();
+    // Device states under the alert overlay would paint over it
+    bool devices = changed[SLICE_DEVICES] && state.menu == DEVICES_MENU;
+    if (changed[SLICE_MENU] || changed[SLICE_ALERTS] || (devices && alerts)) {
+        draw_menu(state);
+    } else {
+        if (devices) draw_device_states(state);
+        if (changed[SLICE_DOORS] && !alerts) draw_status_bar(state);
+        if (changed[SLICE_ALERT_FLASH] && alerts) handle_alert(state);
+    }
+    memcpy(drawn_versions, state.slice_version, sizeof(drawn_versions));
+    render_all = false;
+}
+
+// Repaint everything on the next render_ui(), e.g. after a toast
+void render_invalidate() {
+    render_all = true;
 }
 
 // ======= Menu Drawing =======
-void draw_menu(const char* title, const char* items[], int num_items) {
+const char* menu_title(uint8_t menu) {
+    return menu == MAIN_MENU ? "Main Menu" : menu == DEVICES_MENU ? "Devices" : "Scenes";
+}
+
+const char** menu_items(uint8_t menu) {
+    return menu == MAIN_MENU ? main_menu_items : menu == DEVICES_MENU ? devices_menu_items : scenes_menu_items;
+}
+
+int menu_item_count(uint8_t menu) {
+    return menu == MAIN_MENU ? 4 : menu == DEVICES_MENU ? (num_devices + 1) : (num_scenes + 1);
+}
+
+void draw_menu(const UiState& state) {
+    TRACE_SCOPE(TRACE_DRAW_MENU);
+    metrics_count_redraw();
     M5.Lcd.fillScreen(TFT_BLACK);
     M5.Lcd.setTextSize(2);
     M5.Lcd.setTextColor(TFT_WHITE, TFT_BLACK);
     M5.Lcd.setCursor(10, 10);
-    M5.Lcd.println(title);
+    M5.Lcd.println(menu_title(state.menu));
 
-    int start_index = scroll_offset;
-    int end_index = min(scroll_offset + max_visible_items, num_items);
+    const char** items = menu_items(state.menu);
+    int start_index = state.scroll_offset;
+    int end_index = min(start_index + max_visible_items, menu_item_count(state.menu));
 
     for (int i = start_index; i < end_index; i++) {
-        int y = MENU_TOP_OFFSET + (i - scroll_offset) * LINE_HEIGHT;
+        int y = MENU_TOP_OFFSET + (i - start_index) * LINE_HEIGHT;
         M5.Lcd.setCursor(20, y);
-        if (i == selected_index) {
+        if (i == state.selected_index) {
             M5.Lcd.setTextColor(TFT_YELLOW, TFT_BLACK);
             M5.Lcd.printf("> %s", items[i]);
         } else {
@@ -353,32 +946,54 @@ void draw_menu(const char* title, const char* items[], int num_items) {
             M5.Lcd.printf("  %s", items[i]);
         }
     }
+    if (state.menu == DEVICES_MENU) {
+        draw_device_states(state);
+    }
 
     // Handle Alerts
-    if (alert_active) {
-        handle_alert();
+    if (alert_any_visible()) {
+        handle_alert(state);
     } else {
-        draw_status_bar();
+        draw_status_bar(state);
+    }
+
+    // The frame is on the panel once any DMA transfer has drained
+    M5.Lcd.waitDMA();
+    ui_latency_frame_done();
+}
+
+// ON/OFF at the end of each visible device row
+void draw_device_states(const UiState& state) {
+    M5.Lcd.setTextSize(2);
+    int end_index = min(state.scroll_offset + max_visible_items, num_devices);
+    for (int i = state.scroll_offset; i < end_index; i++) {
+        bool on = state_device_on(state, i);
+        M5.Lcd.setTextColor(on ? TFT_GREEN : TFT_DARKGRAY, TFT_BLACK);
+        M5.Lcd.setCursor(DEVICE_STATE_X, MENU_TOP_OFFSET + (i - state.scroll_offset) * LINE_HEIGHT);
+        M5.Lcd.print(on ? " ON" : "OFF");
     }
 }
 
 // ======= Status Bar =======
-void draw_status_bar() {
+void draw_status_bar(const UiState& state) {
+    TRACE_SCOPE(TRACE_DRAW_STATUS_BAR);
     // Clear the status bar area
     M5.Lcd.fillRect(0, SCREEN_HEIGHT - STATUS_BAR_HEIGHT, SCREEN_WIDTH, STATUS_BAR_HEIGHT, TFT_DARKGRAY);
     M5.Lcd.setTextSize(2);
     M5.Lcd.setTextColor(TFT_WHITE, TFT_DARKGRAY);
     M5.Lcd.setCursor(10, SCREEN_HEIGHT - STATUS_BAR_HEIGHT + 10);
-    M5.Lcd.printf("FRZR: %s  FRDG: %s", freezer_open ? "OPEN" : "CLOSED", fridge_open ? "OPEN" : "CLOSED");
+    M5.Lcd.printf("FRZR: %s  FRDG: %s",
+                  state_door_open(state, FREEZER_SENSOR) ? "OPEN" : "CLOSED",
+                  state_door_open(state, FRIDGE_SENSOR) ? "OPEN" : "CLOSED");
+    draw_link_rtt(true);
 }
 
 // ======= Navigation =======
 void navigate_menu(int direction) {
-    int num_items = (current_menu == MAIN_MENU) ? 4 :
-                    (current_menu == DEVICES_MENU) ? (num_devices + 1) :
-                    (num_scenes + 1);
-
-    selected_index = (selected_index + direction + num_items) % num_items;
+    const UiState& state = state_current();
+    int num_items = menu_item_count(state.menu);
+    int selected_index = (state.selected_index + direction + num_items) % num_items;
+    int scroll_offset = state.scroll_offset;
 
     // Adjust scroll offset
     if (selected_index < scroll_offset) {
@@ -386,110 +1001,285 @@ void navigate_menu(int direction) {
     } else if (selected_index >= scroll_offset + max_visible_items) {
         scroll_offset = selected_index - max_visible_items + 1;
     }
-
-    if (current_menu == MAIN_MENU) draw_menu("Main Menu", main_menu_items, 4);
-    else if (current_menu == DEVICES_MENU) draw_menu("Devices", devices_menu_items, num_devices + 1);
-    else if (current_menu == SCENES_MENU) draw_menu("Scenes", scenes_menu_items, num_scenes + 1);
+    state_set_menu(state.menu, selected_index, scroll_offset);
 }
 
 // ======= Menu Selection =======
 void select_menu_item() {
-    if (current_menu == MAIN_MENU) {
+    uint8_t menu = state_current().menu;
+    int selected_index = state_current().selected_index;
+    if (menu == MAIN_MENU) {
         if (selected_index == 0) {
-            current_menu = DEVICES_MENU;
+            menu = DEVICES_MENU;
         }
         else if (selected_index == 1) {
-            current_menu = SCENES_MENU;
+            menu = SCENES_MENU;
         }
         else if (selected_index == 2) {
             power_off_all_devices();
         }
         else {
             M5.Lcd.fillScreen(TFT_BLACK); // Exit
+            render_invalidate();
             // Optionally, implement an exit function or power off
             // For example, enter deep sleep or reset
             // ESP.restart(); // Uncomment to restart the device
         }
-    } else if (current_menu == DEVICES_MENU) {
+    } else if (menu == DEVICES_MENU) {
         if (selected_index == num_devices) {
-            current_menu = MAIN_MENU; // Back
+            menu = MAIN_MENU; // Back
         }
         else {
             toggle_device(selected_index);
         }
-    } else if (current_menu == SCENES_MENU) {
+    } else if (menu == SCENES_MENU) {
         if (selected_index == num_scenes) {
-            current_menu = MAIN_MENU; // Back
+            menu = MAIN_MENU; // Back
         }
         else {
             apply_scene(selected_index);
         }
     }
-    selected_index = 0;  // Reset selection on menu change
-    scroll_offset = 0;   // Reset scroll offset on menu change
-    navigate_menu(0);    // Redraw menu
+    // Reset selection and scroll offset on every select
+    state_set_menu(menu, 0, 0);
 }
 
 // ======= Power Off All Devices =======
 void power_off_all_devices() {
     // Loop through each device and send OFF message
     for (int i = 0; i < num_devices; i++) {
-        devices[i].is_active = false;
-        mqtt_client.publish(devices[i].control_topic, "OFF");
-
-        // Debugging: Print device power off message
-        Serial.print("Turning off device: ");
-        Serial.println(devices[i].name);
+        set_device(devices[i], false);
+        LOG_INFO("Turning off device: %s", devices[i].name);
     }
     // Optionally, provide user feedback
+    show_toast("All Devices Off", 2000);
+}
+
+// ======= Toast =======
+// Show a one-line confirmation for `duration` milliseconds
+void show_toast(const ToastText& text, unsigned long duration) {
+    mqtt_transport.flush(); // Send the command being confirmed before drawing and blocking
     M5.Lcd.fillScreen(TFT_BLACK);
     M5.Lcd.setTextSize(2);
     M5.Lcd.setTextColor(TFT_WHITE, TFT_BLACK);
     M5.Lcd.setCursor(10, SCREEN_HEIGHT / 2 - 10);
-    M5.Lcd.println("All Devices Off");
-    delay(2000); // Display message for 2 seconds
-    navigate_menu(0); // Return to main menu
+    M5.Lcd.print(text.c_str());
+    M5.Lcd.waitDMA();
+    ui_latency_frame_done();
+    delay(duration);
+    render_invalidate(); // The menu comes back on the next render_ui()
 }
 
 // ======= Toggle Device =======
 void toggle_device(int index) {
     if (index >= 0 && index < num_devices) {
-        devices[index].is_active = !devices[index].is_active;
-        mqtt_client.publish(devices[index].control_topic, devices[index].is_active ? "ON" : "OFF");
+        ui_latency_classify(UI_ACTION_TOGGLE);
+        Device& device = devices[index];
+        set_device(device, !device_on(device));
 
-        // Debugging: Print device state and published message
-        Serial.print("Toggling device: ");
-        Serial.print(devices[index].name);
-        Serial.print(" State: ");
-        Serial.println(devices[index].is_active ? "ON" : "OFF");
+        LOG_INFO("Toggling device: %s State: %s", device.name, device_on(device) ? "ON" : "OFF");
 
         // Optionally, provide user feedback
-        M5.Lcd.fillScreen(TFT_BLACK);
-        M5.Lcd.setTextSize(2);
-        M5.Lcd.setTextColor(TFT_WHITE, TFT_BLACK);
-        M5.Lcd.setCursor(10, SCREEN_HEIGHT / 2 - 10);
-        M5.Lcd.printf("%s %s", devices[index].name, devices[index].is_active ? "ON" : "OFF");
-        delay(1000); // Display message for 1 second
-        navigate_menu(0); // Return to previous menu
+        ToastText text;
+        text.format("%s %s", device.name, device_on(device) ? "ON" : "OFF");
+        show_toast(text, 1000);
+    }
+}
+
+// ======= Set Device State =======
+// Record the new state, (re)arm or cancel the auto-off timer and send the command
+bool set_device(Device& device, bool on, OutboundLane lane) {
+    state_set_device(&device - devices, on);
+    if (on && device.auto_off_time > 0) {
+        timers.arm(device.auto_off_timer, device.auto_off_time, auto_off_device, &device);
+    } else {
+        timers.cancel(device.auto_off_timer);
     }
+    return mqtt_publish(lane, device.control_topic, on ? "ON" : "OFF");
+}
+
+// ======= Device Auto-Off =======
+void auto_off_device(void* arg) {
+    Device& device = *(Device*)arg;
+    if (!device_on(device)) return;
+    set_device(device, false, LANE_SCENE);
+    LOG_INFO("Auto-off device: %s", device.name);
 }
 
 // ======= Apply Scene =======
 void apply_scene(int index) {
     if (index >= 0 && index < num_scenes) {
-        mqtt_client.publish(scenes_control_topic, scenes[index]);
+        const Scene& scene = scenes[index];
+        unsigned long start = micros();
+        int commands = 0;
+
+        if (scene.targets) {
+            // Send only the commands that change a device, back to back
+            for (int i = 0; i < num_devices && scene.targets[i] != '\0'; i++) {
+                char target = scene.targets[i];
+                if (target == '-' || (target == '1') == device_on(devices[i])) continue;
+                set_device(devices[i], target == '1', LANE_SCENE);
+                commands++;
+            }
+        } else {
+            mqtt_publish(LANE_SCENE, scenes_control_topic, scene.name);
+            commands = 1;
+        }
 
-        // Debugging: Print applied scene
-        Serial.print("Applying scene: ");
-        Serial.println(scenes[index]);
+        LOG_INFO("Applying scene: %s (%d commands in %lu us)", scene.name, commands, micros() - start);
 
         // Optionally, provide user feedback
-        M5.Lcd.fillScreen(TFT_BLACK);
-        M5.Lcd.setTextSize(2);
-        M5.Lcd.setTextColor(TFT_WHITE, TFT_BLACK);
-        M5.Lcd.setCursor(10, SCREEN_HEIGHT / 2 - 10);
-        M5.Lcd.printf("Scene: %s", scenes[index]);
-        delay(2000); // Display message for 2 seconds
-        navigate_menu(0); // Return to previous menu
+        ToastText text;
+        text.format("Scene: %s", scene.name);
+        show_toast(text, 2000);
+    }
+}
+
+// ======= Heap Telemetry =======
+void report_heap() {
+    LogPrint heap_log(LOG_LEVEL_INFO);
+    heap_monitor_print(heap_log);
+
+    char payload[384];
+    size_t len = heap_monitor_format(payload, sizeof(payload));
+    if (telemetry_mqtt().connected()) {
+        mqtt_publish(LANE_TELEMETRY, heap_status_topic, (const uint8_t*)payload, len, true);
+    }
+}
+
+// ======= Metrics =======
+void report_metrics() {
+    char payload[224];
+    int rssi = WiFi.RSSI();
+    link_monitor_set_rssi(rssi);
+    size_t len = metrics_format(payload, sizeof(payload), rssi, ESP.getFreeHeap());
+    if (telemetry_mqtt().connected()) {
+        mqtt_publish(LANE_TELEMETRY, metrics_topic, (const uint8_t*)payload, len, false);
+    }
+}
+
+// ======= MQTT Publish =======
+bool mqtt_publish(OutboundLane lane, const char* topic, const char* payload, bool retained) {
+    return mqtt_publish(lane, topic, (const uint8_t*)payload, strlen(payload), retained);
+}
+
+// Publishes are scheduled by lane; see outbound.h
+bool mqtt_publish(OutboundLane lane, const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    return outbound_publish(lane, topic, payload, length, retained);
+}
+
+// Write one message to the broker now; only called by the outbound scheduler
+bool mqtt_send(OutboundLane lane, const char* topic, const uint8_t* payload, size_t length, bool retained) {
+    TRACE_SCOPE(TRACE_PUBLISH);
+#ifdef FAULT_INJECTION
+    fault_sim_count_command();
+#endif
+    MqttSession& client = lane == LANE_TELEMETRY ? telemetry_mqtt() : mqtt_client;
+    // Commands and scenes are acknowledged and retried; telemetry and RTT
+    // probes are not worth a retry
+    uint8_t qos = lane != LANE_TELEMETRY && topic != rtt_topic &&
+                  mqtt_publish_size(strlen(topic), length, 1) <= MQTT_INFLIGHT_PACKET ? 1 : 0;
+    bool ok = client.publish(topic, payload, length, retained, qos);
+    if (ok) {
+        metrics_count_out();
+        if (topic != log_topic) {
+            last_control_publish = millis();
+        }
+    }
+    return ok;
+}
+
+// ======= Log Shipping =======
+void ship_logs() {
+    const uint8_t* chunk;
+    size_t len;
+    if (!telemetry_mqtt().connected() || !log_ship_poll(last_control_publish, &chunk, &len)) {
+        return;
+    }
+    log_ship_done(mqtt_publish(LANE_TELEMETRY, log_topic, chunk, len, false));
+}
+
+// ======= OTA Update =======
+void run_pending_ota() {
+    if (pending_ota_url.empty()) return;
+
+    HeapAllocAllowed allow_alloc; // HTTP client and flash writes
+    LOG_INFO("OTA: applying delta from %s", pending_ota_url.c_str());
+    if (screen_asleep) wakeup_screen();
+    show_toast("Updating...", 0);
+    OtaResult result = ota_delta_update(pending_ota_url.c_str(), ota_signing_key);
+    pending_ota_url.clear();
+
+    if (result == OTA_OK) {
+        LOG_INFO("OTA: update verified, restarting");
+        mqtt_transport.flush();
+        delay(500); // Let the log drain before the reset
+        ESP.restart();
+    }
+    LOG_ERROR("OTA: update failed: %s", ota_result_name(result));
+    show_toast("Update Failed", 2000);
+}
+
+// ======= Serial Commands =======
+// Single-character diagnostic commands:
+//   h - print heap telemetry
+//   t - dump the trace buffer (convert with tools/trace_to_chrome.py)
+//   l - print logging and log-shipping statistics
+//   b - print broker RTTs and health, and the link probe state
+//   u - print input-to-photon latency histograms per UI action and state store versions
+//   o - print outbound lane and write-coalescing counters
+//   s - print subscription manager state
+//   f - start the next fault-injection scenario (FAULT_INJECTION builds)
+void handle_serial_commands() {
+    while (Serial.available() > 0) {
+        switch (Serial.read()) {
+            case 'h':
+                heap_monitor_print(Serial);
+                break;
+            case 't':
+                trace_dump(Serial);
+                break;
+            case 'b':
+                broker_pool_print(Serial, current_broker);
+                link_monitor_print(Serial);
+                mqtt_client.print(Serial);
+#ifdef TELEMETRY_CONNECTION
+                Serial.printf("Telemetry connection: %s\n", telemetry_client.connected() ? "up" : "down");
+                telemetry_client.print(Serial);
+#endif
+                break;
+            case 'u':
+                ui_latency_print(Serial);
+                state_print(Serial);
+                break;
+            case 'o': {
+                outbound_print(Serial);
+                const CoalesceStats& cs = mqtt_transport.stats();
+                Serial.printf("Transport: writes=%lu sends=%lu bytes=%lu\n", (unsigned long)cs.writes,
+                              (unsigned long)cs.sends, (unsigned long)cs.bytes);
+                break;
+            }
+            case 's':
+                subs_print(Serial);
+                break;
+            case 'l': {
+                LogStats ls = log_stats();
+                Serial.printf("Log: records=%lu dropped=%lu high_water=%lu/%d\n",
+                              (unsigned long)ls.records, (unsigned long)ls.dropped,
+                              (unsigned long)ls.high_water, LOG_BUFFER_SIZE);
+                LogShipStats ss = log_ship_stats();
+                Serial.printf("Log shipping: chunks=%lu raw=%lu sent=%lu dropped=%lu\n",
+                              (unsigned long)ss.chunks, (unsigned long)ss.raw_bytes,
+                              (unsigned long)ss.sent_bytes, (unsigned long)ss.dropped);
+                break;
+            }
+#ifdef FAULT_INJECTION
+            case 'f':
+                fault_sim_start_next(fault_client);
+                break;
+#endif
+            default:
+                break;
+        }
     }
 }
@@ -0,0 +1,15 @@
+#include "memory_budget.h"
+
+void memory_budget_print(Print& out, const MemoryBudget* budgets, int count) {
+    size_t total = 0;
+    out.println("Static memory budget:");
+    for (int i = 0; i < count; i++) {
+        const MemoryBudget& b = budgets[i];
+        out.printf("  %-14s %6lu / %6lu bytes (%lu%%)\n", b.subsystem,
+                   (unsigned long)b.bytes, (unsigned long)b.budget,
+                   (unsigned long)(b.budget ? b.bytes * 100 / b.budget : 0));
+        total += b.bytes;
+    }
+    out.printf("  %-14s %6lu / %6lu bytes\n", "Total", (unsigned long)total, (unsigned long)BUDGET_TOTAL);
+    out.printf("  Free heap after setup: %lu bytes\n", (unsigned long)ESP.getFreeHeap());
+}
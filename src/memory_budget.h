@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+
+// ======= Memory Budget =======
+// Per-subsystem static RAM budgets. main.cpp sums each subsystem's static
+// allocations at compile time and static_asserts them against these limits,
+// so growing a table or adding a sprite fails the build instead of showing
+// up later as a low-heap reset. Override any limit with -D.
+
+#ifndef BUDGET_DEVICE_TABLES
+#define BUDGET_DEVICE_TABLES 2048
+#endif
+#ifndef BUDGET_MQTT
+#define BUDGET_MQTT 6144
+#endif
+#ifndef BUDGET_DISPLAY
+#define BUDGET_DISPLAY 32768
+#endif
+#ifndef BUDGET_UI_TEXT
+#define BUDGET_UI_TEXT 4096
+#endif
+#ifndef BUDGET_TIMERS
+#define BUDGET_TIMERS 2048
+#endif
+#ifndef BUDGET_LOGGING
+#define BUDGET_LOGGING 12288
+#endif
+#ifndef BUDGET_DIAGNOSTICS
+#define BUDGET_DIAGNOSTICS 12288
+#endif
+#ifndef BUDGET_OTA
+#define BUDGET_OTA 8192
+#endif
+#ifndef BUDGET_TOTAL
+#define BUDGET_TOTAL 65536
+#endif
+
+struct MemoryBudget {
+    const char* subsystem;
+    size_t bytes;
+    size_t budget;
+};
+
+// Print the per-subsystem breakdown, totals and current free heap
+void memory_budget_print(Print& out, const MemoryBudget* budgets, int count);
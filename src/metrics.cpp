@@ -0,0 +1,78 @@
+#include "metrics.h"
+
+MetricsCounters metrics;
+
+static MetricsWindow window = {0, 0, 0, 0, 0, 0};
+static unsigned long window_start = 0;
+static uint32_t last_in = 0;
+static uint32_t last_out = 0;
+
+static_assert(sizeof(metrics) + sizeof(window) + sizeof(window_start) + sizeof(last_in) + sizeof(last_out) ==
+                  METRICS_STATIC_BYTES,
+              "METRICS_STATIC_BYTES must count every static above");
+
+void metrics_record_loop(uint32_t elapsed_us) {
+    int bucket = 0;
+    while (bucket < LOOP_TIME_BUCKETS - 1 && elapsed_us >= (1UL << (bucket + 1))) {
+        bucket++;
+    }
+    metrics.loop_time_hist[bucket].fetch_add(1, std::memory_order_relaxed);
+    metrics.loops.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool metrics_poll() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - window_start;
+    if (elapsed < METRICS_INTERVAL_MS) {
+        return false;
+    }
+    window_start = now;
+
+    // Drain the loop histogram for this window and locate p99
+    uint32_t counts[LOOP_TIME_BUCKETS];
+    uint32_t loops = 0;
+    for (int i = 0; i < LOOP_TIME_BUCKETS; i++) {
+        counts[i] = metrics.loop_time_hist[i].exchange(0, std::memory_order_relaxed);
+        loops += counts[i];
+    }
+    metrics.loops.store(0, std::memory_order_relaxed);
+
+    uint32_t threshold = loops - loops / 100;
+    uint32_t seen = 0;
+    window.loop_p99_us = 0;
+    for (int i = 0; i < LOOP_TIME_BUCKETS && loops > 0; i++) {
+        seen += counts[i];
+        if (seen >= threshold) {
+            window.loop_p99_us = 1UL << (i + 1);
+            break;
+        }
+    }
+
+    uint32_t in = metrics.messages_in.load(std::memory_order_relaxed);
+    uint32_t out = metrics.messages_out.load(std::memory_order_relaxed);
+    window.loop_rate = (uint32_t)((uint64_t)loops * 1000 / elapsed);
+    window.in_per_sec = (uint32_t)((uint64_t)(in - last_in) * 1000 / elapsed);
+    window.out_per_sec = (uint32_t)((uint64_t)(out - last_out) * 1000 / elapsed);
+    window.redraws = metrics.redraws.load(std::memory_order_relaxed);
+    window.reconnects = metrics.reconnects.load(std::memory_order_relaxed);
+    last_in = in;
+    last_out = out;
+    return true;
+}
+
+size_t metrics_format(char* buf, size_t len, int rssi, uint32_t free_heap) {
+    int n = snprintf(buf, len,
+                     "{\"loop_hz\":%lu,\"loop_p99_us\":%lu,\"in_ps\":%lu,\"out_ps\":%lu,"
+                     "\"redraws\":%lu,\"reconnects\":%lu,\"rssi\":%d,\"heap\":%lu,\"uptime\":%lu}",
+                     (unsigned long)window.loop_rate,
+                     (unsigned long)window.loop_p99_us,
+                     (unsigned long)window.in_per_sec,
+                     (unsigned long)window.out_per_sec,
+                     (unsigned long)window.redraws,
+                     (unsigned long)window.reconnects,
+                     rssi,
+                     (unsigned long)free_heap,
+                     millis() / 1000);
+    if (n < 0) return 0;
+    return (size_t)n < len ? (size_t)n : len - 1;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ======= Metrics =======
+// Lock-free counters for the periodic metrics document published on the
+// metrics topic. All state is statically allocated and the payload is
+// serialized into a caller-provided buffer.
+
+#ifndef METRICS_INTERVAL_MS
+#define METRICS_INTERVAL_MS 10000 // Publish interval, override with -DMETRICS_INTERVAL_MS
+#endif
+
+const int LOOP_TIME_BUCKETS = 24; // Power-of-two microsecond buckets, up to ~16 s
+
+struct MetricsCounters {
+    std::atomic<uint32_t> loops;
+    std::atomic<uint32_t> messages_in;
+    std::atomic<uint32_t> messages_out;
+    std::atomic<uint32_t> redraws;
+    std::atomic<uint32_t> reconnects;
+    std::atomic<uint32_t> loop_time_hist[LOOP_TIME_BUCKETS];
+};
+
+extern MetricsCounters metrics;
+
+// Snapshot of the last closed window, computed in metrics_poll()
+struct MetricsWindow {
+    uint32_t loop_rate;      // loops per second
+    uint32_t loop_p99_us;    // upper bound of the p99 bucket
+    uint32_t in_per_sec;
+    uint32_t out_per_sec;
+    uint32_t redraws;        // totals since boot
+    uint32_t reconnects;
+};
+
+// The counters, the last window and the totals it was computed from
+const size_t METRICS_STATIC_BYTES = sizeof(MetricsCounters) + sizeof(MetricsWindow) + sizeof(unsigned long) +
+                                    2 * sizeof(uint32_t);
+
+inline void metrics_count_in() { metrics.messages_in.fetch_add(1, std::memory_order_relaxed); }
+inline void metrics_count_out() { metrics.messages_out.fetch_add(1, std::memory_order_relaxed); }
+inline void metrics_count_redraw() { metrics.redraws.fetch_add(1, std::memory_order_relaxed); }
+inline void metrics_count_reconnect() { metrics.reconnects.fetch_add(1, std::memory_order_relaxed); }
+
+// Record one loop() iteration that took `elapsed_us` microseconds.
+void metrics_record_loop(uint32_t elapsed_us);
+
+// Returns true once per METRICS_INTERVAL_MS, after closing the current window.
+bool metrics_poll();
+
+// Serialize the last closed window. Returns the payload length.
+size_t metrics_format(char* buf, size_t len, int rssi, uint32_t free_heap);
@@ -0,0 +1,201 @@
+#include "mqtt_codec.h"
+
+// ======= Parsing =======
+// Flags fixed by the spec for every type but PUBLISH
+static bool flags_valid(uint8_t type, uint8_t flags) {
+    switch (type) {
+        case MQTT_PKT_PUBLISH:
+            return (flags & 0x06) != 0x06; // QoS 3 does not exist
+        case MQTT_PKT_PUBREL:
+        case MQTT_PKT_SUBSCRIBE:
+        case MQTT_PKT_UNSUBSCRIBE:
+            return flags == 0x02;
+        default:
+            return flags == 0;
+    }
+}
+
+MqttParseResult mqtt_parse_header(const uint8_t* buf, size_t len, MqttHeader* out) {
+    if (len < 2) return MQTT_PARSE_INCOMPLETE;
+    uint8_t type = buf[0] >> 4;
+    uint8_t flags = buf[0] & 0x0F;
+    if (type < MQTT_PKT_CONNECT || type > MQTT_PKT_DISCONNECT || !flags_valid(type, flags)) {
+        return MQTT_PARSE_MALFORMED;
+    }
+
+    // Remaining length: 7 bits per byte, low bits first, at most four bytes
+    size_t remaining = 0;
+    size_t i = 1;
+    uint8_t digit;
+    do {
+        if (i == MQTT_MAX_HEADER) return MQTT_PARSE_MALFORMED;
+        if (i == len) return MQTT_PARSE_INCOMPLETE;
+        digit = buf[i];
+        remaining |= (size_t)(digit & 0x7F) << (7 * (i - 1));
+        i++;
+    } while (digit & 0x80);
+
+    out->type = type;
+    out->flags = flags;
+    out->header_len = i;
+    out->remaining = remaining;
+    return MQTT_PARSE_OK;
+}
+
+MqttParseResult mqtt_parse_publish(const MqttHeader& header, const uint8_t* body, MqttPublish* out) {
+    if (header.type != MQTT_PKT_PUBLISH) return MQTT_PARSE_MALFORMED;
+    uint8_t qos = (header.flags >> 1) & 0x03;
+    size_t len = header.remaining;
+    if (len < 2) return MQTT_PARSE_MALFORMED;
+    size_t topic_len = (body[0] << 8) | body[1];
+    size_t pos = 2 + topic_len;
+    if (topic_len == 0 || pos > len) return MQTT_PARSE_MALFORMED;
+    // Wildcards only belong in filters
+    if (memchr(body + 2, '+', topic_len) || memchr(body + 2, '#', topic_len)) return MQTT_PARSE_MALFORMED;
+
+    uint16_t packet_id = 0;
+    if (qos > 0) {
+        if (pos + 2 > len) return MQTT_PARSE_MALFORMED;
+        packet_id = (body[pos] << 8) | body[pos + 1];
+        if (packet_id == 0) return MQTT_PARSE_MALFORMED;
+        pos += 2;
+    }
+
+    out->topic.data = body + 2;
+    out->topic.len = topic_len;
+    out->payload.data = body + pos;
+    out->payload.len = len - pos;
+    out->packet_id = packet_id;
+    out->qos = qos;
+    out->retain = header.flags & 0x01;
+    out->dup = header.flags & 0x08;
+    return MQTT_PARSE_OK;
+}
+
+MqttParseResult mqtt_parse_connack(const MqttHeader& header, const uint8_t* body, bool* session_present,
+                                   uint8_t* return_code) {
+    if (header.type != MQTT_PKT_CONNACK || header.remaining != 2 || (body[0] & 0xFE)) {
+        return MQTT_PARSE_MALFORMED;
+    }
+    *session_present = body[0] & 0x01;
+    *return_code = body[1];
+    return MQTT_PARSE_OK;
+}
+
+MqttParseResult mqtt_parse_suback(const MqttHeader& header, const uint8_t* body, uint16_t* packet_id,
+                                  MqttView* return_codes) {
+    if (header.type != MQTT_PKT_SUBACK || header.remaining < 3) return MQTT_PARSE_MALFORMED;
+    *packet_id = (body[0] << 8) | body[1];
+    return_codes->data = body + 2;
+    return_codes->len = header.remaining - 2;
+    return MQTT_PARSE_OK;
+}
+
+MqttParseResult mqtt_parse_ack(const MqttHeader& header, const uint8_t* body, uint16_t* packet_id) {
+    switch (header.type) {
+        case MQTT_PKT_PUBACK:
+        case MQTT_PKT_PUBREC:
+        case MQTT_PKT_PUBREL:
+        case MQTT_PKT_PUBCOMP:
+        case MQTT_PKT_UNSUBACK:
+            break;
+        default:
+            return MQTT_PARSE_MALFORMED;
+    }
+    if (header.remaining != 2) return MQTT_PARSE_MALFORMED;
+    *packet_id = (body[0] << 8) | body[1];
+    return MQTT_PARSE_OK;
+}
+
+// ======= Encoding =======
+static size_t length_bytes(size_t remaining) {
+    return remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+}
+
+size_t mqtt_encode_header(uint8_t* out, uint8_t first_byte, size_t remaining) {
+    size_t n = 0;
+    out[n++] = first_byte;
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        if (remaining > 0) digit |= 0x80;
+        out[n++] = digit;
+    } while (remaining > 0);
+    return n;
+}
+
+size_t mqtt_encode_connect(uint8_t* out, size_t size, const char* client_id, const char* user,
+                           const char* password, uint16_t keepalive, bool clean_session) {
+    size_t id_len = strlen(client_id);
+    size_t user_len = user ? strlen(user) : 0;
+    size_t password_len = password ? strlen(password) : 0;
+    // Protocol name and level, flags, keepalive, then the payload fields
+    size_t remaining = 10 + 2 + id_len + (user ? 2 + user_len : 0) + (password ? 2 + password_len : 0);
+    if (1 + length_bytes(remaining) + remaining > size) return 0;
+
+    uint8_t flags = clean_session ? 0x02 : 0;
+    if (user) flags |= 0x80;
+    if (password) flags |= 0x40;
+
+    uint8_t* p = out + mqtt_encode_header(out, MQTT_PKT_CONNECT << 4, remaining);
+    p = mqtt_put_string(p, "MQTT", 4);
+    *p++ = 4; // Protocol level 3.1.1
+    *p++ = flags;
+    p = mqtt_put_u16(p, keepalive);
+    p = mqtt_put_string(p, client_id, id_len);
+    if (user) p = mqtt_put_string(p, user, user_len);
+    if (password) p = mqtt_put_string(p, password, password_len);
+    return p - out;
+}
+
+size_t mqtt_publish_size(size_t topic_len, size_t payload_len, uint8_t qos) {
+    size_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + payload_len;
+    return 1 + length_bytes(remaining) + remaining;
+}
+
+size_t mqtt_encode_publish_header(uint8_t* out, size_t size, const char* topic, size_t payload_len,
+                                  uint8_t qos, bool retain, uint16_t packet_id) {
+    size_t topic_len = strlen(topic);
+    size_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + payload_len;
+    if (1 + length_bytes(remaining) + remaining - payload_len > size) return 0;
+
+    uint8_t first = (MQTT_PKT_PUBLISH << 4) | (qos << 1) | (retain ? 0x01 : 0);
+    uint8_t* p = out + mqtt_encode_header(out, first, remaining);
+    p = mqtt_put_string(p, topic, topic_len);
+    if (qos > 0) p = mqtt_put_u16(p, packet_id);
+    return p - out;
+}
+
+size_t mqtt_encode_publish(uint8_t* out, size_t size, const char* topic, const uint8_t* payload,
+                           size_t payload_len, uint8_t qos, bool retain, uint16_t packet_id) {
+    if (mqtt_publish_size(strlen(topic), payload_len, qos) > size) return 0;
+    size_t n = mqtt_encode_publish_header(out, size, topic, payload_len, qos, retain, packet_id);
+    if (payload_len > 0) memcpy(out + n, payload, payload_len);
+    return n + payload_len;
+}
+
+size_t mqtt_encode_subscribe(uint8_t* out, size_t size, uint16_t packet_id, const char* filter, uint8_t qos) {
+    size_t filter_len = strlen(filter);
+    size_t remaining = 2 + 2 + filter_len + 1;
+    if (1 + length_bytes(remaining) + remaining > size) return 0;
+    uint8_t* p = out + mqtt_encode_header(out, (MQTT_PKT_SUBSCRIBE << 4) | 0x02, remaining);
+    p = mqtt_put_u16(p, packet_id);
+    p = mqtt_put_string(p, filter, filter_len);
+    *p++ = qos;
+    return p - out;
+}
+
+size_t mqtt_encode_ack(uint8_t* out, size_t size, MqttPacketType type, uint16_t packet_id) {
+    if (size < 4) return 0;
+    out[0] = (type << 4) | (type == MQTT_PKT_PUBREL ? 0x02 : 0);
+    out[1] = 2;
+    mqtt_put_u16(out + 2, packet_id);
+    return 4;
+}
+
+size_t mqtt_encode_empty(uint8_t* out, size_t size, MqttPacketType type) {
+    if (size < 2) return 0;
+    out[0] = type << 4;
+    out[1] = 0;
+    return 2;
+}
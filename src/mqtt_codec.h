@@ -0,0 +1,118 @@
+#pragma once
+#include <Arduino.h>
+
+// ======= MQTT 3.1.1 Codec =======
+// Parses packets where they sit in the receive buffer and encodes them into
+// buffers the caller owns; nothing is allocated and nothing is copied on the
+// way in. Topics and payloads come back as views into the parsed bytes, so
+// they are only valid until that buffer is reused, and they are not
+// NUL-terminated. Every parser checks lengths against the bytes it is given
+// and reports a malformed packet instead of reading past them.
+
+enum MqttPacketType {
+    MQTT_PKT_CONNECT = 1,
+    MQTT_PKT_CONNACK,
+    MQTT_PKT_PUBLISH,
+    MQTT_PKT_PUBACK,
+    MQTT_PKT_PUBREC,
+    MQTT_PKT_PUBREL,
+    MQTT_PKT_PUBCOMP,
+    MQTT_PKT_SUBSCRIBE,
+    MQTT_PKT_SUBACK,
+    MQTT_PKT_UNSUBSCRIBE,
+    MQTT_PKT_UNSUBACK,
+    MQTT_PKT_PINGREQ,
+    MQTT_PKT_PINGRESP,
+    MQTT_PKT_DISCONNECT
+};
+
+enum MqttParseResult {
+    MQTT_PARSE_OK,
+    MQTT_PARSE_INCOMPLETE,  // More bytes are needed
+    MQTT_PARSE_MALFORMED    // Protocol violation; the connection should be dropped
+};
+
+const size_t MQTT_MAX_HEADER = 5;  // Type byte plus up to four length bytes
+
+// Bytes inside a packet buffer
+struct MqttView {
+    const uint8_t* data;
+    size_t len;
+
+    bool equals(const char* text) const {
+        return strlen(text) == len && memcmp(data, text, len) == 0;
+    }
+};
+
+struct MqttHeader {
+    uint8_t type;        // MqttPacketType
+    uint8_t flags;       // Low nibble of the first byte
+    size_t header_len;   // Fixed header bytes, 2 to 5
+    size_t remaining;    // Bytes after the fixed header
+};
+
+struct MqttPublish {
+    MqttView topic;
+    MqttView payload;
+    uint16_t packet_id;  // 0 for QoS 0
+    uint8_t qos;
+    bool retain;
+    bool dup;
+};
+
+// ======= Parsing =======
+// Fixed header only; the packet is complete once `len` reaches
+// header_len + remaining
+MqttParseResult mqtt_parse_header(const uint8_t* buf, size_t len, MqttHeader* out);
+
+// `body` holds `header.remaining` bytes
+MqttParseResult mqtt_parse_publish(const MqttHeader& header, const uint8_t* body, MqttPublish* out);
+MqttParseResult mqtt_parse_connack(const MqttHeader& header, const uint8_t* body, bool* session_present,
+                                   uint8_t* return_code);
+MqttParseResult mqtt_parse_suback(const MqttHeader& header, const uint8_t* body, uint16_t* packet_id,
+                                  MqttView* return_codes);
+// PUBACK, PUBREC, PUBREL, PUBCOMP and UNSUBACK
+MqttParseResult mqtt_parse_ack(const MqttHeader& header, const uint8_t* body, uint16_t* packet_id);
+
+// ======= Encoding =======
+// Each encoder returns the bytes written to `out`, or 0 if they don't fit
+// in `size`
+
+inline uint8_t* mqtt_put_u16(uint8_t* p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+    return p + 2;
+}
+
+inline uint8_t* mqtt_put_string(uint8_t* p, const char* text, size_t len) {
+    p = mqtt_put_u16(p, len);
+    memcpy(p, text, len);
+    return p + len;
+}
+
+// Fixed header for a packet of `remaining` bytes; needs MQTT_MAX_HEADER bytes
+size_t mqtt_encode_header(uint8_t* out, uint8_t first_byte, size_t remaining);
+
+// `user` and `password` may be nullptr
+size_t mqtt_encode_connect(uint8_t* out, size_t size, const char* client_id, const char* user,
+                           const char* password, uint16_t keepalive, bool clean_session);
+
+// Whole packet size, to check a publish fits before encoding it
+size_t mqtt_publish_size(size_t topic_len, size_t payload_len, uint8_t qos);
+
+size_t mqtt_encode_publish(uint8_t* out, size_t size, const char* topic, const uint8_t* payload,
+                           size_t payload_len, uint8_t qos, bool retain, uint16_t packet_id);
+
+// Everything up to the payload, for payloads written straight from the
+// caller's memory
+size_t mqtt_encode_publish_header(uint8_t* out, size_t size, const char* topic, size_t payload_len,
+                                  uint8_t qos, bool retain, uint16_t packet_id);
+
+// Single-topic SUBSCRIBE
+size_t mqtt_encode_subscribe(uint8_t* out, size_t size, uint16_t packet_id, const char* filter, uint8_t qos);
+
+// PUBACK and the other two-byte acknowledgements
+size_t mqtt_encode_ack(uint8_t* out, size_t size, MqttPacketType type, uint16_t packet_id);
+
+// PINGREQ and DISCONNECT
+size_t mqtt_encode_empty(uint8_t* out, size_t size, MqttPacketType type);
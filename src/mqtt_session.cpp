@@ -0,0 +1,303 @@
+#include "mqtt_session.h"
+
+// ======= Connection =======
+void MqttSession::set_server(const char* new_host, uint16_t new_port) {
+    host = new_host;
+    port = new_port;
+}
+
+bool MqttSession::connect(const char* client_id, const char* user, const char* password) {
+    if (connected()) return true;
+    if (!host || !client.connect(host, port)) {
+        session_state = MQTT_STATE_CONNECT_FAILED;
+        return false;
+    }
+    rx_len = 0;
+    rx_skip = 0;
+    ping_outstanding = false;
+
+    size_t n = mqtt_encode_connect(tx, tx_size, client_id, user, password, keepalive, true);
+    if (n == 0 || client.write(tx, n) != n) {
+        drop_connection(MQTT_STATE_CONNECT_FAILED);
+        return false;
+    }
+    client.flush();
+
+    // CONNACK is four bytes and the broker sends nothing before it
+    unsigned long start = millis();
+    while (rx_len < 4) {
+        if (!client.connected()) {
+            drop_connection(MQTT_STATE_CONNECT_FAILED);
+            return false;
+        }
+        if (millis() - start >= MQTT_CONNECT_TIMEOUT) {
+            drop_connection(MQTT_STATE_CONNECTION_TIMEOUT);
+            return false;
+        }
+        int got = client.available() > 0 ? client.read(rx + rx_len, 4 - rx_len) : 0;
+        if (got > 0) {
+            rx_len += got;
+        } else {
+            delay(1);
+        }
+    }
+
+    MqttHeader header;
+    bool session_present;
+    uint8_t code;
+    if (mqtt_parse_header(rx, rx_len, &header) != MQTT_PARSE_OK ||
+        mqtt_parse_connack(header, rx + header.header_len, &session_present, &code) != MQTT_PARSE_OK) {
+        counters.malformed++;
+        drop_connection(MQTT_STATE_CONNECT_FAILED);
+        return false;
+    }
+    rx_len = 0;
+    if (code != 0) {
+        drop_connection(code);
+        return false;
+    }
+
+    session_state = MQTT_STATE_CONNECTED;
+    last_in = last_out = millis();
+    counters.packets_in++;
+    counters.packets_out++;
+    // The broker kept nothing of a clean session, so unacknowledged publishes go again
+    resend_inflight(last_in, true);
+    return true;
+}
+
+bool MqttSession::connected() {
+    if (session_state != MQTT_STATE_CONNECTED) return false;
+    if (!client.connected()) {
+        drop_connection(MQTT_STATE_CONNECTION_LOST);
+        return false;
+    }
+    return true;
+}
+
+void MqttSession::disconnect() {
+    uint8_t packet[2];
+    if (session_state == MQTT_STATE_CONNECTED) {
+        write_packet(packet, mqtt_encode_empty(packet, sizeof(packet), MQTT_PKT_DISCONNECT));
+    }
+    drop_connection(MQTT_STATE_DISCONNECTED);
+}
+
+void MqttSession::drop_connection(int new_state) {
+    session_state = new_state;
+    client.flush();
+    client.stop();
+    rx_len = 0;
+    rx_skip = 0;
+    last_in = last_out = millis();
+}
+
+// ======= Loop =======
+bool MqttSession::loop() {
+    if (!connected()) return false;
+    unsigned long now = millis();
+
+    // Same keepalive rule as PubSubClient: ping after a keepalive without
+    // traffic either way, give up if the next one passes unanswered
+    unsigned long interval = keepalive * 1000UL;
+    if (interval && (now - last_in >= interval || now - last_out >= interval)) {
+        if (ping_outstanding) {
+            drop_connection(MQTT_STATE_CONNECTION_TIMEOUT);
+            return false;
+        }
+        uint8_t packet[2];
+        write_packet(packet, mqtt_encode_empty(packet, sizeof(packet), MQTT_PKT_PINGREQ));
+        ping_outstanding = true;
+        last_in = now;
+    }
+
+    resend_inflight(now, false);
+    receive();
+    return connected();
+}
+
+// One read of whatever has arrived, then every complete packet in the buffer
+void MqttSession::receive() {
+    int available = client.available();
+    if (available <= 0) return;
+    int got = client.read(rx + rx_len, min((size_t)available, rx_size - rx_len));
+    if (got <= 0) return;
+    rx_len += got;
+
+    if (rx_skip > 0) {
+        size_t n = min(rx_skip, rx_len);
+        memmove(rx, rx + n, rx_len - n);
+        rx_len -= n;
+        rx_skip -= n;
+    }
+
+    size_t pos = 0;
+    while (pos < rx_len) {
+        MqttHeader header;
+        MqttParseResult result = mqtt_parse_header(rx + pos, rx_len - pos, &header);
+        if (result == MQTT_PARSE_INCOMPLETE) break;
+        if (result == MQTT_PARSE_MALFORMED) {
+            counters.malformed++;
+            drop_connection(MQTT_STATE_CONNECTION_LOST);
+            return;
+        }
+        size_t total = header.header_len + header.remaining;
+        if (total > rx_size) {
+            // Can never fit: discard it as it arrives
+            counters.oversized++;
+            rx_skip = total - (rx_len - pos);
+            rx_len = pos;
+            break;
+        }
+        if (total > rx_len - pos) break;
+
+        last_in = millis();
+        counters.packets_in++;
+        if (!handle_packet(header, rx + pos + header.header_len)) {
+            counters.malformed++;
+            drop_connection(MQTT_STATE_CONNECTION_LOST);
+            return;
+        }
+        if (session_state != MQTT_STATE_CONNECTED) return; // The callback disconnected
+        pos += total;
+    }
+
+    // Keep the start of a partial packet for the next read
+    memmove(rx, rx + pos, rx_len - pos);
+    rx_len -= pos;
+}
+
+bool MqttSession::handle_packet(const MqttHeader& header, const uint8_t* body) {
+    uint16_t packet_id;
+    switch (header.type) {
+        case MQTT_PKT_PUBLISH: {
+            MqttPublish message;
+            if (mqtt_parse_publish(header, body, &message) != MQTT_PARSE_OK) return false;
+            // Nothing is subscribed above QoS 1, so QoS 2 never arrives
+            if (message.qos > 1) return false;
+            if (on_message) on_message(message);
+            if (message.qos == 1 && session_state == MQTT_STATE_CONNECTED) {
+                uint8_t ack[4];
+                write_packet(ack, mqtt_encode_ack(ack, sizeof(ack), MQTT_PKT_PUBACK, message.packet_id));
+            }
+            return true;
+        }
+        case MQTT_PKT_PUBACK:
+            if (mqtt_parse_ack(header, body, &packet_id) != MQTT_PARSE_OK) return false;
+            for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+                if (inflight[i].packet_id == packet_id) {
+                    inflight[i].packet_id = 0;
+                    counters.pubacks++;
+                }
+            }
+            return true;
+        case MQTT_PKT_SUBACK: {
+            MqttView codes;
+            if (mqtt_parse_suback(header, body, &packet_id, &codes) != MQTT_PARSE_OK) return false;
+            counters.subacks++;
+            for (size_t i = 0; i < codes.len; i++) {
+                if (codes.data[i] == 0x80) counters.sub_failures++;
+            }
+            return true;
+        }
+        case MQTT_PKT_UNSUBACK:
+            return mqtt_parse_ack(header, body, &packet_id) == MQTT_PARSE_OK;
+        case MQTT_PKT_PINGRESP:
+            ping_outstanding = false;
+            return header.remaining == 0;
+        default:
+            return false; // Only a client sends the rest; QoS 2 acks can't happen
+    }
+}
+
+// ======= Publishing =======
+uint16_t MqttSession::next_packet_id() {
+    // Skip 0, which is not a valid id, and any id still waiting for its PUBACK
+    for (;;) {
+        if (++last_packet_id == 0) last_packet_id = 1;
+        bool in_use = false;
+        for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+            if (inflight[i].packet_id == last_packet_id) in_use = true;
+        }
+        if (!in_use) return last_packet_id;
+    }
+}
+
+bool MqttSession::write_packet(const uint8_t* packet, size_t length) {
+    if (length == 0 || client.write(packet, length) != length) return false;
+    last_out = millis();
+    counters.packets_out++;
+    return true;
+}
+
+bool MqttSession::publish(const char* topic, const uint8_t* payload, size_t length, bool retained, uint8_t qos) {
+    if (!connected()) return false;
+
+    if (qos > 0) {
+        Inflight* slot = nullptr;
+        for (int i = 0; i < MQTT_INFLIGHT_MAX && !slot; i++) {
+            if (inflight[i].packet_id == 0) slot = &inflight[i];
+        }
+        if (!slot) {
+            counters.inflight_full++;
+            return false;
+        }
+        uint16_t packet_id = next_packet_id();
+        size_t n = mqtt_encode_publish(slot->packet, sizeof(slot->packet), topic, payload, length, 1, retained,
+                                       packet_id);
+        if (!write_packet(slot->packet, n)) return false;
+        slot->packet_id = packet_id;
+        slot->length = n;
+        slot->first_sent = slot->last_sent = last_out;
+        return true;
+    }
+
+    size_t n = mqtt_encode_publish(tx, tx_size, topic, payload, length, 0, retained, 0);
+    if (n > 0) return write_packet(tx, n);
+    n = mqtt_encode_publish_header(tx, tx_size, topic, length, 0, retained, 0);
+    return write_packet(tx, n) && client.write(payload, length) == length;
+}
+
+// Retry late publishes with DUP set, or all of them after a reconnect;
+// drop those that have waited too long to still be wanted
+void MqttSession::resend_inflight(unsigned long now, bool all) {
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+        Inflight& slot = inflight[i];
+        if (slot.packet_id == 0) continue;
+        if (now - slot.first_sent >= MQTT_INFLIGHT_EXPIRY) {
+            slot.packet_id = 0;
+            counters.expired++;
+            continue;
+        }
+        if (!all && now - slot.last_sent < MQTT_RETRY_INTERVAL) continue;
+        slot.packet[0] |= 0x08;
+        if (!write_packet(slot.packet, slot.length)) return;
+        slot.last_sent = now;
+        counters.retransmits++;
+    }
+}
+
+bool MqttSession::subscribe(const char* filter, uint8_t qos) {
+    if (!connected()) return false;
+    return write_packet(tx, mqtt_encode_subscribe(tx, tx_size, next_packet_id(), filter, qos));
+}
+
+// ======= Status =======
+MqttSessionStats MqttSession::stats() const {
+    MqttSessionStats s = counters;
+    s.inflight = 0;
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+        if (inflight[i].packet_id != 0) s.inflight++;
+    }
+    return s;
+}
+
+void MqttSession::print(Print& out) const {
+    MqttSessionStats s = stats();
+    out.printf("MQTT: state=%d in=%lu out=%lu inflight=%u/%d pubacks=%lu retransmits=%lu expired=%lu full=%lu "
+               "subacks=%lu refused=%lu oversized=%lu malformed=%lu\n",
+               session_state, (unsigned long)s.packets_in, (unsigned long)s.packets_out, s.inflight,
+               MQTT_INFLIGHT_MAX, (unsigned long)s.pubacks, (unsigned long)s.retransmits,
+               (unsigned long)s.expired, (unsigned long)s.inflight_full, (unsigned long)s.subacks,
+               (unsigned long)s.sub_failures, (unsigned long)s.oversized, (unsigned long)s.malformed);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+#include "mqtt_codec.h"
+
+// ======= MQTT Session =======
+// MQTT 3.1.1 client over any Client, built on mqtt_codec.h. Incoming bytes
+// are read into the receive buffer and every complete packet in it is
+// handled in the same loop() call, with topic and payload handed to the
+// callback as views into that buffer. Outgoing packets are encoded into the
+// transmit buffer and written with one call each; a publish too large for
+// it has its header written from there and its payload straight from the
+// caller. QoS 1 publishes are kept in a fixed in-flight table until their
+// PUBACK, resent with DUP set when it is late, and resent after a reconnect.
+// The session is always clean, like PubSubClient's.
+
+#ifndef MQTT_INFLIGHT_MAX
+#define MQTT_INFLIGHT_MAX 8
+#endif
+#ifndef MQTT_INFLIGHT_PACKET
+#define MQTT_INFLIGHT_PACKET 96 // A command: topic, packet id and a short payload
+#endif
+
+const unsigned long MQTT_CONNECT_TIMEOUT = 15000;  // Waiting for CONNACK
+const unsigned long MQTT_RETRY_INTERVAL = 5000;    // Resend a QoS 1 publish without PUBACK
+const unsigned long MQTT_INFLIGHT_EXPIRY = 10000;  // Give up on it; a late light switch is worse
+
+// Same values as PubSubClient's state(), so logged codes keep their meaning
+const int MQTT_STATE_CONNECTION_TIMEOUT = -4;
+const int MQTT_STATE_CONNECTION_LOST = -3;
+const int MQTT_STATE_CONNECT_FAILED = -2;
+const int MQTT_STATE_DISCONNECTED = -1;
+const int MQTT_STATE_CONNECTED = 0;
+// 1 to 5 are CONNACK refusal codes
+
+// `message` points into the receive buffer and is only valid during the call
+typedef void (*MqttMessageCallback)(const MqttPublish& message);
+
+struct MqttSessionStats {
+    uint32_t packets_in;
+    uint32_t packets_out;
+    uint32_t pubacks;
+    uint32_t retransmits;
+    uint32_t expired;       // QoS 1 publishes dropped unacknowledged
+    uint32_t inflight_full; // QoS 1 publishes refused for want of a slot
+    uint32_t subacks;
+    uint32_t sub_failures;  // Filters the broker refused
+    uint32_t oversized;     // Packets larger than the receive buffer, skipped
+    uint32_t malformed;     // Connections dropped for a protocol violation
+    uint8_t inflight;
+};
+
+class MqttSession {
+public:
+    // The buffers must outlive the session. `rx` bounds the largest packet
+    // that can be received; `tx` only decides when a publish is streamed.
+    MqttSession(Client& client, uint8_t* rx, size_t rx_size, uint8_t* tx, size_t tx_size)
+        : client(client), rx(rx), rx_size(rx_size), tx(tx), tx_size(tx_size) {}
+
+    void set_server(const char* host, uint16_t port);
+    void set_keepalive(uint16_t seconds) { keepalive = seconds; }
+    void set_callback(MqttMessageCallback callback) { on_message = callback; }
+
+    // Opens the socket and waits for CONNACK; `user` and `password` may be nullptr
+    bool connect(const char* client_id, const char* user = nullptr, const char* password = nullptr);
+    bool connected();
+    void disconnect();
+    int state() const { return session_state; }
+
+    // Keepalive, QoS 1 retries and everything received since the last call
+    bool loop();
+
+    // QoS 0 or 1. A QoS 1 publish must fit MQTT_INFLIGHT_PACKET; it returns
+    // false while every in-flight slot is waiting for its PUBACK.
+    bool publish(const char* topic, const uint8_t* payload, size_t length, bool retained, uint8_t qos = 0);
+    bool subscribe(const char* filter, uint8_t qos = 0);
+
+    // For callers that build their own packets on this connection
+    uint16_t next_packet_id();
+    bool write_packet(const uint8_t* packet, size_t length);
+
+    MqttSessionStats stats() const;
+    void print(Print& out) const;
+
+private:
+    struct Inflight {
+        uint16_t packet_id;  // 0 = free
+        uint16_t length;
+        unsigned long first_sent;
+        unsigned long last_sent;
+        uint8_t packet[MQTT_INFLIGHT_PACKET];
+    };
+
+    void receive();
+    bool handle_packet(const MqttHeader& header, const uint8_t* body);
+    void resend_inflight(unsigned long now, bool all);
+    void drop_connection(int new_state);
+
+    Client& client;
+    uint8_t* rx;
+    size_t rx_size;
+    uint8_t* tx;
+    size_t tx_size;
+    size_t rx_len = 0;
+    size_t rx_skip = 0;        // Bytes of an oversized packet still to discard
+    const char* host = nullptr;
+    uint16_t port = 1883;
+    uint16_t keepalive = 15;
+    int session_state = MQTT_STATE_DISCONNECTED;
+    bool ping_outstanding = false;
+    unsigned long last_in = 0;
+    unsigned long last_out = 0;
+    uint16_t last_packet_id = 0;
+    MqttMessageCallback on_message = nullptr;
+    Inflight inflight[MQTT_INFLIGHT_MAX] = {};
+    MqttSessionStats counters = {};
+};
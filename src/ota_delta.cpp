@@ -0,0 +1,65 @@
+#include "ota_delta.h"
+#include <HTTPClient.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+// ======= Partition Access =======
+struct PartitionIo {
+    const esp_partition_t* base;
+    esp_ota_handle_t handle;
+};
+
+static bool read_partition(void* arg, size_t offset, uint8_t* dst, size_t len) {
+    const PartitionIo& p = *(const PartitionIo*)arg;
+    return offset + len <= p.base->size && esp_partition_read(p.base, offset, dst, len) == ESP_OK;
+}
+
+static bool write_partition(void* arg, const uint8_t* data, size_t len) {
+    return esp_ota_write(((PartitionIo*)arg)->handle, data, len) == ESP_OK;
+}
+
+OtaResult ota_delta_apply(Stream& delta, size_t length, const char* public_key_pem) {
+    PartitionIo partitions = {esp_ota_get_running_partition(), 0};
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (!partitions.base || !target) return OTA_FLASH_ERROR;
+    OtaPatchIo io = {read_partition, write_partition, &partitions};
+
+    OtaPatchHeader header;
+    OtaResult result = ota_patch_begin(delta, length, public_key_pem, io, &header);
+    if (result != OTA_OK) return result;
+    if (header.new_size > target->size) return OTA_BAD_HEADER;
+
+    if (esp_ota_begin(target, header.new_size, &partitions.handle) != ESP_OK) return OTA_FLASH_ERROR;
+    result = ota_patch_apply(header, io);
+    if (result != OTA_OK) {
+        esp_ota_abort(partitions.handle);
+        return result;
+    }
+    if (esp_ota_end(partitions.handle) != ESP_OK || esp_ota_set_boot_partition(target) != ESP_OK) {
+        return OTA_FLASH_ERROR;
+    }
+    return OTA_OK;
+}
+
+// ======= Download =======
+// WiFiClient::setTimeout() took seconds until arduino-esp32 3.0, which made it
+// milliseconds like every other Stream
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+static const uint32_t OTA_STREAM_TIMEOUT = 10000;
+#else
+static const uint32_t OTA_STREAM_TIMEOUT = 10;
+#endif
+
+OtaResult ota_delta_update(const char* url, const char* public_key_pem) {
+    HTTPClient http;
+    if (!http.begin(url)) return OTA_HTTP_ERROR;
+    http.setTimeout(10000);
+    OtaResult result = OTA_HTTP_ERROR;
+    if (http.GET() == HTTP_CODE_OK && http.getSize() > 0) {
+        WiFiClient* stream = http.getStreamPtr();
+        stream->setTimeout(OTA_STREAM_TIMEOUT);
+        result = ota_delta_apply(*stream, http.getSize(), public_key_pem);
+    }
+    http.end();
+    return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <Arduino.h>
+#include "ota_patch.h"
+
+// ======= Delta OTA =======
+// Downloads a signed binary delta made by tools/ota_delta.py against the
+// running image, patches it into the inactive OTA partition as it streams in
+// and selects that partition for the next boot if the signature and the
+// SHA-256 of both the base and the patched image check out. Decoding and
+// verification live in ota_patch; this is the flash and HTTP side.
+
+// Apply a delta read from `delta`, which holds exactly `length` bytes
+OtaResult ota_delta_apply(Stream& delta, size_t length, const char* public_key_pem);
+
+// Download the delta at `url` over HTTP and apply it. Restart on OTA_OK.
+OtaResult ota_delta_update(const char* url, const char* public_key_pem);
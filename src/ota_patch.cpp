@@ -0,0 +1,260 @@
+#include "ota_patch.h"
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+
+static const uint8_t DELTA_MAGIC[4] = {'M', '5', 'D', '2'};
+static const size_t DELTA_SIGNED_SIZE = 76;  // magic, sizes and both hashes
+static const size_t DELTA_HEADER_SIZE = DELTA_SIGNED_SIZE + 1 + OTA_SIG_MAX;
+enum { OP_END = 0, OP_ADD = 1, OP_INSERT = 2 };
+
+static uint8_t window[OTA_WINDOW_SIZE];
+static uint8_t in_buf[OTA_IO_CHUNK];
+static uint8_t old_buf[OTA_IO_CHUNK];
+static uint8_t out_buf[OTA_WRITE_CHUNK];
+
+// ======= Delta Stream =======
+static OtaDeltaStream ds;
+
+static int next_raw() {
+    if (ds.in_pos == ds.in_len) {
+        if (ds.remaining == 0) {
+            ds.failed = true;
+            return -1;
+        }
+        size_t n = ds.src->readBytes(in_buf, min(sizeof(in_buf), ds.remaining));
+        if (n == 0) {
+            ds.failed = true;
+            return -1;
+        }
+        ds.remaining -= n;
+        ds.in_len = n;
+        ds.in_pos = 0;
+    }
+    return in_buf[ds.in_pos++];
+}
+
+static int next_byte() {
+    uint8_t b;
+    if (ds.match_len > 0) {
+        b = window[(ds.win_pos - ds.match_dist) & (OTA_WINDOW_SIZE - 1)];
+        ds.match_len--;
+    } else {
+        if (ds.flag_bits == 0) {
+            int f = next_raw();
+            if (f < 0) return -1;
+            ds.flags = f;
+            ds.flag_bits = 8;
+        }
+        bool literal = ds.flags & 1;
+        ds.flags >>= 1;
+        ds.flag_bits--;
+        if (literal) {
+            int c = next_raw();
+            if (c < 0) return -1;
+            b = c;
+        } else {
+            int hi = next_raw();
+            int lo = next_raw();
+            if (lo < 0) return -1;
+            uint16_t code = (hi << 8) | lo;
+            ds.match_dist = (code >> 4) + 1;
+            ds.match_len = (code & 0x0f) + 3;
+            b = window[(ds.win_pos - ds.match_dist) & (OTA_WINDOW_SIZE - 1)];
+            ds.match_len--;
+        }
+    }
+    window[ds.win_pos & (OTA_WINDOW_SIZE - 1)] = b;
+    ds.win_pos++;
+    return b;
+}
+
+static bool next_varint(uint32_t* value) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int b = next_byte();
+        if (b < 0) return false;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ======= Image Writer =======
+static OtaImageWriter iw;
+
+static_assert(sizeof(window) + sizeof(in_buf) + sizeof(old_buf) + sizeof(out_buf) + sizeof(ds) + sizeof(iw) ==
+                  OTA_STATIC_BYTES,
+              "OTA_STATIC_BYTES must count every static in this file");
+
+static void flush_output() {
+    if (iw.out_len == 0 || iw.failed) return;
+    if (!iw.io->write(iw.io->arg, out_buf, iw.out_len)) {
+        iw.failed = true;
+        return;
+    }
+    mbedtls_sha256_update(&iw.sha, out_buf, iw.out_len);
+    iw.written += iw.out_len;
+    iw.out_len = 0;
+}
+
+static void put_byte(uint8_t b) {
+    out_buf[iw.out_len++] = b;
+    if (iw.out_len == sizeof(out_buf)) flush_output();
+}
+
+// Emit `length` bytes of the base image from `offset`, adding diff bytes if `add_diff`
+static bool copy_old(size_t offset, size_t length, bool add_diff) {
+    while (length > 0) {
+        size_t n = min(length, sizeof(old_buf));
+        if (!iw.io->read_base(iw.io->arg, offset, old_buf, n)) return false;
+        for (size_t i = 0; i < n; i++) {
+            uint8_t b = old_buf[i];
+            if (add_diff) {
+                int d = next_byte();
+                if (d < 0) return false;
+                b += (uint8_t)d;
+            }
+            put_byte(b);
+        }
+        offset += n;
+        length -= n;
+    }
+    return !iw.failed;
+}
+
+static bool hash_base(const OtaPatchIo& io, size_t length, uint8_t digest[32]) {
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    bool ok = true;
+    for (size_t offset = 0; offset < length && ok; offset += sizeof(old_buf)) {
+        size_t n = min(sizeof(old_buf), length - offset);
+        ok = io.read_base(io.arg, offset, old_buf, n);
+        mbedtls_sha256_update(&sha, old_buf, n);
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    return ok;
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ======= Signature =======
+static bool verify_signature(const uint8_t* header, const char* public_key_pem) {
+    size_t sig_len = header[DELTA_SIGNED_SIZE];
+    if (!public_key_pem || sig_len == 0 || sig_len > OTA_SIG_MAX) return false;
+
+    uint8_t digest[32];
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, header, DELTA_SIGNED_SIZE);
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    // The PEM parser wants the terminating NUL counted in the length
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    bool ok = mbedtls_pk_parse_public_key(&key, (const unsigned char*)public_key_pem,
+                                          strlen(public_key_pem) + 1) == 0 &&
+              mbedtls_pk_can_do(&key, MBEDTLS_PK_ECDSA) &&
+              mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest),
+                                header + DELTA_SIGNED_SIZE + 1, sig_len) == 0;
+    mbedtls_pk_free(&key);
+    return ok;
+}
+
+// ======= Patch =======
+static OtaResult apply_ops(size_t new_size) {
+    for (;;) {
+        int op = next_byte();
+        uint32_t offset, length;
+        if (op == OP_END) {
+            return iw.written + iw.out_len == new_size ? OTA_OK : OTA_STREAM_ERROR;
+        } else if (op == OP_ADD) {
+            if (!next_varint(&offset) || !next_varint(&length)) return OTA_STREAM_ERROR;
+            // The diff alternates runs of unchanged bytes with runs of added bytes
+            while (length > 0) {
+                uint32_t run, count;
+                if (!next_varint(&run) || !copy_old(offset, run, false)) return OTA_STREAM_ERROR;
+                if (!next_varint(&count) || !copy_old(offset + run, count, true)) return OTA_STREAM_ERROR;
+                if (run + count == 0 || run + count > length) return OTA_STREAM_ERROR;
+                offset += run + count;
+                length -= run + count;
+            }
+        } else if (op == OP_INSERT) {
+            if (!next_varint(&length)) return OTA_STREAM_ERROR;
+            for (uint32_t i = 0; i < length; i++) {
+                int b = next_byte();
+                if (b < 0) return OTA_STREAM_ERROR;
+                put_byte(b);
+            }
+        } else {
+            return OTA_STREAM_ERROR;
+        }
+        if (iw.failed) return OTA_FLASH_ERROR;
+        if (iw.written + iw.out_len > new_size) return OTA_STREAM_ERROR;
+    }
+}
+
+OtaResult ota_patch_begin(Stream& delta, size_t length, const char* public_key_pem, const OtaPatchIo& io,
+                          OtaPatchHeader* header) {
+    memset(&ds, 0, sizeof(ds));
+    ds.src = &delta;
+    ds.remaining = length;
+
+    uint8_t raw[DELTA_HEADER_SIZE];
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        int b = next_raw();
+        if (b < 0) return OTA_BAD_HEADER;
+        raw[i] = b;
+    }
+    if (memcmp(raw, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0) return OTA_BAD_HEADER;
+    if (!verify_signature(raw, public_key_pem)) return OTA_BAD_SIGNATURE;
+
+    header->old_size = read_u32(raw + 4);
+    header->new_size = read_u32(raw + 8);
+    memcpy(header->old_sha256, raw + 12, 32);
+    memcpy(header->new_sha256, raw + 44, 32);
+
+    uint8_t digest[32];
+    if (!hash_base(io, header->old_size, digest) || memcmp(digest, header->old_sha256, 32) != 0) {
+        return OTA_BASE_MISMATCH;
+    }
+    return OTA_OK;
+}
+
+OtaResult ota_patch_apply(const OtaPatchHeader& header, const OtaPatchIo& io) {
+    memset(&iw, 0, sizeof(iw));
+    iw.io = &io;
+    mbedtls_sha256_init(&iw.sha);
+    mbedtls_sha256_starts(&iw.sha, 0);
+
+    OtaResult result = apply_ops(header.new_size);
+    flush_output();
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&iw.sha, digest);
+    mbedtls_sha256_free(&iw.sha);
+    if (result == OTA_OK && iw.failed) result = OTA_FLASH_ERROR;
+    if (result == OTA_OK && memcmp(digest, header.new_sha256, 32) != 0) result = OTA_HASH_MISMATCH;
+    return result;
+}
+
+const char* ota_result_name(OtaResult result) {
+    switch (result) {
+        case OTA_OK: return "ok";
+        case OTA_HTTP_ERROR: return "http error";
+        case OTA_BAD_HEADER: return "bad header";
+        case OTA_BAD_SIGNATURE: return "bad signature";
+        case OTA_BASE_MISMATCH: return "base image mismatch";
+        case OTA_STREAM_ERROR: return "malformed delta";
+        case OTA_FLASH_ERROR: return "flash error";
+        case OTA_HASH_MISMATCH: return "hash mismatch";
+    }
+    return "?";
+}
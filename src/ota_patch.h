@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include <mbedtls/sha256.h>
+
+// ======= Delta Patch =======
+// Decoder for the deltas made by tools/ota_delta.py, independent of flash
+// and HTTP so it also runs on the host. The base image is read and the
+// patched image written through OtaPatchIo callbacks.
+//
+// The 76-byte header (sizes and the SHA-256 of the base and patched image)
+// is signed with ECDSA P-256. ota_patch_begin() rejects a delta unless the
+// signature verifies against the public key compiled into the firmware, so
+// only images hashed by the key holder can be written. Working memory is
+// the static buffers below regardless of image size.
+
+const size_t OTA_WINDOW_SIZE = 4096; // LZSS history, must match the encoder
+const size_t OTA_IO_CHUNK = 256;     // Download and base-image read granularity
+const size_t OTA_WRITE_CHUNK = 512;  // Flash write granularity
+const size_t OTA_SIG_MAX = 72;       // DER-encoded ECDSA P-256 signature
+
+enum OtaResult {
+    OTA_OK,
+    OTA_HTTP_ERROR,
+    OTA_BAD_HEADER,
+    OTA_BAD_SIGNATURE,  // unsigned, or not signed by the compiled-in key
+    OTA_BASE_MISMATCH,  // delta was made against a different image
+    OTA_STREAM_ERROR,   // truncated or malformed delta
+    OTA_FLASH_ERROR,
+    OTA_HASH_MISMATCH
+};
+
+struct OtaPatchHeader {
+    uint32_t old_size;
+    uint32_t new_size;
+    uint8_t old_sha256[32];
+    uint8_t new_sha256[32];
+};
+
+struct OtaPatchIo {
+    bool (*read_base)(void* arg, size_t offset, uint8_t* dst, size_t len);
+    bool (*write)(void* arg, const uint8_t* data, size_t len);
+    void* arg;
+};
+
+// ======= Decoder State =======
+// Only ota_patch.cpp touches these; they are declared here so that
+// OTA_STATIC_BYTES is the size of the real objects.
+
+// Raw bytes come from the download; op bytes are LZSS-decoded on the fly
+struct OtaDeltaStream {
+    Stream* src;
+    size_t remaining;   // undownloaded bytes
+    size_t in_pos;
+    size_t in_len;
+    size_t win_pos;
+    uint8_t flags;
+    int flag_bits;      // items left under the current flag byte
+    size_t match_dist;
+    int match_len;      // bytes left in the current match
+    bool failed;
+};
+
+struct OtaImageWriter {
+    const OtaPatchIo* io;
+    mbedtls_sha256_context sha;
+    size_t out_len;
+    size_t written;
+    bool failed;
+};
+
+// The LZSS window, the download, base-image and flash buffers, and the decoder state
+const size_t OTA_STATIC_BYTES = OTA_WINDOW_SIZE + 2 * OTA_IO_CHUNK + OTA_WRITE_CHUNK + sizeof(OtaDeltaStream) +
+                                sizeof(OtaImageWriter);
+
+// Read the signed header from `delta`, which holds exactly `length` bytes,
+// verify it against `public_key_pem` and check the base image hash
+OtaResult ota_patch_begin(Stream& delta, size_t length, const char* public_key_pem, const OtaPatchIo& io,
+                          OtaPatchHeader* header);
+
+// Decode the rest of the delta into io.write and verify the patched image hash
+OtaResult ota_patch_apply(const OtaPatchHeader& header, const OtaPatchIo& io);
+
+const char* ota_result_name(OtaResult result);
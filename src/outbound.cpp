@@ -0,0 +1,158 @@
+#include "outbound.h"
+
+// ======= Token Buckets =======
+static void bucket_init(OutboundBucket& b, uint32_t rate, uint32_t burst) {
+    b.rate = rate;
+    b.burst = burst;
+    b.milli_tokens = burst * 1000;
+    b.last_refill = millis();
+}
+
+static void bucket_refill(OutboundBucket& b, unsigned long now) {
+    unsigned long elapsed = now - b.last_refill;
+    if (elapsed == 0) return;
+    b.last_refill = now;
+    uint64_t tokens = (uint64_t)b.milli_tokens + (uint64_t)elapsed * b.rate;
+    b.milli_tokens = (uint32_t)min(tokens, (uint64_t)b.burst * 1000);
+}
+
+// A full bucket admits one oversized cost, like the log shipper's byte bucket
+static bool bucket_allows(const OutboundBucket& b, uint32_t cost) {
+    return b.milli_tokens >= cost * 1000 || b.milli_tokens == b.burst * 1000;
+}
+
+static void bucket_take(OutboundBucket& b, uint32_t cost) {
+    b.milli_tokens = b.milli_tokens > cost * 1000 ? b.milli_tokens - cost * 1000 : 0;
+}
+
+// ======= Lane Queues =======
+static OutboundSlot command_slots[OUTBOUND_COMMAND_SLOTS];
+static uint8_t command_payloads[OUTBOUND_COMMAND_SLOTS * OUTBOUND_SLOT_PAYLOAD];
+static OutboundSlot scene_slots[OUTBOUND_SCENE_SLOTS];
+static uint8_t scene_payloads[OUTBOUND_SCENE_SLOTS * OUTBOUND_SLOT_PAYLOAD];
+
+static OutboundLaneState lanes[LANE_COUNT];
+static OutboundBucket broker;
+static OutboundSendFn send_fn = nullptr;
+
+static_assert(sizeof(command_slots) + sizeof(command_payloads) + sizeof(scene_slots) + sizeof(scene_payloads) +
+                      sizeof(lanes) + sizeof(broker) + sizeof(send_fn) == OUTBOUND_STATIC_BYTES,
+              "OUTBOUND_STATIC_BYTES must count every static above");
+
+void outbound_begin(OutboundSendFn send) {
+    send_fn = send;
+    bucket_init(broker, OUTBOUND_BROKER_RATE, OUTBOUND_BROKER_BURST);
+    for (int i = 0; i < LANE_COUNT; i++) {
+        const OutboundLaneConfig& config = outbound_lanes[i];
+        OutboundLaneState& lane = lanes[i];
+        bucket_init(lane.messages, config.msgs_per_sec, config.msg_burst);
+        bucket_init(lane.bytes, config.bytes_per_sec, config.byte_burst);
+        lane.head = 0;
+        lane.count = 0;
+        memset(&lane.stats, 0, sizeof(lane.stats));
+    }
+    lanes[LANE_COMMAND].slots = command_slots;
+    lanes[LANE_COMMAND].payloads = command_payloads;
+    lanes[LANE_SCENE].slots = scene_slots;
+    lanes[LANE_SCENE].payloads = scene_payloads;
+}
+
+static void refill_all(unsigned long now) {
+    bucket_refill(broker, now);
+    for (int i = 0; i < LANE_COUNT; i++) {
+        bucket_refill(lanes[i].messages, now);
+        bucket_refill(lanes[i].bytes, now);
+    }
+}
+
+static bool can_send(OutboundLaneState& lane, size_t length) {
+    return bucket_allows(broker, 1) && bucket_allows(lane.messages, 1) && bucket_allows(lane.bytes, length);
+}
+
+static bool send_now(int lane_id, const char* topic, const uint8_t* payload, size_t length, bool retained) {
+    OutboundLaneState& lane = lanes[lane_id];
+    if (!send_fn || !send_fn((OutboundLane)lane_id, topic, payload, length, retained)) return false;
+    bucket_take(broker, 1);
+    bucket_take(lane.messages, 1);
+    bucket_take(lane.bytes, length);
+    lane.stats.sent++;
+    return true;
+}
+
+// Queues of every lane above `lane` are empty
+static bool higher_lanes_idle(int lane) {
+    for (int i = 0; i < lane; i++) {
+        if (lanes[i].count > 0) return false;
+    }
+    return true;
+}
+
+// ======= Publishing =======
+bool outbound_publish(OutboundLane lane_id, const char* topic, const uint8_t* payload, size_t length,
+                      bool retained) {
+    OutboundLaneState& lane = lanes[lane_id];
+    const OutboundLaneConfig& config = outbound_lanes[lane_id];
+    refill_all(millis());
+
+    // Commands jump ahead of queued scenes; lower lanes wait for higher ones
+    bool in_turn = lane.count == 0 && (lane_id == LANE_COMMAND || higher_lanes_idle(lane_id));
+    if (in_turn && can_send(lane, length) && send_now(lane_id, topic, payload, length, retained)) {
+        return true;
+    }
+
+    lane.stats.deferred++;
+    if (config.queue_slots == 0) return false;
+    if (lane.count == config.queue_slots || length > config.slot_payload) {
+        lane.stats.dropped++;
+        return false;
+    }
+    uint8_t index = (lane.head + lane.count) % config.queue_slots;
+    OutboundSlot& slot = lane.slots[index];
+    slot.topic = topic;
+    slot.queued_at = millis();
+    slot.length = (uint8_t)length;
+    slot.retained = retained;
+    memcpy(lane.payloads + index * config.slot_payload, payload, length);
+    lane.count++;
+    return true;
+}
+
+void outbound_poll() {
+    unsigned long now = millis();
+    refill_all(now);
+
+    // Strict priority: a lane is only drained once the lanes above it are empty
+    for (int i = 0; i < LANE_COUNT; i++) {
+        OutboundLaneState& lane = lanes[i];
+        const OutboundLaneConfig& config = outbound_lanes[i];
+        while (lane.count > 0) {
+            OutboundSlot& slot = lane.slots[lane.head];
+            unsigned long waited = now - slot.queued_at;
+            if (waited > OUTBOUND_MAX_AGE) {
+                lane.stats.dropped++;
+            } else if (!can_send(lane, slot.length) ||
+                       !send_now(i, slot.topic, lane.payloads + lane.head * config.slot_payload,
+                                 slot.length, slot.retained)) {
+                return;
+            } else if (waited > lane.stats.max_wait_ms) {
+                lane.stats.max_wait_ms = waited;
+            }
+            lane.head = (lane.head + 1) % config.queue_slots;
+            lane.count--;
+        }
+    }
+}
+
+// ======= Status =======
+OutboundLaneStats outbound_stats(OutboundLane lane) {
+    return lanes[lane].stats;
+}
+
+void outbound_print(Print& out) {
+    for (int i = 0; i < LANE_COUNT; i++) {
+        const OutboundLaneStats& s = lanes[i].stats;
+        out.printf("Lane %-9s sent=%lu deferred=%lu dropped=%lu queued=%u max_wait=%lums\n",
+                   outbound_lanes[i].name, (unsigned long)s.sent, (unsigned long)s.deferred,
+                   (unsigned long)s.dropped, lanes[i].count, (unsigned long)s.max_wait_ms);
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <Arduino.h>
+
+// ======= Outbound Scheduler =======
+// Every publish goes through a priority lane. Each lane has a message and a
+// byte token bucket, and a shared bucket keeps the panel under the broker's
+// per-client message rate. A user command is sent at once unless the broker
+// bucket is empty, ahead of any queued scene commands; scenes wait for
+// commands; telemetry only goes out when both queues are empty. Command and
+// scene messages that cannot go out yet are copied into static per-lane
+// queues and drained from loop(). Telemetry is never queued: a refused
+// publish returns false and the producer keeps or resamples its data.
+
+enum OutboundLane {
+    LANE_COMMAND,    // User commands and alert escalations
+    LANE_SCENE,      // Scene batches and automation
+    LANE_TELEMETRY,  // Heap, metrics and log shipping
+    LANE_COUNT
+};
+
+struct OutboundLaneConfig {
+    const char* name;
+    uint16_t msgs_per_sec;
+    uint16_t msg_burst;
+    uint16_t bytes_per_sec;
+    uint16_t byte_burst;     // Also the largest message the lane can send
+    uint8_t queue_slots;     // 0 = refuse instead of queueing
+    uint8_t slot_payload;    // Bytes of payload copied per queued message
+};
+
+const uint8_t OUTBOUND_COMMAND_SLOTS = 8;
+const uint8_t OUTBOUND_SCENE_SLOTS = 16;
+const uint8_t OUTBOUND_SLOT_PAYLOAD = 32; // "ON"/"OFF" and scene names
+
+const OutboundLaneConfig outbound_lanes[LANE_COUNT] = {
+    {"command", 20, 10, 2048, 1024, OUTBOUND_COMMAND_SLOTS, OUTBOUND_SLOT_PAYLOAD},
+    {"scene", 10, 10, 1024, 512, OUTBOUND_SCENE_SLOTS, OUTBOUND_SLOT_PAYLOAD},
+    {"telemetry", 2, 2, 1024, 2048, 0, 0},
+};
+
+const uint16_t OUTBOUND_BROKER_RATE = 25;   // Messages per second across all lanes
+const uint16_t OUTBOUND_BROKER_BURST = 15;
+const unsigned long OUTBOUND_MAX_AGE = 10000; // Queued commands older than this are dropped
+
+struct OutboundLaneStats {
+    uint32_t sent;
+    uint32_t deferred;   // Queued or refused because of rate or priority
+    uint32_t dropped;    // Queue full, payload too large or expired
+    uint32_t max_wait_ms;
+};
+
+// ======= Scheduler State =======
+// Only outbound.cpp touches these; they are declared here so that
+// OUTBOUND_STATIC_BYTES is the size of the real objects.
+
+// Tokens are kept in thousandths so low rates refill smoothly per millisecond
+struct OutboundBucket {
+    uint32_t milli_tokens;
+    uint32_t rate;
+    uint32_t burst;
+    unsigned long last_refill;
+};
+
+struct OutboundSlot {
+    const char* topic;
+    unsigned long queued_at;
+    uint8_t length;
+    bool retained;
+};
+
+struct OutboundLaneState {
+    OutboundBucket messages;
+    OutboundBucket bytes;
+    OutboundSlot* slots;
+    uint8_t* payloads;
+    uint8_t head;
+    uint8_t count;
+    OutboundLaneStats stats;
+};
+
+// Sends one message immediately; returns false if it could not be written.
+// `lane` lets the sender pick a connection, see TELEMETRY_CONNECTION in main.cpp.
+typedef bool (*OutboundSendFn)(OutboundLane lane, const char* topic, const uint8_t* payload, size_t length,
+                               bool retained);
+
+// The queues with their payload copies, the lanes, the broker bucket and the sender
+const size_t OUTBOUND_STATIC_BYTES = (OUTBOUND_COMMAND_SLOTS + OUTBOUND_SCENE_SLOTS) *
+                                         (sizeof(OutboundSlot) + OUTBOUND_SLOT_PAYLOAD) +
+                                     LANE_COUNT * sizeof(OutboundLaneState) + sizeof(OutboundBucket) +
+                                     sizeof(OutboundSendFn);
+
+void outbound_begin(OutboundSendFn send);
+
+// Publish on `lane`. Returns true if the message was sent or queued.
+// `topic` must stay valid until the message is sent.
+bool outbound_publish(OutboundLane lane, const char* topic, const uint8_t* payload, size_t length,
+                      bool retained);
+
+// Send queued messages that the buckets now allow, highest priority first
+void outbound_poll();
+
+OutboundLaneStats outbound_stats(OutboundLane lane);
+void outbound_print(Print& out);
@@ -0,0 +1,96 @@
+#include "state_store.h"
+
+static UiState state = {};
+static std::atomic<uint32_t> sequence(0); // Odd while a write is in progress
+
+static_assert(sizeof(state) + sizeof(sequence) == STATE_STORE_STATIC_BYTES,
+              "STATE_STORE_STATIC_BYTES must count every static above");
+
+// ======= Writing =======
+#ifdef FAULT_INJECTION
+static void (*write_hook)() = nullptr;
+
+void state_set_write_hook(void (*hook)()) {
+    write_hook = hook;
+}
+#endif
+
+// Readers that see an odd sequence, or a different one after copying, retry
+static void begin_write() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void end_write(StateSlice slice) {
+#ifdef FAULT_INJECTION
+    if (write_hook) write_hook();
+#endif
+    state.version++;
+    state.slice_version[slice]++;
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void state_set_menu(uint8_t menu, uint8_t selected_index, uint8_t scroll_offset) {
+    if (menu == state.menu && selected_index == state.selected_index && scroll_offset == state.scroll_offset) {
+        return;
+    }
+    begin_write();
+    state.menu = menu;
+    state.selected_index = selected_index;
+    state.scroll_offset = scroll_offset;
+    end_write(SLICE_MENU);
+}
+
+void state_set_device(int index, bool on) {
+    if (index < 0 || index >= STATE_MAX_DEVICES || state_device_on(state, index) == on) return;
+    begin_write();
+    state.devices_on ^= 1UL << index;
+    end_write(SLICE_DEVICES);
+}
+
+void state_set_door(int index, bool open) {
+    if (index < 0 || index >= STATE_MAX_DOORS || state_door_open(state, index) == open) return;
+    begin_write();
+    state.doors_open ^= 1U << index;
+    end_write(SLICE_DOORS);
+}
+
+void state_set_alert_flash(bool hidden) {
+    if (hidden == state.alert_flash_hidden) return;
+    begin_write();
+    state.alert_flash_hidden = hidden;
+    end_write(SLICE_ALERT_FLASH);
+}
+
+void state_alerts_changed() {
+    begin_write();
+    end_write(SLICE_ALERTS);
+}
+
+// ======= Reading =======
+const UiState& state_current() {
+    return state;
+}
+
+void state_snapshot(UiState* out) {
+    for (;;) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) continue; // The writer is mid-change
+        memcpy(out, &state, sizeof(state));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) return;
+    }
+}
+
+// ======= Status =======
+void state_print(Print& out) {
+    UiState s;
+    state_snapshot(&s);
+    out.printf("State: version=%lu menu=%u/%u/%u devices=0x%lx doors=0x%x flash=%d slices=",
+               (unsigned long)s.version, s.menu, s.selected_index, s.scroll_offset,
+               (unsigned long)s.devices_on, s.doors_open, s.alert_flash_hidden);
+    for (int i = 0; i < SLICE_COUNT; i++) {
+        out.printf("%s%lu", i ? "," : "", (unsigned long)s.slice_version[i]);
+    }
+    out.println();
+}
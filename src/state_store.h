@@ -0,0 +1,75 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ======= State Store =======
+// The panel's model: what the menu shows, which devices are on, which doors
+// are open and whether the alert stack changed. Only the loop task writes
+// it, through the setters below. Every change bumps the store's version and
+// the version of the slice it touched, so the renderer can compare a new
+// snapshot against the versions it last drew and repaint only those parts.
+// Writes are wrapped in a seqlock: a reader on either core copies the state
+// and retries if a write overlapped the copy, so it never sees half a
+// change and never blocks the writer. A reader on the loop task's core
+// must not outrank it, or it could spin on a write it preempted. Alert
+// text itself stays in alert_manager.h; the store only records that it
+// changed.
+
+enum StateSlice {
+    SLICE_MENU,         // Screen, selection and scroll position
+    SLICE_DEVICES,      // On/off per device
+    SLICE_DOORS,        // Open/closed per door sensor
+    SLICE_ALERTS,       // The visible alert set or page
+    SLICE_ALERT_FLASH,  // Critical alerts blanked on this flash phase
+    SLICE_COUNT
+};
+
+const int STATE_MAX_DEVICES = 32;  // Bits in UiState::devices_on
+const int STATE_MAX_DOORS = 8;     // Bits in UiState::doors_open
+
+// Plain data so a snapshot is a straight copy
+struct UiState {
+    uint32_t version;                     // Bumped by every change
+    uint32_t slice_version[SLICE_COUNT];
+    uint8_t menu;                         // MenuState
+    uint8_t selected_index;
+    uint8_t scroll_offset;
+    bool alert_flash_hidden;
+    uint32_t devices_on;                  // Bit i: devices[i] is on
+    uint8_t doors_open;                   // Bit i: door_sensors[i] is open
+};
+
+const size_t STATE_STORE_STATIC_BYTES = sizeof(UiState) + sizeof(std::atomic<uint32_t>);
+
+// ======= Writing (loop task only) =======
+// Each setter does nothing, and bumps no version, if the value is unchanged
+void state_set_menu(uint8_t menu, uint8_t selected_index, uint8_t scroll_offset);
+void state_set_device(int index, bool on);
+void state_set_door(int index, bool open);
+void state_set_alert_flash(bool hidden);
+// Call when an alert_manager mutator reports a visible change
+void state_alerts_changed();
+
+#ifdef FAULT_INJECTION
+// Called in every write after the change and before the versions, while
+// the sequence is odd. A hook that blocks holds the write open, as a loop
+// task preempted there would; nullptr removes it
+void state_set_write_hook(void (*hook)());
+#endif
+
+// ======= Reading =======
+// The live state, for the writing task only; other tasks take a snapshot
+const UiState& state_current();
+
+// Consistent copy from any task or core
+void state_snapshot(UiState* out);
+
+inline bool state_device_on(const UiState& state, int index) {
+    return state.devices_on & (1UL << index);
+}
+
+inline bool state_door_open(const UiState& state, int index) {
+    return state.doors_open & (1U << index);
+}
+
+void state_print(Print& out);
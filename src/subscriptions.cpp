@@ -0,0 +1,130 @@
+#include "subscriptions.h"
+
+static Subscription table[SUBS_MAX];
+static int table_count = 0;
+static int current_screen = SUBS_SCREEN_OFF;
+static MqttSession* session = nullptr;
+static SubscriptionStats stats = {};
+
+// Built after a gap so the fixed header can be prepended in place
+static uint8_t packet[SUBS_PACKET_SIZE];
+static const size_t HEADER_ROOM = MQTT_MAX_HEADER;
+
+// ======= Packet Building =======
+static size_t body_len;
+
+static_assert(sizeof(table) + sizeof(table_count) + sizeof(current_screen) + sizeof(session) + sizeof(stats) +
+                      sizeof(packet) + sizeof(body_len) == SUBS_STATIC_BYTES,
+              "SUBS_STATIC_BYTES must count every static above");
+
+static void begin_packet() {
+    // Ids come from the session so they never clash with an in-flight publish
+    mqtt_put_u16(packet + HEADER_ROOM, session->next_packet_id());
+    body_len = 2;
+}
+
+static bool add_topic(const char* filter, bool with_qos) {
+    size_t len = strlen(filter);
+    size_t need = 2 + len + (with_qos ? 1 : 0);
+    if (HEADER_ROOM + body_len + need > sizeof(packet)) return false;
+    uint8_t* p = mqtt_put_string(packet + HEADER_ROOM + body_len, filter, len);
+    if (with_qos) *p = 0; // QoS 0
+    body_len += need;
+    return true;
+}
+
+// Prepend the fixed header and write the packet in one call
+static bool send_packet(uint8_t type) {
+    uint8_t header[HEADER_ROOM];
+    size_t header_len = mqtt_encode_header(header, type, body_len);
+    uint8_t* start = packet + HEADER_ROOM - header_len;
+    memcpy(start, header, header_len);
+    return session->write_packet(start, header_len + body_len);
+}
+
+// Subscribe or unsubscribe every topic of `screen`, plus the always-on ones
+// if `with_always`, filling each packet before starting the next
+static void send_batched(bool subscribe, int screen, bool with_always) {
+    uint8_t type = ((subscribe ? MQTT_PKT_SUBSCRIBE : MQTT_PKT_UNSUBSCRIBE) << 4) | 0x02;
+    uint32_t packets = 0;
+    uint32_t topics = 0;
+    int in_packet = 0;
+    begin_packet();
+    for (int i = 0; i < table_count; i++) {
+        const Subscription& sub = table[i];
+        if (sub.screen != screen && !(with_always && sub.screen == SUB_ALWAYS)) continue;
+        if (!add_topic(sub.filter, subscribe)) {
+            if (in_packet > 0) {
+                if (!send_packet(type)) return; // Connection lost; the next connect starts over
+                packets++;
+                begin_packet();
+                in_packet = 0;
+            }
+            if (!add_topic(sub.filter, subscribe)) {
+                stats.overflows++;
+                continue;
+            }
+        }
+        in_packet++;
+        topics++;
+    }
+    if (in_packet > 0) {
+        if (!send_packet(type)) return;
+        packets++;
+    }
+    if (subscribe) {
+        stats.subscribe_packets += packets;
+        stats.topics_subscribed += topics;
+    } else {
+        stats.unsubscribe_packets += packets;
+        stats.topics_unsubscribed += topics;
+    }
+}
+
+// ======= Public API =======
+void subs_begin(MqttSession& mqtt) {
+    session = &mqtt;
+}
+
+bool subs_add(const char* filter, int screen) {
+    if (table_count == SUBS_MAX) {
+        stats.overflows++;
+        return false;
+    }
+    table[table_count].filter = filter;
+    table[table_count].screen = screen;
+    table_count++;
+    return true;
+}
+
+void subs_connected() {
+    if (!session || !session->connected()) return;
+    send_batched(true, current_screen, true);
+}
+
+void subs_set_screen(int screen) {
+    if (screen == current_screen) return;
+    int previous = current_screen;
+    current_screen = screen;
+    // While disconnected only the screen is recorded; subs_connected() catches up
+    if (!session || !session->connected()) return;
+    send_batched(false, previous, false);
+    send_batched(true, screen, false);
+}
+
+// ======= Status =======
+SubscriptionStats subs_stats() {
+    return stats;
+}
+
+void subs_print(Print& out) {
+    int always = 0;
+    for (int i = 0; i < table_count; i++) {
+        if (table[i].screen == SUB_ALWAYS) always++;
+    }
+    out.printf("Subscriptions: %d topics (%d always) screen=%d sub_packets=%lu unsub_packets=%lu "
+               "subscribed=%lu unsubscribed=%lu overflows=%lu\n",
+               table_count, always, current_screen, (unsigned long)stats.subscribe_packets,
+               (unsigned long)stats.unsubscribe_packets, (unsigned long)stats.topics_subscribed,
+               (unsigned long)stats.topics_unsubscribed, (unsigned long)stats.overflows);
+}
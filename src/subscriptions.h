@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include "mqtt_session.h"
+
+// ======= Subscription Manager =======
+// Keeps the control connection subscribed to what the panel needs right now.
+// Topics registered with SUB_ALWAYS (door sensors, OTA, the RTT loopback)
+// stay subscribed for the whole connection. Every other topic belongs to one
+// screen and is subscribed when that screen comes up and unsubscribed when
+// it goes away, so the panel does not process traffic nobody is looking at.
+// Topics are packed into as few SUBSCRIBE or UNSUBSCRIBE packets as fit in
+// SUBS_PACKET_SIZE, the broker's limit, and the packets are written back to
+// back without waiting for each SUBACK. MqttSession::subscribe() sends one
+// topic per packet, so these are built here with the codec and written
+// through the session, which takes their packet ids from its own counter.
+
+#ifndef SUBS_MAX
+#define SUBS_MAX 32
+#endif
+#ifndef SUBS_PACKET_SIZE
+#define SUBS_PACKET_SIZE 512 // Largest SUBSCRIBE the broker accepts, header included
+#endif
+
+const int SUB_ALWAYS = -1;       // Screen id for topics that are never dropped
+const int SUBS_SCREEN_OFF = -2;  // The display is asleep, no screen is visible
+
+struct SubscriptionStats {
+    uint32_t subscribe_packets;
+    uint32_t unsubscribe_packets;
+    uint32_t topics_subscribed;
+    uint32_t topics_unsubscribed;
+    uint32_t overflows;   // Topics left out: the table was full or a filter can't fit any packet
+};
+
+struct Subscription {
+    const char* filter;
+    int screen;
+};
+
+// The table, the packet being built and the bookkeeping in subscriptions.cpp
+const size_t SUBS_STATIC_BYTES = SUBS_MAX * sizeof(Subscription) + SUBS_PACKET_SIZE + 2 * sizeof(int) +
+                                 sizeof(MqttSession*) + sizeof(SubscriptionStats) + sizeof(size_t);
+
+// Packets are written through `session`, the control connection
+void subs_begin(MqttSession& session);
+
+// Register `filter` for `screen` (a MenuState, or SUB_ALWAYS). `filter`
+// must outlive the manager. Returns false when the table is full.
+bool subs_add(const char* filter, int screen);
+
+// Subscribe the always-on topics and those of the current screen. Call
+// after every successful connect; a clean session starts with nothing.
+void subs_connected();
+
+// Follow the visible screen, or SUBS_SCREEN_OFF. Sends nothing unless the
+// set of screen topics changes.
+void subs_set_screen(int screen);
+
+SubscriptionStats subs_stats();
+void subs_print(Print& out);
@@ -0,0 +1,105 @@
+#include "timer_wheel.h"
+
+static void unlink(Timer& t) {
+    *t.pprev = t.next;
+    if (t.next) t.next->pprev = t.pprev;
+    t.next = nullptr;
+    t.pprev = nullptr;
+}
+
+static void push(Timer** slot, Timer& t) {
+    t.next = *slot;
+    if (t.next) t.next->pprev = &t.next;
+    *slot = &t;
+    t.pprev = slot;
+}
+
+void TimerWheel::begin(unsigned long now_ms) {
+    memset(levels, 0, sizeof(levels));
+    current = 0;
+    count = 0;
+    last_ms = now_ms;
+    pending_ms = 0;
+}
+
+void TimerWheel::insert(Timer& t) {
+    uint32_t delta = t.expires - current;
+    if ((int32_t)delta < 0) {
+        // Overdue: run on the next processed tick
+        push(&levels[0][current & TIMER_WHEEL_MASK], t);
+    } else if (delta < TIMER_WHEEL_SLOTS) {
+        push(&levels[0][t.expires & TIMER_WHEEL_MASK], t);
+    } else if (delta < TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS) {
+        push(&levels[1][(t.expires >> TIMER_WHEEL_BITS) & TIMER_WHEEL_MASK], t);
+    } else {
+        if (delta >= TIMER_WHEEL_SPAN) {
+            t.expires = current + TIMER_WHEEL_SPAN - 1;
+        }
+        push(&levels[2][(t.expires >> (2 * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK], t);
+    }
+}
+
+void TimerWheel::arm(Timer& t, unsigned long delay_ms, TimerCallback callback, void* arg) {
+    if (armed(t)) {
+        unlink(t);
+    } else {
+        count++;
+    }
+    t.callback = callback;
+    t.arg = arg;
+    // The next processed tick is one tick away, so it serves a one-tick delay
+    uint32_t ticks = (delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    t.expires = current + (ticks > 0 ? ticks - 1 : 0);
+    insert(t);
+}
+
+void TimerWheel::cancel(Timer& t) {
+    if (!armed(t)) return;
+    unlink(t);
+    count--;
+}
+
+// Re-file every timer in a higher-level slot relative to the current tick
+void TimerWheel::cascade(Timer** slot) {
+    Timer* t = *slot;
+    *slot = nullptr;
+    while (t) {
+        Timer* next = t->next;
+        insert(*t);
+        t = next;
+    }
+}
+
+void TimerWheel::run_tick() {
+    uint32_t index = current & TIMER_WHEEL_MASK;
+    if (index == 0) {
+        uint32_t index1 = (current >> TIMER_WHEEL_BITS) & TIMER_WHEEL_MASK;
+        if (index1 == 0) {
+            cascade(&levels[2][(current >> (2 * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK]);
+        }
+        cascade(&levels[1][index1]);
+    }
+
+    // Detach the due list before running callbacks; re-armed timers land in later slots
+    Timer* due = levels[0][index];
+    levels[0][index] = nullptr;
+    if (due) due->pprev = &due;
+    current++;
+
+    while (due) {
+        Timer& t = *due;
+        unlink(t);
+        count--;
+        t.callback(t.arg);
+    }
+}
+
+void TimerWheel::advance(unsigned long now_ms) {
+    // Accumulate elapsed time so millis() wraparound is harmless
+    pending_ms += now_ms - last_ms;
+    last_ms = now_ms;
+    while (pending_ms >= TIMER_TICK_MS) {
+        pending_ms -= TIMER_TICK_MS;
+        run_tick();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+
+// ======= Timer Wheel =======
+// Hierarchical timing wheel with O(1) arm and cancel. Three levels of 64
+// slots cover TIMER_WHEEL_SPAN ticks; timers further out are clamped to the
+// span. Timers are intrusive and owned by the caller, so any number can be
+// armed without allocation. advance() takes the time explicitly, which also
+// lets it run on virtual time.
+
+const uint32_t TIMER_TICK_MS = 100;
+const int TIMER_WHEEL_BITS = 6;
+const uint32_t TIMER_WHEEL_SLOTS = 1UL << TIMER_WHEEL_BITS;
+const uint32_t TIMER_WHEEL_MASK = TIMER_WHEEL_SLOTS - 1;
+const uint32_t TIMER_WHEEL_SPAN = 1UL << (3 * TIMER_WHEEL_BITS); // ticks, ~7.3 h at 100 ms
+
+typedef void (*TimerCallback)(void* arg);
+
+// Zero-initialized timers are valid and disarmed
+struct Timer {
+    Timer* next;
+    Timer** pprev;     // null while disarmed
+    uint32_t expires;  // tick
+    TimerCallback callback;
+    void* arg;
+};
+
+class TimerWheel {
+public:
+    void begin(unsigned long now_ms);
+
+    // Arm (or re-arm) `t` to fire `delay_ms` from the current tick
+    void arm(Timer& t, unsigned long delay_ms, TimerCallback callback, void* arg);
+    void cancel(Timer& t);
+    static bool armed(const Timer& t) { return t.pprev != nullptr; }
+
+    // Run every timer due up to `now_ms`
+    void advance(unsigned long now_ms);
+
+    uint32_t armed_count() const { return count; }
+
+private:
+    void insert(Timer& t);
+    void cascade(Timer** slot);
+    void run_tick();
+
+    Timer* levels[3][TIMER_WHEEL_SLOTS];
+    uint32_t current = 0; // next tick to process
+    uint32_t count = 0;
+    unsigned long last_ms = 0;
+    unsigned long pending_ms = 0;
+};
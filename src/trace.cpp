@@ -0,0 +1,33 @@
+#include "trace.h"
+
+TraceEvent trace_events[TRACE_CAPACITY];
+std::atomic<uint32_t> trace_head(0);
+std::atomic<bool> trace_paused(false);
+
+static_assert(sizeof(trace_events) + sizeof(trace_head) + sizeof(trace_paused) == TRACE_STATIC_BYTES,
+              "TRACE_STATIC_BYTES must count every object above");
+
+static const char* const trace_names[TRACE_ID_COUNT] = {
+    "mqtt_callback",
+    "draw_menu",
+    "draw_status_bar",
+    "reconnect_mqtt",
+    "publish"
+};
+
+void trace_dump(Print& out) {
+    trace_paused.store(true, std::memory_order_relaxed);
+
+    uint32_t head = trace_head.load(std::memory_order_relaxed);
+    uint32_t count = head < TRACE_CAPACITY ? head : TRACE_CAPACITY;
+    out.printf("TRACE BEGIN freq_mhz=%lu count=%lu\n",
+               (unsigned long)getCpuFrequencyMhz(), (unsigned long)count);
+    for (uint32_t i = head - count; i != head; i++) {
+        const TraceEvent& ev = trace_events[i & (TRACE_CAPACITY - 1)];
+        out.printf("%lu %c %u %s\n", (unsigned long)ev.cycles, ev.phase, ev.core,
+                   ev.id < TRACE_ID_COUNT ? trace_names[ev.id] : "?");
+    }
+    out.println("TRACE END");
+
+    trace_paused.store(false, std::memory_order_relaxed);
+}
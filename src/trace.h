@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ======= Trace Buffer =======
+// Fixed-size ring of timestamped begin/end events. Recording is a relaxed
+// fetch_add on the head plus one 8-byte store, timestamped with the CPU cycle
+// counter. Dump over Serial and convert with tools/trace_to_chrome.py.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 1024 // Events, must be a power of two
+#endif
+
+static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "TRACE_CAPACITY must be a power of two");
+
+enum TraceId : uint8_t {
+    TRACE_MQTT_CALLBACK,
+    TRACE_DRAW_MENU,
+    TRACE_DRAW_STATUS_BAR,
+    TRACE_RECONNECT_MQTT,
+    TRACE_PUBLISH,
+    TRACE_ID_COUNT
+};
+
+enum TracePhase : uint8_t { TRACE_BEGIN = 'B', TRACE_END = 'E' };
+
+struct TraceEvent {
+    uint32_t cycles;
+    uint8_t id;
+    uint8_t phase;
+    uint8_t core;
+    uint8_t reserved;
+};
+
+const size_t TRACE_STATIC_BYTES = sizeof(TraceEvent) * TRACE_CAPACITY + sizeof(std::atomic<uint32_t>) +
+                                  sizeof(std::atomic<bool>);
+
+extern TraceEvent trace_events[TRACE_CAPACITY];
+extern std::atomic<uint32_t> trace_head;
+extern std::atomic<bool> trace_paused;
+
+inline void trace_record(TraceId id, TracePhase phase) {
+#if TRACE_ENABLED
+    if (trace_paused.load(std::memory_order_relaxed)) return;
+    uint32_t slot = trace_head.fetch_add(1, std::memory_order_relaxed) & (TRACE_CAPACITY - 1);
+    trace_events[slot] = {ESP.getCycleCount(), id, phase, (uint8_t)xPortGetCoreID(), 0};
+#endif
+}
+
+// Records a begin event on construction and an end event on destruction
+struct TraceScope {
+    TraceId id;
+    explicit TraceScope(TraceId id) : id(id) { trace_record(id, TRACE_BEGIN); }
+    ~TraceScope() { trace_record(id, TRACE_END); }
+};
+
+#if TRACE_ENABLED
+#define TRACE_SCOPE(id) TraceScope trace_scope(id)
+#else
+#define TRACE_SCOPE(id) do {} while (0)
+#endif
+
+// Print the buffered events, oldest first, between TRACE BEGIN/END markers
+void trace_dump(Print& out);
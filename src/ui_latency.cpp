@@ -0,0 +1,76 @@
+#include "ui_latency.h"
+
+static const char* const action_names[UI_ACTION_COUNT] = {"navigate", "select", "toggle"};
+
+static UiLatencyHistogram histograms[UI_ACTION_COUNT] = {};
+static bool pending = false;
+static UiAction pending_action = UI_ACTION_NAVIGATE;
+static uint32_t pending_input_us = 0;
+
+static_assert(sizeof(histograms) + sizeof(pending) + sizeof(pending_action) + sizeof(pending_input_us) ==
+                  UI_LATENCY_STATIC_BYTES,
+              "UI_LATENCY_STATIC_BYTES must count every static above");
+
+void ui_latency_input(UiAction action, uint32_t input_us) {
+    pending = true;
+    pending_action = action;
+    pending_input_us = input_us;
+}
+
+void ui_latency_classify(UiAction action) {
+    if (pending) pending_action = action;
+}
+
+void ui_latency_frame_done() {
+    if (!pending) return;
+    pending = false;
+
+    uint32_t elapsed_us = micros() - pending_input_us;
+    int bucket = 0;
+    while (bucket < UI_LATENCY_BUCKETS - 1 && elapsed_us >= (1UL << (bucket + 1))) {
+        bucket++;
+    }
+    UiLatencyHistogram& h = histograms[pending_action];
+    h.buckets[bucket]++;
+    h.count++;
+    h.total_us += elapsed_us;
+    if (elapsed_us > h.max_us) h.max_us = elapsed_us;
+}
+
+void ui_latency_discard() {
+    pending = false;
+}
+
+const UiLatencyHistogram& ui_latency_histogram(UiAction action) {
+    return histograms[action];
+}
+
+// Upper bound of the bucket holding the given fraction of samples, capped at the max
+static uint32_t percentile_us(const UiLatencyHistogram& h, uint32_t per_mille) {
+    uint32_t threshold = (uint32_t)(((uint64_t)h.count * per_mille + 999) / 1000);
+    uint32_t seen = 0;
+    for (int i = 0; i < UI_LATENCY_BUCKETS; i++) {
+        seen += h.buckets[i];
+        if (seen >= threshold) return min((uint32_t)(1UL << (i + 1)), h.max_us);
+    }
+    return h.max_us;
+}
+
+void ui_latency_print(Print& out) {
+    for (int a = 0; a < UI_ACTION_COUNT; a++) {
+        const UiLatencyHistogram& h = histograms[a];
+        if (h.count == 0) {
+            out.printf("UI %-8s count=0\n", action_names[a]);
+            continue;
+        }
+        out.printf("UI %-8s count=%lu mean=%luus p50<%luus p90<%luus p99<%luus max=%luus\n",
+                   action_names[a], (unsigned long)h.count, (unsigned long)(h.total_us / h.count),
+                   (unsigned long)percentile_us(h, 500), (unsigned long)percentile_us(h, 900),
+                   (unsigned long)percentile_us(h, 990), (unsigned long)h.max_us);
+        for (int i = 0; i < UI_LATENCY_BUCKETS; i++) {
+            if (h.buckets[i]) {
+                out.printf("  <%7luus %lu\n", (unsigned long)(1UL << (i + 1)), (unsigned long)h.buckets[i]);
+            }
+        }
+    }
+}
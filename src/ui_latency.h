@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+
+// ======= UI Latency =======
+// Input-to-photon latency per UI action. loop() stamps a button press when
+// it dispatches it, and the first frame that finishes pushing to the LCD
+// afterwards closes the measurement into that action's histogram. Print
+// the histograms with the 'u' serial command.
+
+enum UiAction {
+    UI_ACTION_NAVIGATE,
+    UI_ACTION_SELECT,
+    UI_ACTION_TOGGLE,
+    UI_ACTION_COUNT
+};
+
+const int UI_LATENCY_BUCKETS = 20; // Power-of-two microsecond buckets, up to ~1 s
+
+struct UiLatencyHistogram {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[UI_LATENCY_BUCKETS];
+};
+
+// The histograms and the press awaiting its frame; the action names are in flash
+const size_t UI_LATENCY_STATIC_BYTES = UI_ACTION_COUNT * sizeof(UiLatencyHistogram) + sizeof(bool) +
+                                       sizeof(UiAction) + sizeof(uint32_t);
+
+// A press was read at `input_us` (micros()) and is dispatched as `action`
+void ui_latency_input(UiAction action, uint32_t input_us);
+
+// Reclassify the pending press, e.g. a select that turned out to be a toggle
+void ui_latency_classify(UiAction action);
+
+// A frame has finished pushing to the LCD; closes the pending press, if any
+void ui_latency_frame_done();
+
+// Drop a press that produced no frame, so a later redraw is not charged to it
+void ui_latency_discard();
+
+const UiLatencyHistogram& ui_latency_histogram(UiAction action);
+
+// Print count, mean, p50/p90/p99 (bucket upper bounds) and max per action
+void ui_latency_print(Print& out);
@@ -0,0 +1,78 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <vector>
+#include "broker_pool.h"
+
+// ======= Broker Failover =======
+// A primary at 2 ms and a standby at 12 ms RTT. The primary is stopped
+// and restarted five times. Each time the panel must move to the standby
+// within the reconnect spread of noticing the loss, with its subscriptions
+// restored, and fail back only after the primary has probed healthy for
+// BROKER_FAILBACK_HOLD.
+
+static SimBroker primary("broker-a", 1883, 2000);
+static SimBroker standby("broker-b", 1883, 12000);
+
+extern unsigned long mqtt_lost_time;  // main.cpp
+extern unsigned long next_connect_attempt;
+static const unsigned long RECONNECT_SPREAD = 3000;  // As in main.cpp
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_connects_to_the_faster_broker() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return primary.connected(sim_client_id()); }, 10000));
+    // Both probed at least once
+    sim_run_ms(2 * BROKER_PROBE_INTERVAL);
+    TEST_ASSERT_NOT_EQUAL(0, broker_pool_status(1).rtt_us);
+    TEST_ASSERT_TRUE(broker_pool_status(1).healthy);
+    TEST_ASSERT_FALSE(standby.connected(sim_client_id()));
+}
+
+void test_failover_and_failback() {
+    std::vector<uint64_t> failover_ms;
+    std::vector<uint64_t> connect_ms;  // From the spread-out attempt to connected
+    std::vector<uint64_t> failback_ms;
+    for (int round = 0; round < 5; round++) {
+        unsigned long killed = millis();
+        primary.set_up(false);
+        TEST_ASSERT_TRUE(sim_run_until([] { return standby.connected(sim_client_id()); }, 10000));
+        unsigned long noticed = mqtt_lost_time;
+        TEST_ASSERT_LESS_OR_EQUAL(100, noticed - killed);
+        failover_ms.push_back(millis() - noticed);
+        connect_ms.push_back(millis() - next_connect_attempt);
+        TEST_ASSERT_LESS_OR_EQUAL(RECONNECT_SPREAD + 100, millis() - noticed);
+        sim_run_ms(500);
+        TEST_ASSERT_FALSE(standby.subscriptions(sim_client_id()).empty());
+
+        unsigned long restarted = millis();
+        primary.set_up(true);
+        TEST_ASSERT_TRUE(sim_run_until([] { return primary.connected(sim_client_id()); }, 120000));
+        unsigned long back = millis() - restarted;
+        failback_ms.push_back(back);
+        // Probed healthy within one interval of restarting, then held
+        TEST_ASSERT_GREATER_OR_EQUAL(BROKER_FAILBACK_HOLD, back);
+        TEST_ASSERT_LESS_OR_EQUAL(BROKER_FAILBACK_HOLD + 2 * BROKER_PROBE_INTERVAL + RECONNECT_SPREAD, back);
+        sim_run_ms(500);
+        TEST_ASSERT_FALSE(primary.subscriptions(sim_client_id()).empty());
+        TEST_ASSERT_FALSE(standby.connected(sim_client_id()));
+    }
+    char line[200];
+    snprintf(line, sizeof(line),
+             "loss to standby connected: p50=%lu max=%lu ms (connect itself max %lu ms); "
+             "restart to failback: p50=%lu max=%lu ms",
+             (unsigned long)sim_percentile(failover_ms, 50), (unsigned long)sim_percentile(failover_ms, 100),
+             (unsigned long)sim_percentile(connect_ms, 100),
+             (unsigned long)sim_percentile(failback_ms, 50), (unsigned long)sim_percentile(failback_ms, 100));
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_to_the_faster_broker);
+    RUN_TEST(test_failover_and_failback);
+    return UNITY_END();
+}
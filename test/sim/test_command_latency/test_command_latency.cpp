@@ -0,0 +1,97 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <vector>
+#include "log.h"
+#include "log_shipper.h"
+
+// ======= Command Latency Under Log Shipping =======
+// Button press to the toggle command arriving at the broker, with log
+// shipping idle and with it saturated by a steady stream of records. The
+// uplink is 2 Mbit/s with a 4 ms RTT, so a shipped chunk written just
+// ahead of a command would hold it up by several milliseconds.
+
+static SimBroker broker("broker-a", 1883, 4000);
+static const char* const hallway_control = "home/m5stack/core2/devices/hallway/control";
+
+// Loop for `ms`, logging `lines_per_100ms` hard-to-compress records meanwhile
+static void run_with_logs(uint32_t ms, int lines_per_100ms) {
+    for (uint32_t t = 0; t < ms; t += 100) {
+        for (int i = 0; i < lines_per_100ms; i++) {
+            LOG_INFO("load %08lx %08lx %08lx %08lx %08lx %08lx", random(0x7fffffff), random(0x7fffffff),
+                     random(0x7fffffff), random(0x7fffffff), random(0x7fffffff), random(0x7fffffff));
+        }
+        sim_run_ms(100);
+    }
+}
+
+// Toggles the hallway lights `count` times; latency of each command in us
+static std::vector<uint64_t> toggle_latencies(int count, int lines_per_100ms) {
+    std::vector<uint64_t> latencies;
+    for (int i = 0; i < count; i++) {
+        run_with_logs(500 + random(2000), lines_per_100ms);
+        broker.clear_received();
+        uint64_t pressed = host_now_us();
+        sim_press(SIM_BTN_B);
+        bool sent = sim_run_until(
+            [] {
+                for (const SimPublish& p : broker.received()) {
+                    if (p.topic == hallway_control) return true;
+                }
+                return false;
+            },
+            5000);
+        TEST_ASSERT_TRUE_MESSAGE(sent, "toggle command never reached the broker");
+        for (const SimPublish& p : broker.received()) {
+            if (p.topic == hallway_control) latencies.push_back(p.at_us - pressed);
+        }
+    }
+    return latencies;
+}
+
+static void report(const char* series, std::vector<uint64_t>& latencies) {
+    char line[128];
+    snprintf(line, sizeof(line), "%s: p50=%lu p99=%lu max=%lu us over %u commands", series,
+             (unsigned long)sim_percentile(latencies, 50), (unsigned long)sim_percentile(latencies, 99),
+             (unsigned long)sim_percentile(latencies, 100), (unsigned)latencies.size());
+    TEST_MESSAGE(line);
+}
+
+static std::vector<uint64_t> idle;
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_open_devices_screen() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    sim_press(SIM_BTN_B);  // "Devices" is selected on the main menu
+    sim_run_ms(500);
+}
+
+void test_latency_with_shipping_idle() {
+    idle = toggle_latencies(40, 0);
+    report("shipping idle", idle);
+}
+
+void test_latency_with_shipping_saturated() {
+    uint32_t sent_before = log_ship_stats().sent_bytes;
+    std::vector<uint64_t> busy = toggle_latencies(40, 3);
+    report("shipping saturated", busy);
+    char line[96];
+    snprintf(line, sizeof(line), "log bytes shipped meanwhile: %lu",
+             (unsigned long)(log_ship_stats().sent_bytes - sent_before));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, log_ship_stats().sent_bytes - sent_before);
+    // Shipping waits for quiet and is rate limited, so commands barely notice it
+    TEST_ASSERT_LESS_OR_EQUAL(sim_percentile(idle, 99) + 2000, sim_percentile(busy, 99));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_devices_screen);
+    RUN_TEST(test_latency_with_shipping_idle);
+    RUN_TEST(test_latency_with_shipping_saturated);
+    return UNITY_END();
+}
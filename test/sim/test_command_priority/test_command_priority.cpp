@@ -0,0 +1,114 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <vector>
+#include "outbound.h"
+
+// ======= Command Latency Under a Telemetry Flood =======
+// Button press to the toggle command arriving at the broker, idle and
+// while telemetry offers 300 KB/s on LANE_TELEMETRY, more than the 2 Mbit/s
+// uplink carries. The lane lets through what its buckets allow and refuses
+// the rest, so a command waits behind at most one telemetry message on the
+// wire instead of behind everything offered.
+
+static SimBroker broker("broker-a", 1883, 4000);
+static const char* const hallway_control = "home/m5stack/core2/devices/hallway/control";
+static const char* const flood_topic = "home/m5stack/core2/telemetry/flood";
+static const size_t FLOOD_MESSAGE = 1500;
+static const int FLOOD_MESSAGES = 2;  // Per interval
+static const uint32_t FLOOD_INTERVAL_MS = 10;
+static const uint32_t UPLINK_BPS = 2000000;
+
+static uint8_t flood_payload[FLOOD_MESSAGE];
+static uint32_t flood_offered;
+
+// Loop for `ms`, offering FLOOD_MESSAGES telemetry messages every FLOOD_INTERVAL_MS if `flood`
+static void run_with_flood(uint32_t ms, bool flood) {
+    for (uint32_t t = 0; t < ms; t += FLOOD_INTERVAL_MS) {
+        for (int i = 0; flood && i < FLOOD_MESSAGES; i++) {
+            outbound_publish(LANE_TELEMETRY, flood_topic, flood_payload, sizeof(flood_payload), false);
+            flood_offered++;
+        }
+        sim_run_ms(FLOOD_INTERVAL_MS);
+    }
+}
+
+// Toggles the hallway lights `count` times; latency of each command in us
+static std::vector<uint64_t> toggle_latencies(int count, bool flood) {
+    std::vector<uint64_t> latencies;
+    for (int i = 0; i < count; i++) {
+        run_with_flood(500 + random(2000), flood);
+        broker.clear_received();
+        uint64_t pressed = host_now_us();
+        sim_press(SIM_BTN_B);
+        bool sent = sim_run_until(
+            [] {
+                for (const SimPublish& p : broker.received()) {
+                    if (p.topic == hallway_control) return true;
+                }
+                return false;
+            },
+            5000);
+        TEST_ASSERT_TRUE_MESSAGE(sent, "toggle command never reached the broker");
+        for (const SimPublish& p : broker.received()) {
+            if (p.topic == hallway_control) latencies.push_back(p.at_us - pressed);
+        }
+    }
+    return latencies;
+}
+
+static void report(const char* series, std::vector<uint64_t>& latencies) {
+    char line[128];
+    snprintf(line, sizeof(line), "%s: p50=%lu p99=%lu max=%lu us over %u commands", series,
+             (unsigned long)sim_percentile(latencies, 50), (unsigned long)sim_percentile(latencies, 99),
+             (unsigned long)sim_percentile(latencies, 100), (unsigned)latencies.size());
+    TEST_MESSAGE(line);
+}
+
+static std::vector<uint64_t> idle;
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_open_devices_screen() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    broker.set_uplink_bps(UPLINK_BPS);
+    memset(flood_payload, 'x', sizeof(flood_payload));
+    sim_press(SIM_BTN_B);  // "Devices" is selected on the main menu
+    sim_run_ms(500);
+}
+
+void test_latency_idle() {
+    idle = toggle_latencies(40, false);
+    report("telemetry idle", idle);
+}
+
+void test_latency_under_telemetry_flood() {
+    OutboundLaneStats before = outbound_stats(LANE_TELEMETRY);
+    flood_offered = 0;
+    std::vector<uint64_t> flooded = toggle_latencies(40, true);
+    report("telemetry flood", flooded);
+    OutboundLaneStats after = outbound_stats(LANE_TELEMETRY);
+    char line[128];
+    snprintf(line, sizeof(line), "telemetry offered %lu, sent %lu, refused %lu",
+             (unsigned long)flood_offered, (unsigned long)(after.sent - before.sent),
+             (unsigned long)(after.deferred - before.deferred));
+    TEST_MESSAGE(line);
+
+    // At worst the command is written just behind the largest message the
+    // telemetry lane lets out, and waits for it to leave the uplink
+    uint64_t one_message_us = (uint64_t)outbound_lanes[LANE_TELEMETRY].byte_burst * 8 * 1000000 / UPLINK_BPS;
+    TEST_ASSERT_LESS_OR_EQUAL(sim_percentile(idle, 99) + one_message_us, sim_percentile(flooded, 99));
+    TEST_ASSERT_GREATER_THAN(0, after.sent - before.sent);
+    TEST_ASSERT_GREATER_THAN(flood_offered / 2, after.deferred - before.deferred);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_devices_screen);
+    RUN_TEST(test_latency_idle);
+    RUN_TEST(test_latency_under_telemetry_flood);
+    return UNITY_END();
+}
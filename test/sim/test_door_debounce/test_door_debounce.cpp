@@ -0,0 +1,127 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <vector>
+#include "alert_manager.h"
+#include "state_store.h"
+#include "timer_wheel.h"
+
+// ======= Door Debounce Replay =======
+// Replays a noisy fridge reed switch through the broker and watches the
+// debounced door state after every loop() iteration. The trace is generated
+// from a fixed seed so every run sees the same events:
+//   flapping  3 s of OPEN/CLOSED alternating every 20-60 ms
+//   opening   OPEN republished every 30-70 ms, with bursts of duplicates
+//   open      the same for long enough to raise the open alert
+//   closing   flapping, then CLOSED republished every 30-70 ms
+
+static SimBroker broker("broker-a", 1883, 2000);
+static const char* const fridge_topic = "home/m5stack/core2/fridge_door/status";
+static const unsigned long SETTLE_MS = 500;  // door_sensors[] in main.cpp
+
+struct Transition {
+    uint64_t at_us;
+    bool open;
+};
+
+static std::vector<Transition> transitions;
+static bool last_open = false;
+
+static bool fridge_open() {
+    return state_door_open(state_current(), 0);
+}
+
+static void step(uint32_t ms) {
+    uint64_t end = host_now_us() + (uint64_t)ms * 1000;
+    while (host_now_us() < end) {
+        loop();
+        if (fridge_open() != last_open) {
+            last_open = fridge_open();
+            transitions.push_back({host_now_us(), last_open});
+        }
+    }
+}
+
+static void flap(uint32_t duration_ms) {
+    for (uint32_t t = 0, i = 0; t < duration_ms; i++) {
+        broker.publish(fridge_topic, i % 2 ? "CLOSED" : "OPEN");
+        uint32_t gap = 20 + random(41);
+        step(gap);
+        t += gap;
+    }
+    broker.publish(fridge_topic, last_open ? "OPEN" : "CLOSED");  // Ends where it started
+    step(50);
+}
+
+static void stream(const char* payload, uint32_t duration_ms) {
+    for (uint32_t t = 0; t < duration_ms;) {
+        int copies = random(4) == 0 ? 1 + random(4) : 1;  // Some sensors repeat themselves
+        for (int c = 0; c < copies; c++) broker.publish(fridge_topic, payload);
+        uint32_t gap = 30 + random(41);
+        step(gap);
+        t += gap;
+    }
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_connect() {
+    randomSeed(59);
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    sim_run_ms(1000);  // Subscriptions acknowledged
+    last_open = fridge_open();
+    TEST_ASSERT_FALSE(last_open);
+}
+
+void test_flapping_is_not_accepted() {
+    flap(3000);
+    TEST_ASSERT_EQUAL_INT(0, (int)transitions.size());
+}
+
+void test_streamed_open_is_accepted_after_settle_time() {
+    uint64_t start = host_now_us();
+    stream("OPEN", 2000);
+    TEST_ASSERT_EQUAL_INT(1, (int)transitions.size());
+    TEST_ASSERT_TRUE(transitions[0].open);
+    // It must hold for the settle time, give or take one 100 ms wheel tick
+    uint64_t accepted_ms = (transitions[0].at_us - start) / 1000;
+    TEST_ASSERT_GREATER_OR_EQUAL(SETTLE_MS - TIMER_TICK_MS, accepted_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(SETTLE_MS + 150, accepted_ms);
+}
+
+void test_open_door_raises_alert() {
+    stream("OPEN", 5000);
+    TEST_ASSERT_TRUE(alert_any_visible());
+    TEST_ASSERT_EQUAL_INT(1, (int)transitions.size());
+}
+
+void test_closing_through_flapping() {
+    flap(2000);
+    stream("CLOSED", 2000);
+    TEST_ASSERT_EQUAL_INT(2, (int)transitions.size());
+    TEST_ASSERT_FALSE(transitions[1].open);
+    TEST_ASSERT_FALSE(fridge_open());
+}
+
+void test_at_most_one_change_per_settle_window() {
+    for (size_t i = 1; i < transitions.size(); i++) {
+        TEST_ASSERT_GREATER_OR_EQUAL((SETTLE_MS - TIMER_TICK_MS) * 1000, transitions[i].at_us - transitions[i - 1].at_us);
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "debounced transitions: %u", (unsigned)transitions.size());
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_connect);
+    RUN_TEST(test_flapping_is_not_accepted);
+    RUN_TEST(test_streamed_open_is_accepted_after_settle_time);
+    RUN_TEST(test_open_door_raises_alert);
+    RUN_TEST(test_closing_through_flapping);
+    RUN_TEST(test_at_most_one_change_per_settle_window);
+    return UNITY_END();
+}
@@ -0,0 +1,122 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ======= Fleet Reconnect =======
+// FLEET_SIZE panels, each its own forked process with its own MAC and RNG
+// seed (the ESP32's random() is the hardware RNG), lose the primary at the
+// same virtual moment. It comes back BROKER_OUTAGE later; the standby stays
+// down throughout. What the broker sees of the fleet is the panels' connect
+// times merged: every panel must reconnect exactly once under a distinct
+// client ID, the connects must be spread rather than arrive together, and
+// the whole fleet must be back within the reconnect spread and one backoff.
+
+static SimBroker primary("broker-a", 1883, 2000);
+static SimBroker standby("broker-b", 1883, 12000);
+
+static const int FLEET_SIZE = 50;
+static const unsigned long BROKER_DOWN_AT = 20000;  // Every panel is connected and settled by then
+static const unsigned long BROKER_OUTAGE = 2000;
+static const unsigned long RECONNECT_SPREAD = 3000;  // As in main.cpp
+static const unsigned long RECONNECT_BACKOFF_MIN = 2000;
+static const unsigned long BUCKET_MS = 250;
+static const int MAX_CONNECTS_PER_BUCKET = FLEET_SIZE / 3;  // A stampede puts the whole fleet in one
+
+struct PanelResult {
+    char client_id[24];
+    uint32_t back_ms;   // Broker restart to this panel connected
+    uint32_t connects;  // Connections the broker accepted from it after the restart
+    bool connected;
+};
+
+// Runs in the child: one panel through the outage
+static PanelResult run_panel(int index) {
+    WiFi.sim_mac[4] = index >> 8;
+    WiFi.sim_mac[5] = index;
+    randomSeed(1000 + index);
+    standby.set_up(false);
+    sim_boot();
+
+    PanelResult result = {};
+    snprintf(result.client_id, sizeof(result.client_id), "%s", sim_client_id());
+    if (!sim_run_until([] { return primary.connected(sim_client_id()); }, BROKER_DOWN_AT)) return result;
+    sim_run_ms(BROKER_DOWN_AT - millis());
+
+    primary.set_up(false);
+    sim_run_ms(BROKER_OUTAGE);
+    primary.set_up(true);
+    unsigned long restarted = millis();
+    uint32_t connects_before = primary.connects();
+    result.connected = sim_run_until([] { return primary.connected(sim_client_id()); }, 60000);
+    result.back_ms = millis() - restarted;
+    sim_run_ms(5000);  // Long enough to see a session being taken over and reconnected
+    result.connects = primary.connects() - connects_before;
+    return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_fleet_reconnects_spread_out() {
+    int fds[2];
+    TEST_ASSERT_EQUAL(0, pipe(fds));
+    fflush(stdout);
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        pid_t pid = fork();
+        TEST_ASSERT_NOT_EQUAL(-1, pid);
+        if (pid == 0) {
+            close(fds[0]);
+            PanelResult result = run_panel(i);
+            bool written = write(fds[1], &result, sizeof(result)) == (ssize_t)sizeof(result);
+            _exit(written ? 0 : 1);
+        }
+    }
+    close(fds[1]);
+
+    std::vector<PanelResult> fleet;
+    PanelResult result;
+    while (read(fds[0], &result, sizeof(result)) == (ssize_t)sizeof(result)) fleet.push_back(result);
+    close(fds[0]);
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        int status;
+        wait(&status);
+        TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    TEST_ASSERT_EQUAL(FLEET_SIZE, fleet.size());
+
+    std::set<std::string> ids;
+    std::vector<int> buckets;
+    std::vector<uint64_t> back_ms;
+    for (const PanelResult& panel : fleet) {
+        TEST_ASSERT_TRUE_MESSAGE(panel.connected, panel.client_id);
+        TEST_ASSERT_EQUAL_MESSAGE(1, panel.connects, panel.client_id);
+        ids.insert(panel.client_id);
+        size_t bucket = panel.back_ms / BUCKET_MS;
+        if (bucket >= buckets.size()) buckets.resize(bucket + 1);
+        buckets[bucket]++;
+        back_ms.push_back(panel.back_ms);
+    }
+    TEST_ASSERT_EQUAL(FLEET_SIZE, ids.size());
+    int peak = 0;
+    for (int n : buckets) peak = max(peak, n);
+    uint64_t last = sim_percentile(back_ms, 100);
+
+    char line[160];
+    snprintf(line, sizeof(line), "%d panels: peak %d connects per %lu ms, p50 %lu ms, all back %lu ms after restart",
+             FLEET_SIZE, peak, BUCKET_MS, (unsigned long)sim_percentile(back_ms, 50), (unsigned long)last);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_CONNECTS_PER_BUCKET, peak);
+    // The last to return tried just before the restart and then waited one backoff
+    TEST_ASSERT_LESS_OR_EQUAL(max(RECONNECT_SPREAD - BROKER_OUTAGE, RECONNECT_BACKOFF_MIN) + 100, last);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fleet_reconnects_spread_out);
+    return UNITY_END();
+}
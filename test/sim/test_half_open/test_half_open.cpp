@@ -0,0 +1,68 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <vector>
+#include "link_monitor.h"
+
+// ======= Half-Open Detection =======
+// The control connection goes half-open (both ends think it is up, nothing
+// gets through) 20-27 s after connecting. The link monitor's unanswered
+// probes must drop it and reconnect within a couple of probe intervals,
+// at LAN, WAN and poor-uplink round trip times.
+
+static SimBroker broker("broker-a", 1883, 8000);
+
+static const int TRIALS = 30;
+
+extern unsigned long mqtt_lost_time;  // main.cpp
+
+static void measure(uint32_t rtt_ms) {
+    broker.set_rtt_us(rtt_ms * 1000);
+    std::vector<uint64_t> detect_ms;
+    for (int trial = 0; trial < TRIALS; trial++) {
+        TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 30000));
+        sim_run_ms(random(20000, 27000));
+
+        unsigned long lost_before = mqtt_lost_time;
+        unsigned long start = millis();
+        broker.set_half_open(true);
+        TEST_ASSERT_TRUE(sim_run_until([&] { return mqtt_lost_time != lost_before; }, 60000));
+        detect_ms.push_back(mqtt_lost_time - start);
+        broker.set_half_open(false);
+    }
+
+    uint64_t total = 0;
+    for (uint64_t ms : detect_ms) total += ms;
+    char line[120];
+    snprintf(line, sizeof(line), "RTT %lu ms: detected in min %lu / mean %lu / max %lu ms over %d trials",
+             (unsigned long)rtt_ms, (unsigned long)sim_percentile(detect_ms, 0), (unsigned long)(total / TRIALS),
+             (unsigned long)sim_percentile(detect_ms, 100), TRIALS);
+    TEST_MESSAGE(line);
+    // One probe interval to the next probe, then two timeouts at most
+    TEST_ASSERT_LESS_OR_EQUAL(LINK_PROBE_INTERVAL + LINK_DEAD_PROBES * LINK_TIMEOUT_MAX, sim_percentile(detect_ms, 100));
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_half_open_lan() {
+    measure(8);
+}
+
+void test_half_open_wan() {
+    measure(80);
+}
+
+void test_half_open_slow_uplink() {
+    measure(400);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_half_open_lan);
+    RUN_TEST(test_half_open_wan);
+    RUN_TEST(test_half_open_slow_uplink);
+    return UNITY_END();
+}
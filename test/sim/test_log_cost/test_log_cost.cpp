@@ -0,0 +1,102 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <chrono>
+#include <vector>
+#include "log.h"
+#include "mqtt_codec.h"
+
+// ======= Callback Cost With Logging On and Off =======
+// Times mqtt_callback() on bursts like the one the Devices screen gets when
+// it subscribes: both door reports and every retained device state at once.
+// Run it in env:native-sim (PANEL_LOG_LEVEL=DEBUG, the callback logs every
+// message) and env:native-sim-nolog (logging compiled out). A third series
+// prints each message synchronously to Serial, as the firmware did before
+// the async logger, for comparison.
+//
+// Two times per callback: virtual microseconds, in which only blocking
+// counts (the simulated UART at 115200 baud with its 128-byte FIFO), and
+// host CPU nanoseconds, which scale to the ESP32 only roughly.
+
+void mqtt_callback(const MqttPublish& message);
+
+static SimBroker broker("broker-a", 1883);
+
+static const char* const burst_topics[] = {
+    "home/m5stack/core2/fridge_door/status",
+    "home/m5stack/core2/freezer_door/status",
+    "home/m5stack/core2/devices/hallway/state",
+    "home/m5stack/core2/devices/living_tree/state",
+    "home/m5stack/core2/devices/left_lamp/state",
+    "home/m5stack/core2/devices/right_lamp1/state",
+    "home/m5stack/core2/devices/right_lamp2/state",
+    "home/m5stack/core2/devices/spotlight/state",
+};
+static const int BURST = sizeof(burst_topics) / sizeof(burst_topics[0]);
+static const int BURSTS = 50;
+
+struct CallbackTimes {
+    std::vector<uint64_t> virtual_us;
+    std::vector<uint64_t> host_ns;
+};
+
+static CallbackTimes run_bursts(bool print_synchronously) {
+    CallbackTimes times;
+    for (int b = 0; b < BURSTS; b++) {
+        const char* payload = b % 2 ? "OPEN" : "CLOSED";
+        for (int i = 0; i < BURST; i++) {
+            if (i >= 2) payload = b % 2 ? "ON" : "OFF";
+            MqttPublish message = {};
+            message.topic = {(const uint8_t*)burst_topics[i], strlen(burst_topics[i])};
+            message.payload = {(const uint8_t*)payload, strlen(payload)};
+
+            uint64_t start_us = host_now_us();
+            auto start = std::chrono::steady_clock::now();
+            mqtt_callback(message);
+            if (print_synchronously) {
+                Serial.printf("Received message on topic: %s with payload: %s\n", burst_topics[i], payload);
+            }
+            auto end = std::chrono::steady_clock::now();
+            times.virtual_us.push_back(host_now_us() - start_us);
+            times.host_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+        sim_run_ms(1000);  // Lets the log drain and the door settle timers run
+    }
+    return times;
+}
+
+static void report(const char* series, CallbackTimes& times) {
+    char line[160];
+    snprintf(line, sizeof(line), "%s: virtual p50=%lu p99=%lu max=%lu us, host p50=%lu p99=%lu ns", series,
+             (unsigned long)sim_percentile(times.virtual_us, 50), (unsigned long)sim_percentile(times.virtual_us, 99),
+             (unsigned long)sim_percentile(times.virtual_us, 100), (unsigned long)sim_percentile(times.host_ns, 50),
+             (unsigned long)sim_percentile(times.host_ns, 99));
+    TEST_MESSAGE(line);
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_async_logging_never_blocks_the_callback() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    CallbackTimes times = run_bursts(false);
+    report(PANEL_LOG_LEVEL >= LOG_LEVEL_DEBUG ? "logging on" : "logging off", times);
+    TEST_ASSERT_EQUAL_UINT32(0, log_stats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, sim_percentile(times.virtual_us, 100));
+}
+
+void test_synchronous_serial_blocks_on_bursts() {
+    CallbackTimes times = run_bursts(true);
+    report("synchronous Serial", times);
+    // Once the FIFO is full every line waits out its own transmission
+    TEST_ASSERT_GREATER_THAN(4000, sim_percentile(times.virtual_us, 99));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_async_logging_never_blocks_the_callback);
+    RUN_TEST(test_synchronous_serial_blocks_on_bursts);
+    return UNITY_END();
+}
@@ -0,0 +1,96 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <string>
+#include <vector>
+#include "state_store.h"
+
+// ======= Scene Apply Latency =======
+// Selects each scene with local targets in turn, three rounds, and times
+// the press to the arrival of the scene's first and last device command at
+// the broker (4 ms RTT). Only devices whose state differs are commanded.
+
+static SimBroker broker("broker-a", 1883, 4000);
+
+// scenes[] in main.cpp, the ones with targets
+static const char* const scene_targets[] = {"111110", "111000", "100000", "001111",
+                                            "001111", "01100-", "01110-", "111110"};
+static const int num_scenes = sizeof(scene_targets) / sizeof(scene_targets[0]);
+static const int num_devices = 6;
+
+static bool is_control_topic(const std::string& topic) {
+    return topic.compare(0, 27, "home/m5stack/core2/devices/") == 0 &&
+           topic.size() > 8 && topic.compare(topic.size() - 8, 8, "/control") == 0;
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_open_scenes_screen() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    sim_press(SIM_BTN_C);  // Main menu: down to "Scenes"
+    sim_run_ms(200);
+    sim_press(SIM_BTN_B);
+    sim_run_ms(500);
+    TEST_ASSERT_EQUAL_INT(2, state_current().menu);  // SCENES_MENU
+}
+
+void test_scene_latency() {
+    std::vector<uint64_t> first_us;
+    std::vector<uint64_t> last_us;
+    int commands = 0;
+    int selected = 0;  // Selecting a scene puts the cursor back on the first one
+    for (int round = 0; round < 3; round++) {
+        for (int scene = 0; scene < num_scenes; scene++) {
+            for (int i = selected; i < scene; i++) {
+                sim_press(SIM_BTN_C);
+                sim_run_ms(100);
+            }
+            bool expected[num_devices];
+            int changes = 0;
+            for (int d = 0; d < num_devices; d++) {
+                bool on = state_device_on(state_current(), d);
+                char target = scene_targets[scene][d];
+                expected[d] = target == '-' ? on : target == '1';
+                if (expected[d] != on) changes++;
+            }
+
+            broker.clear_received();
+            uint64_t pressed = host_now_us();
+            sim_press(SIM_BTN_B);
+            sim_run_ms(2500);  // Includes the 2 s confirmation toast
+
+            int seen = 0;
+            for (const SimPublish& p : broker.received()) {
+                if (!is_control_topic(p.topic)) continue;
+                if (seen == 0) first_us.push_back(p.at_us - pressed);
+                last_us.push_back(p.at_us - pressed);
+                seen++;
+            }
+            if (seen > 1) last_us.erase(last_us.end() - seen, last_us.end() - 1);
+            TEST_ASSERT_EQUAL_INT(changes, seen);
+            for (int d = 0; d < num_devices; d++) {
+                TEST_ASSERT_EQUAL_INT(expected[d], state_device_on(state_current(), d));
+            }
+            commands += seen;
+            selected = 0;
+        }
+    }
+    char line[160];
+    snprintf(line, sizeof(line), "%d commands over %d scene applies: first p50=%lu p99=%lu us, last p50=%lu p99=%lu us",
+             commands, 3 * num_scenes, (unsigned long)sim_percentile(first_us, 50),
+             (unsigned long)sim_percentile(first_us, 99), (unsigned long)sim_percentile(last_us, 50),
+             (unsigned long)sim_percentile(last_us, 99));
+    TEST_MESSAGE(line);
+    // The scene goes out back to back: the last command lands within 1 ms of the first
+    TEST_ASSERT_LESS_OR_EQUAL(sim_percentile(first_us, 99) + 1000, sim_percentile(last_us, 99));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_scenes_screen);
+    RUN_TEST(test_scene_latency);
+    return UNITY_END();
+}
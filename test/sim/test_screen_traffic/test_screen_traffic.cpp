@@ -0,0 +1,130 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <string>
+#include "state_store.h"
+
+// ======= Inbound Traffic Per Screen =======
+// Each device reports its retained state every 10 s and each door its
+// status every 60 s, as in a house where other panels and automations are
+// busy. Counts the PUBLISH messages and bytes the broker sends the panel
+// on the main menu and on the Devices screen, awake and then asleep, against
+// what it would have sent with every topic subscribed all the time: the
+// same plus every state report it was spared.
+
+static SimBroker broker("broker-a", 1883, 2000);
+
+// devices[] and door_sensors[] in main.cpp
+static const char* const state_topics[] = {
+    "home/m5stack/core2/devices/hallway/state",     "home/m5stack/core2/devices/living_tree/state",
+    "home/m5stack/core2/devices/left_lamp/state",   "home/m5stack/core2/devices/right_lamp1/state",
+    "home/m5stack/core2/devices/right_lamp2/state", "home/m5stack/core2/devices/spotlight/state"};
+static const char* const door_topics[] = {"home/m5stack/core2/fridge_door/status",
+                                          "home/m5stack/core2/freezer_door/status"};
+static const int num_devices = sizeof(state_topics) / sizeof(state_topics[0]);
+static const int num_doors = sizeof(door_topics) / sizeof(door_topics[0]);
+static const uint32_t STATE_INTERVAL_MS = 10000;
+static const uint32_t DOOR_INTERVAL_MS = 60000;
+static const uint32_t SCREEN_TIMEOUT = 30000;  // As in main.cpp
+static const uint32_t KEEP_AWAKE_MS = 10000;
+static const uint32_t RUN_MS = 10 * 60000;
+static const uint32_t STATE_REPORTS = RUN_MS / STATE_INTERVAL_MS * num_devices;
+
+static uint32_t house_ms;  // Virtual time the house has run for
+
+struct ScreenTraffic {
+    SimTraffic delivered;
+    SimTraffic spared;  // State reports not sent because the topics were not subscribed
+};
+
+// PUBLISH as the broker forwards it at QoS 0
+static uint64_t publish_size(const char* topic, const char* payload) {
+    size_t remaining = 2 + strlen(topic) + strlen(payload);
+    return 1 + (remaining < 128 ? 1 : 2) + remaining;
+}
+
+// Runs the house for `ms` in 100 ms steps. With `keep_awake` the buttons
+// are nudged down and back up, leaving the selection where it was.
+static ScreenTraffic run_house(uint32_t ms, bool keep_awake) {
+    ScreenTraffic traffic = {};
+    SimTraffic before = broker.delivered(sim_client_id());
+    int nudges = 0;
+    for (uint32_t end = house_ms + ms; house_ms < end; house_ms += 100) {
+        for (int i = 0; i < num_devices; i++) {
+            if (house_ms % STATE_INTERVAL_MS != (uint32_t)i * 1000) continue;
+            const char* payload = (house_ms / STATE_INTERVAL_MS + i) % 2 ? "ON" : "OFF";
+            uint64_t seen = broker.delivered_at(sim_client_id(), state_topics[i]);
+            broker.publish(state_topics[i], payload, true);
+            if (broker.delivered_at(sim_client_id(), state_topics[i]) == seen) {
+                traffic.spared.messages++;
+                traffic.spared.bytes += publish_size(state_topics[i], payload);
+            }
+        }
+        for (int i = 0; i < num_doors; i++) {
+            if (house_ms % DOOR_INTERVAL_MS == (uint32_t)i * 30000) broker.publish(door_topics[i], "CLOSED");
+        }
+        if (keep_awake && house_ms % KEEP_AWAKE_MS == 0) sim_press(nudges++ % 2 ? SIM_BTN_A : SIM_BTN_C);
+        sim_run_ms(100);
+    }
+    SimTraffic after = broker.delivered(sim_client_id());
+    traffic.delivered = {after.messages - before.messages, after.bytes - before.bytes};
+    return traffic;
+}
+
+static void report(const char* screen, const ScreenTraffic& traffic) {
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %lu messages / %lu bytes in, %lu / %lu with every topic always on",
+             screen, (unsigned long)traffic.delivered.messages, (unsigned long)traffic.delivered.bytes,
+             (unsigned long)(traffic.delivered.messages + traffic.spared.messages),
+             (unsigned long)(traffic.delivered.bytes + traffic.spared.bytes));
+    TEST_MESSAGE(line);
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_settle() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    run_house(STATE_INTERVAL_MS, false);
+}
+
+void test_main_menu() {
+    ScreenTraffic traffic = run_house(RUN_MS, true);
+    report("main menu", traffic);
+    TEST_ASSERT_EQUAL(STATE_REPORTS, traffic.spared.messages);
+    // Door status and RTT probe echoes are all that is left
+    TEST_ASSERT_LESS_THAN(traffic.spared.messages, traffic.delivered.messages);
+    TEST_ASSERT_LESS_THAN(traffic.spared.bytes, traffic.delivered.bytes);
+}
+
+void test_devices_screen() {
+    uint32_t subscribes = broker.subscribe_packets();
+    sim_press(SIM_BTN_B);  // "Devices" is selected on the main menu
+    sim_run_ms(500);
+    TEST_ASSERT_EQUAL_INT(1, state_current().menu);  // DEVICES_MENU
+    TEST_ASSERT_EQUAL(subscribes + 1, broker.subscribe_packets());
+
+    ScreenTraffic traffic = run_house(RUN_MS, true);
+    report("devices screen", traffic);
+    TEST_ASSERT_EQUAL(0, traffic.spared.messages);
+    TEST_ASSERT_GREATER_OR_EQUAL(STATE_REPORTS, traffic.delivered.messages);
+}
+
+// A sleeping display counts as no screen
+void test_devices_screen_asleep() {
+    ScreenTraffic traffic = run_house(RUN_MS, false);
+    report("devices screen, asleep", traffic);
+    TEST_ASSERT_GREATER_OR_EQUAL(STATE_REPORTS - (SCREEN_TIMEOUT / STATE_INTERVAL_MS + 1) * num_devices,
+                                 traffic.spared.messages);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_settle);
+    RUN_TEST(test_main_menu);
+    RUN_TEST(test_devices_screen);
+    RUN_TEST(test_devices_screen_asleep);
+    return UNITY_END();
+}
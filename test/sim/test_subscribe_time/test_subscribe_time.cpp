@@ -0,0 +1,85 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include "broker_pool.h"
+#include "subscriptions.h"
+
+// ======= Reconnect-to-Subscribed Time =======
+// Registers 10, 100 and then 500 extra always-on topics of 40 bytes each,
+// restarts the broker and times the reconnect from the connect attempt to
+// the broker holding every filter. Needs SUBS_MAX of at least 504; see the
+// native-sim-subs environment. The standby from the simulation credentials
+// does not exist here, so it is left to fail its probes first.
+
+static SimBroker broker("broker-a", 1883, 5000);
+
+static const int MAX_TOPICS = 500;
+static char topics[MAX_TOPICS][41];
+static int added = 0;
+static size_t baseline = 0;  // Filters held before any were added
+
+extern unsigned long next_connect_attempt;  // main.cpp
+
+static void measure(int count, uint32_t rtt_ms) {
+    for (; added < count; added++) {
+        snprintf(topics[added], sizeof(topics[added]), "home/load/sensors/%03u/readings/value_now",
+                 (unsigned)added % 1000);  // MAX_TOPICS < 1000; lets gcc see three digits
+        TEST_ASSERT_EQUAL_UINT32(40, strlen(topics[added]));
+        TEST_ASSERT_TRUE(subs_add(topics[added], SUB_ALWAYS));
+    }
+    broker.set_rtt_us(rtt_ms * 1000);
+    broker.set_up(false);
+    sim_run_ms(50);
+    broker.set_up(true);
+    uint32_t packets_before = broker.subscribe_packets();
+    size_t expected = baseline + count;
+    TEST_ASSERT_TRUE(sim_run_until([&] { return broker.subscriptions(sim_client_id()).size() == expected; }, 30000));
+    unsigned long elapsed = millis() - next_connect_attempt;
+
+    char line[120];
+    snprintf(line, sizeof(line), "%d topics, RTT %lu ms: %lu SUBSCRIBE packets, subscribed %lu ms after the attempt",
+             count, (unsigned long)rtt_ms, (unsigned long)(broker.subscribe_packets() - packets_before),
+             elapsed);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, subs_stats().overflows);
+    // Connect and CONNACK take two RTTs; the pipelined SUBSCRIBEs add about one more
+    TEST_ASSERT_LESS_OR_EQUAL(4 * rtt_ms + 100, elapsed);
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_baseline() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    TEST_ASSERT_TRUE(sim_run_until([] { return !broker_pool_status(1).healthy; }, 30000));
+    baseline = broker.subscriptions(sim_client_id()).size();
+    TEST_ASSERT_NOT_EQUAL(0, baseline);
+}
+
+void test_10_topics() {
+    measure(10, 5);
+}
+
+void test_100_topics() {
+    measure(100, 5);
+}
+
+void test_500_topics() {
+    measure(500, 5);
+}
+
+void test_500_topics_slow_broker() {
+    measure(500, 20);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_baseline);
+    RUN_TEST(test_10_topics);
+    RUN_TEST(test_100_topics);
+    RUN_TEST(test_500_topics);
+    RUN_TEST(test_500_topics_slow_broker);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <vector>
+#include "mqtt_session.h"
+#include "state_store.h"
+
+// ======= Door Alerts Under a Telemetry Flood =======
+// A feed of 200-byte readings subscribed on the telemetry connection, and a
+// fridge door event every 250 ms, through a 4 Mbit/s downlink with a 2 ms
+// RTT. Latency is door publish to the event reaching the panel's socket;
+// the panel must also show the debounced change. Built as is, feed and door
+// share one connection; in native-sim-split (-DTELEMETRY_CONNECTION) the
+// feed has its own. A flood the downlink can carry costs either build
+// little. Past that, readings pile up at the broker: on one connection a
+// door event waits behind all of them, on two only for its own share of
+// the downlink.
+
+static SimBroker broker("broker-a", 1883, 2000);
+static const char* const fridge_topic = "home/m5stack/core2/fridge_door/status";
+static const char* const feed_filter = "home/energy/+/power";
+static const char* const feed_topic = "home/energy/circuit07/power";
+static const uint32_t DOWNLINK_BPS = 4000000;
+static const size_t READING_SIZE = 200;
+static const int DOOR_EVENTS = 10;
+static const uint64_t DOOR_LATENCY_BOUND_US = 5000;
+
+MqttSession& telemetry_mqtt();  // main.cpp
+
+#ifdef TELEMETRY_CONNECTION
+static const int connections = 2;
+#else
+static const int connections = 1;
+#endif
+
+static char reading[READING_SIZE + 1];
+static uint64_t feed_start_us;
+static uint64_t feed_sent;
+
+static bool fridge_open() {
+    return state_door_open(state_current(), 0);
+}
+
+// One loop() iteration, with the feed published at `per_sec` up to now
+static void step_with_feed(uint32_t per_sec) {
+    uint64_t due = (host_now_us() - feed_start_us) * per_sec / 1000000;
+    for (; feed_sent < due; feed_sent++) broker.publish(feed_topic, reading);
+    loop();
+}
+
+// Door publish to arrival at the panel, per door event
+static std::vector<uint64_t> door_latencies(uint32_t per_sec) {
+    std::vector<uint64_t> latencies;
+    feed_start_us = host_now_us();
+    feed_sent = 0;
+    for (int i = 0; i < DOOR_EVENTS; i++) {
+        uint64_t end = host_now_us() + 250000;
+        while (host_now_us() < end) step_with_feed(per_sec);
+        bool open = !fridge_open();
+        uint64_t published = host_now_us();
+        broker.publish(fridge_topic, open ? "OPEN" : "CLOSED");
+        end = published + 30000000;
+        while (host_now_us() < end && fridge_open() != open) step_with_feed(per_sec);
+        TEST_ASSERT_EQUAL_MESSAGE(open, fridge_open(), "door event never arrived");
+        latencies.push_back(broker.delivered_at(sim_client_id(), fridge_topic) - published);
+    }
+    return latencies;
+}
+
+static std::vector<uint64_t> report(uint32_t per_sec) {
+    std::vector<uint64_t> latencies = door_latencies(per_sec);
+    char line[128];
+    snprintf(line, sizeof(line), "%d connection(s), feed %4lu/s: door p50=%lu max=%lu us", connections,
+             (unsigned long)per_sec, (unsigned long)sim_percentile(latencies, 50),
+             (unsigned long)sim_percentile(latencies, 100));
+    TEST_MESSAGE(line);
+    sim_run_ms(30000);  // Lets the broker's backlog drain before the next rate
+    return latencies;
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_subscribe_feed() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()) && telemetry_mqtt().connected(); },
+                                   20000));
+    broker.set_downlink_bps(DOWNLINK_BPS);
+    memset(reading, 'r', READING_SIZE);
+    TEST_ASSERT_TRUE(telemetry_mqtt().subscribe(feed_filter));
+    sim_run_ms(1000);
+}
+
+void test_flood_within_downlink() {
+    std::vector<uint64_t> idle = report(0);
+    std::vector<uint64_t> flooded = report(1200);
+    TEST_ASSERT_LESS_OR_EQUAL(DOOR_LATENCY_BOUND_US, sim_percentile(idle, 100));
+    TEST_ASSERT_LESS_OR_EQUAL(DOOR_LATENCY_BOUND_US, sim_percentile(flooded, 100));
+}
+
+// Readings arrive faster than the downlink carries them
+void test_flood_past_downlink() {
+    std::vector<uint64_t> flooded = report(2400);
+#ifdef TELEMETRY_CONNECTION
+    TEST_ASSERT_LESS_OR_EQUAL(DOOR_LATENCY_BOUND_US, sim_percentile(flooded, 100));
+#else
+    // What the second connection is for
+    TEST_ASSERT_GREATER_THAN(DOOR_LATENCY_BOUND_US, sim_percentile(flooded, 50));
+#endif
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_subscribe_feed);
+    RUN_TEST(test_flood_within_downlink);
+    RUN_TEST(test_flood_past_downlink);
+    return UNITY_END();
+}
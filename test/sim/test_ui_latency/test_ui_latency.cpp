@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include "state_store.h"
+#include "ui_latency.h"
+
+// ======= Input-to-Photon Latency =======
+// Scripted presses through the menus: navigate up and down, select into
+// and out of the Devices screen and toggle each device in turn. The
+// firmware's own ui_latency histograms time every press against the
+// simulated LCD's pixel cost; each press must close exactly one sample.
+
+static SimBroker broker("broker-a", 1883, 4000);
+
+static const int ROUNDS = 30;
+static const int NUM_DEVICES = 6;  // devices[] in main.cpp; "Back" follows them
+enum { MAIN_MENU, DEVICES_MENU };  // MenuState in main.cpp
+
+static uint32_t counts[UI_ACTION_COUNT];
+
+// Press, then run until the frame for it has been pushed
+static void press(SimButtonId button, UiAction action) {
+    uint32_t before = ui_latency_histogram(action).count;
+    sim_press(button);
+    TEST_ASSERT_TRUE(sim_run_until([&] { return ui_latency_histogram(action).count > before; }, 2000));
+    counts[action]++;
+    sim_run_ms(150);
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_every_press_is_timed() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    sim_run_ms(1000);
+    for (int a = 0; a < UI_ACTION_COUNT; a++) {
+        counts[a] = ui_latency_histogram((UiAction)a).count;
+    }
+
+    for (int round = 0; round < ROUNDS; round++) {
+        TEST_ASSERT_EQUAL_INT(MAIN_MENU, state_current().menu);
+        press(SIM_BTN_C, UI_ACTION_NAVIGATE);
+        press(SIM_BTN_C, UI_ACTION_NAVIGATE);
+        press(SIM_BTN_A, UI_ACTION_NAVIGATE);
+        press(SIM_BTN_A, UI_ACTION_NAVIGATE);
+        press(SIM_BTN_B, UI_ACTION_SELECT);  // Devices
+        TEST_ASSERT_EQUAL_INT(DEVICES_MENU, state_current().menu);
+
+        int device = round % NUM_DEVICES;
+        for (int i = 0; i < device; i++) {
+            press(SIM_BTN_C, UI_ACTION_NAVIGATE);
+        }
+        bool was_on = state_device_on(state_current(), device);
+        press(SIM_BTN_B, UI_ACTION_TOGGLE);
+        TEST_ASSERT_NOT_EQUAL(was_on, state_device_on(state_current(), device));
+        sim_run_ms(1200);  // The toast's hold
+
+        press(SIM_BTN_A, UI_ACTION_NAVIGATE);  // Wraps round to "Back"
+        press(SIM_BTN_B, UI_ACTION_SELECT);
+    }
+
+    for (int a = 0; a < UI_ACTION_COUNT; a++) {
+        TEST_ASSERT_EQUAL_UINT32(counts[a], ui_latency_histogram((UiAction)a).count);
+    }
+}
+
+void test_latency_report() {
+    static const char* const names[UI_ACTION_COUNT] = {"navigate", "select", "toggle"};
+    for (int a = 0; a < UI_ACTION_COUNT; a++) {
+        const UiLatencyHistogram& h = ui_latency_histogram((UiAction)a);
+        TEST_ASSERT_NOT_EQUAL(0, h.count);
+        char line[120];
+        snprintf(line, sizeof(line), "%s: %lu presses, mean %lu us, max %lu us", names[a], (unsigned long)h.count,
+                 (unsigned long)(h.total_us / h.count), (unsigned long)h.max_us);
+        TEST_MESSAGE(line);
+        // A full 320x240 frame is 30.7 ms at 0.4 us per pixel; no press should need more than two
+        TEST_ASSERT_LESS_THAN(2 * 320 * 240 * SIM_LCD_NS_PER_PIXEL / 1000, h.max_us);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_press_is_timed);
+    RUN_TEST(test_latency_report);
+    return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <unity.h>
+#include <panel_sim.h>
+#include <string>
+#include <vector>
+#include "coalescing_client.h"
+#include "state_store.h"
+
+// ======= Write Coalescing =======
+// Counts what MqttSession writes to the transport, each of which would be
+// its own TCP segment without CoalescingClient, against the segments the
+// broker's socket actually receives. Power Off All Devices, a single
+// toggle and a minute of idle telemetry and keepalives are measured apart.
+
+static SimBroker broker("broker-a", 1883, 4000);
+extern CoalescingClient mqtt_transport;  // main.cpp
+static const int num_devices = 6;
+
+static bool is_control_topic(const std::string& topic) {
+    return topic.compare(0, 27, "home/m5stack/core2/devices/") == 0 &&
+           topic.size() > 8 && topic.compare(topic.size() - 8, 8, "/control") == 0;
+}
+
+struct WriteCount {
+    uint32_t writes;    // Without coalescing, one segment each
+    uint32_t segments;  // With it
+};
+
+static WriteCount count_now() {
+    return {mqtt_transport.stats().writes, broker.segments()};
+}
+
+static WriteCount count_since(const WriteCount& start, const char* series) {
+    WriteCount now = count_now();
+    WriteCount delta = {now.writes - start.writes, now.segments - start.segments};
+    char line[128];
+    snprintf(line, sizeof(line), "%s: uncoalesced %lu segments, coalesced %lu", series,
+             (unsigned long)delta.writes, (unsigned long)delta.segments);
+    TEST_MESSAGE(line);
+    return delta;
+}
+
+void setUp() {
+    sim_boot();
+}
+
+void tearDown() {}
+
+void test_settle() {
+    TEST_ASSERT_TRUE(sim_run_until([] { return broker.connected(sim_client_id()); }, 10000));
+    sim_run_ms(20000);
+}
+
+// One OFF per device, all sent from one loop() iteration
+void test_power_off_all() {
+    sim_press(SIM_BTN_C);  // Main menu: down to "Power Off All Devices"
+    sim_run_ms(200);
+    sim_press(SIM_BTN_C);
+    sim_run_ms(200);
+    TEST_ASSERT_EQUAL_INT(2, state_current().selected_index);
+
+    broker.clear_received();
+    WriteCount start = count_now();
+    sim_press(SIM_BTN_B);
+    sim_run_ms(100);  // Inside the 2 s toast, so nothing else is sent
+    WriteCount delta = count_since(start, "power off all");
+
+    std::vector<uint64_t> arrivals;
+    for (const SimPublish& p : broker.received()) {
+        if (is_control_topic(p.topic)) arrivals.push_back(p.at_us);
+    }
+    TEST_ASSERT_EQUAL_INT(num_devices, arrivals.size());
+    // Sent as separate segments they would leave the uplink one after another
+    for (uint64_t at : arrivals) TEST_ASSERT_EQUAL(arrivals[0], at);
+    TEST_ASSERT_GREATER_OR_EQUAL(num_devices, delta.writes);
+    TEST_ASSERT_EQUAL(1, delta.segments);
+    sim_run_ms(2500);
+}
+
+void test_single_toggle() {
+    sim_press(SIM_BTN_B);  // Main menu: "Devices"
+    sim_run_ms(500);
+    WriteCount start = count_now();
+    sim_press(SIM_BTN_B);  // Hallway Lights
+    sim_run_ms(100);
+    WriteCount delta = count_since(start, "single toggle");
+    TEST_ASSERT_EQUAL(1, delta.writes);
+    TEST_ASSERT_EQUAL(1, delta.segments);
+    sim_run_ms(2500);
+}
+
+// Probes, metrics, heap reports and keepalives mostly go out one per
+// loop(), so there is little to merge, but coalescing must never add segments
+void test_idle_minute() {
+    WriteCount start = count_now();
+    sim_run_ms(60000);
+    WriteCount delta = count_since(start, "60 s idle");
+    TEST_ASSERT_GREATER_THAN(0, delta.segments);
+    TEST_ASSERT_LESS_OR_EQUAL(delta.writes, delta.segments);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_settle);
+    RUN_TEST(test_power_off_all);
+    RUN_TEST(test_single_toggle);
+    RUN_TEST(test_idle_minute);
+    return UNITY_END();
+}
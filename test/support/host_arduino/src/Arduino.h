@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+// ======= Host Arduino =======
+// The part of the Arduino-ESP32 core that the firmware uses, for host
+// builds (see the native environments in platformio.ini). millis() and
+// micros() run on a virtual clock that only moves when delay() or a test
+// moves it, so runs are repeatable and a simulated minute takes no real
+// time. Host-only controls are in host.h.
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define IRAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define strlen_P strlen
+#define strnlen_P strnlen
+#define memcpy_P memcpy
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);  // On a FreeRTOS task this is vTaskDelay(), as on the ESP32
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+uint32_t getCpuFrequencyMhz();
+int xPortGetCoreID();  // 1 for the loop, 0 for tasks, matching main.cpp's pinning
+
+// Output is kept for host_serial_output() and input comes from
+// host_serial_input(). Writes block as long as the UART at 115200 baud would.
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int availableForWrite() override { return 128; }
+    int available() override;
+    int read() override;
+    int peek() override;
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getCycleCount();
+    uint64_t getEfuseMac() { return 0x0000563412C0FFEEULL; }
+    void restart();  // Aborts: nothing on the host should get this far
+};
+
+extern EspClass ESP;
@@ -0,0 +1,21 @@
+#pragma once
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout_ms) { timeout = timeout_ms; }
+    unsigned long getTimeout() const { return timeout; }
+
+    // Waits up to the timeout for each byte, on virtual time
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+protected:
+    int timed_read();
+
+    unsigned long timeout = 1000;
+};
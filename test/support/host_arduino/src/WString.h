@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+// Just enough of Arduino's String for IPAddress::toString()
+class String {
+public:
+    String(const char* s = "") : text(s ? s : "") {}
+    const char* c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.size(); }
+    bool isEmpty() const { return text.empty(); }
+    String& operator+=(const char* s) { text += s; return *this; }
+    String& operator+=(char c) { text += c; return *this; }
+    bool operator==(const char* s) const { return text == s; }
+
+private:
+    std::string text;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+
+// ======= Host Controls =======
+// For tests and simulations only; the firmware never includes this.
+
+// Virtual clock. Advancing it runs every FreeRTOS task that comes due on
+// the way, in wake order, so tasks see the time they asked to wake at.
+uint64_t host_now_us();
+void host_advance_us(uint64_t us);
+void host_advance_ms(uint32_t ms);
+
+// Runs tasks that are due now (woken by a notify, or a delay that ended)
+void host_run_tasks();
+
+// Serial: what the firmware printed, and bytes for it to read
+const std::string& host_serial_output();
+void host_serial_clear();
+void host_serial_echo(bool on);  // Also copy output to stdout
+void host_serial_input(const char* text);
+
+void host_set_free_heap(uint32_t bytes);
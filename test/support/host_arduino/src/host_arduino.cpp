@@ -0,0 +1,173 @@
+#include <Arduino.h>
+#include <random>
+#include "host.h"
+
+// ======= Print / Stream =======
+
+size_t Print::printf(const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    return write((const uint8_t*)text, min((size_t)len, sizeof(text) - 1));
+}
+
+int Stream::timed_read() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        delay(1);  // Lets virtual time, and whatever feeds this stream, move on
+    } while (millis() - start < timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timed_read();
+        if (c < 0) break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+// ======= Serial =======
+// Writes cost what they do on the ESP32's UART at 115200 baud: bytes go into
+// the 128-byte hardware FIFO, and a write that doesn't fit blocks the
+// caller until the FIFO has drained far enough.
+
+static const uint32_t SERIAL_NS_PER_BYTE = 86806;  // 10 bits at 115200 baud
+static const size_t SERIAL_FIFO_BYTES = 128;
+
+static std::string serial_output;
+static std::string serial_input;
+static bool serial_echo = false;
+static uint64_t serial_idle_at_ns = 0;  // When the FIFO will be empty
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+    serial_output.append((const char*)buf, size);
+    if (serial_echo) fwrite(buf, 1, size, stdout);
+
+    uint64_t now_ns = host_now_us() * 1000;
+    serial_idle_at_ns = max(serial_idle_at_ns, now_ns) + size * SERIAL_NS_PER_BYTE;
+    uint64_t fits_at_ns = serial_idle_at_ns - min(serial_idle_at_ns, (uint64_t)SERIAL_FIFO_BYTES * SERIAL_NS_PER_BYTE);
+    if (fits_at_ns > now_ns) {
+        host_advance_us((fits_at_ns - now_ns + 999) / 1000);
+    }
+    return size;
+}
+
+int HardwareSerial::available() {
+    return serial_input.size();
+}
+
+int HardwareSerial::read() {
+    if (serial_input.empty()) return -1;
+    uint8_t c = serial_input[0];
+    serial_input.erase(0, 1);
+    return c;
+}
+
+int HardwareSerial::peek() {
+    return serial_input.empty() ? -1 : (uint8_t)serial_input[0];
+}
+
+const std::string& host_serial_output() {
+    return serial_output;
+}
+
+void host_serial_clear() {
+    serial_output.clear();
+}
+
+void host_serial_echo(bool on) {
+    serial_echo = on;
+}
+
+void host_serial_input(const char* text) {
+    serial_input += text;
+}
+
+// ======= Time =======
+// host_advance_us() lives with the task scheduler in host_tasks.cpp
+
+unsigned long millis() {
+    return host_now_us() / 1000;
+}
+
+unsigned long micros() {
+    return host_now_us();
+}
+
+void delayMicroseconds(unsigned int us) {
+    host_advance_us(us);
+}
+
+void host_advance_ms(uint32_t ms) {
+    host_advance_us((uint64_t)ms * 1000);
+}
+
+void yield() {
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return 240;
+}
+
+// ======= Random =======
+// Seeded the same every run unless randomSeed() is called
+
+static std::mt19937 generator(1);
+
+long random(long max) {
+    return max <= 0 ? 0 : random(0, max);
+}
+
+long random(long min, long max) {
+    if (max <= min) return min;
+    return min + (long)(generator() % (uint32_t)(max - min));
+}
+
+void randomSeed(unsigned long seed) {
+    generator.seed(seed);
+}
+
+// ======= ESP =======
+
+static uint32_t free_heap = 200 * 1024;
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return free_heap;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return free_heap;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return free_heap / 2;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(host_now_us() * getCpuFrequencyMhz());
+}
+
+void EspClass::restart() {
+    fprintf(stderr, "ESP.restart() on the host\n");
+    abort();
+}
+
+void host_set_free_heap(uint32_t bytes) {
+    free_heap = bytes;
+}
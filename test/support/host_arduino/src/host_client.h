@@ -0,0 +1,56 @@
+#pragma once
+#include <Client.h>
+#include <string>
+
+// ======= Host Client =======
+// An in-memory socket: what the firmware writes collects in `sent`, and
+// bytes queued with receive() are what it reads back, at most `read_limit`
+// of them per read when that is set, as a TCP stack hands over segments.
+class HostClient : public Client {
+public:
+    std::string sent;
+    std::string incoming;
+    bool is_connected = false;
+    bool refuse_connect = false;
+    int connects = 0;
+    size_t read_limit = 0;  // 0 = everything queued
+
+    void receive(const void* data, size_t size) { incoming.append((const char*)data, size); }
+
+    int connect(IPAddress ip, uint16_t port) override {
+        (void)ip;
+        return connect("", port);
+    }
+    int connect(const char* host, uint16_t port) override {
+        (void)host;
+        (void)port;
+        if (refuse_connect) return 0;
+        connects++;
+        is_connected = true;
+        return 1;
+    }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!is_connected) return 0;
+        sent.append((const char*)buf, size);
+        return size;
+    }
+    int available() override { return read_limit ? min(read_limit, incoming.size()) : incoming.size(); }
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    int read(uint8_t* buf, size_t size) override {
+        if (incoming.empty()) return -1;
+        size_t n = min(size, (size_t)available());
+        memcpy(buf, incoming.data(), n);
+        incoming.erase(0, n);
+        return n;
+    }
+    int peek() override { return incoming.empty() ? -1 : (uint8_t)incoming[0]; }
+    void flush() override {}
+    void stop() override { is_connected = false; }
+    uint8_t connected() override { return is_connected; }
+    operator bool() override { return is_connected; }
+    using Print::write;
+};
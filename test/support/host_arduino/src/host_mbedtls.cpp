@@ -0,0 +1,63 @@
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include "mbedtls/pk.h"
+#include "mbedtls/sha256.h"
+
+// ======= SHA-256 =======
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+    ctx->md = EVP_MD_CTX_new();
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) {
+    EVP_MD_CTX_free((EVP_MD_CTX*)ctx->md);
+    ctx->md = nullptr;
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+    return EVP_DigestInit_ex((EVP_MD_CTX*)ctx->md, is224 ? EVP_sha224() : EVP_sha256(), nullptr) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len) {
+    return EVP_DigestUpdate((EVP_MD_CTX*)ctx->md, input, len) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+    return EVP_DigestFinal_ex((EVP_MD_CTX*)ctx->md, output, nullptr) == 1 ? 0 : -1;
+}
+
+// ======= Public Keys =======
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx) {
+    ctx->pkey = nullptr;
+}
+
+void mbedtls_pk_free(mbedtls_pk_context* ctx) {
+    EVP_PKEY_free((EVP_PKEY*)ctx->pkey);
+    ctx->pkey = nullptr;
+}
+
+// Like mbedtls, PEM input must include its terminating NUL in `keylen`
+int mbedtls_pk_parse_public_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen) {
+    if (keylen == 0 || key[keylen - 1] != '\0') return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+    BIO* bio = BIO_new_mem_buf(key, (int)keylen - 1);
+    ctx->pkey = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    return ctx->pkey ? 0 : MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+}
+
+int mbedtls_pk_can_do(const mbedtls_pk_context* ctx, mbedtls_pk_type_t type) {
+    if (!ctx->pkey || EVP_PKEY_base_id((EVP_PKEY*)ctx->pkey) != EVP_PKEY_EC) return 0;
+    return type == MBEDTLS_PK_ECKEY || type == MBEDTLS_PK_ECKEY_DH || type == MBEDTLS_PK_ECDSA;
+}
+
+int mbedtls_pk_verify(mbedtls_pk_context* ctx, mbedtls_md_type_t md_alg, const unsigned char* hash, size_t hash_len,
+                      const unsigned char* sig, size_t sig_len) {
+    if (!ctx->pkey || md_alg != MBEDTLS_MD_SHA256 || hash_len != 32) return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    EVP_PKEY_CTX* verify = EVP_PKEY_CTX_new((EVP_PKEY*)ctx->pkey, nullptr);
+    bool ok = verify && EVP_PKEY_verify_init(verify) == 1 &&
+              EVP_PKEY_CTX_set_signature_md(verify, EVP_sha256()) == 1 &&
+              EVP_PKEY_verify(verify, sig, sig_len, hash, hash_len) == 1;
+    EVP_PKEY_CTX_free(verify);
+    return ok ? 0 : MBEDTLS_ERR_ECP_VERIFY_FAILED;
+}
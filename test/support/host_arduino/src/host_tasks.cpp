@@ -0,0 +1,186 @@
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "host.h"
+
+// ======= Host Task Scheduler =======
+// Each FreeRTOS task gets a thread, but only one thread runs at a time: the
+// caller of host_advance_us() hands the CPU to each task that is due and
+// waits until it blocks again in vTaskDelay() or ulTaskNotifyTake(). Task
+// code therefore runs exactly as interleaved as the virtual clock says, and
+// a test sees the same order on every run.
+
+struct HostTask {
+    TaskFunction_t code;
+    void* params;
+    const char* name;
+    uint64_t wake_us;  // When its delay or notify timeout ends
+    bool waiting_for_notify;
+    uint32_t notify_count;
+    bool running;
+    bool finished;
+    std::condition_variable turn;
+};
+
+static const int MAX_RUNS_PER_INSTANT = 10000;  // Catches a task that never blocks
+
+static uint64_t now_us = 0;
+// Never destroyed: task threads are still parked on them at exit
+static std::mutex& cpu = *new std::mutex;
+static std::condition_variable& scheduler_turn = *new std::condition_variable;
+static std::vector<HostTask*>& tasks = *new std::vector<HostTask*>;
+static thread_local HostTask* current_task = nullptr;
+static HostTask loop_task;  // Handle for code not on a task, i.e. setup()/loop()
+
+static bool is_due(const HostTask* task) {
+    if (task->finished) return false;
+    return task->wake_us <= now_us || (task->waiting_for_notify && task->notify_count > 0);
+}
+
+// Gives up the CPU until the scheduler runs this task again
+static void block(std::unique_lock<std::mutex>& held) {
+    HostTask* task = current_task;
+    task->running = false;
+    scheduler_turn.notify_all();
+    task->turn.wait(held, [task] { return task->running; });
+}
+
+static void task_main(HostTask* task) {
+    std::unique_lock<std::mutex> held(cpu);
+    current_task = task;
+    task->turn.wait(held, [task] { return task->running; });
+    held.unlock();
+    task->code(task->params);
+    held.lock();
+    task->finished = true;
+    task->running = false;
+    scheduler_turn.notify_all();
+}
+
+static void run(HostTask* task, std::unique_lock<std::mutex>& held) {
+    task->running = true;
+    task->turn.notify_all();
+    scheduler_turn.wait(held, [task] { return !task->running; });
+}
+
+void host_run_tasks() {
+    if (current_task) return;  // Only the loop side schedules
+    std::unique_lock<std::mutex> held(cpu);
+    for (int runs = 0; runs < MAX_RUNS_PER_INSTANT;) {
+        bool ran = false;
+        for (size_t i = 0; i < tasks.size(); i++) {
+            if (!is_due(tasks[i])) continue;
+            run(tasks[i], held);
+            ran = true;
+            runs++;
+        }
+        if (!ran) return;
+    }
+    fprintf(stderr, "host tasks: a task keeps running without blocking\n");
+    abort();
+}
+
+uint64_t host_now_us() {
+    return now_us;
+}
+
+void host_advance_us(uint64_t us) {
+    if (current_task) {
+        // On a task, delay() blocks it like vTaskDelay() would
+        std::unique_lock<std::mutex> held(cpu);
+        current_task->wake_us = now_us + us;
+        block(held);
+        return;
+    }
+    uint64_t target = now_us + us;
+    for (;;) {
+        host_run_tasks();
+        uint64_t next = target;
+        {
+            std::lock_guard<std::mutex> held(cpu);
+            for (size_t i = 0; i < tasks.size(); i++) {
+                if (!tasks[i]->finished && tasks[i]->wake_us < next) next = tasks[i]->wake_us;
+            }
+        }
+        if (next >= target) break;
+        now_us = next;
+    }
+    now_us = target;
+    host_run_tasks();
+}
+
+void delay(unsigned long ms) {
+    host_advance_us((uint64_t)ms * 1000);
+}
+
+int xPortGetCoreID() {
+    return current_task ? 0 : 1;
+}
+
+// ======= FreeRTOS API =======
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stack_depth,
+                                   void* params, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t core) {
+    (void)stack_depth;
+    (void)priority;
+    (void)core;
+    HostTask* task = new HostTask();
+    task->code = code;
+    task->params = params;
+    task->name = name;
+    task->wake_us = now_us;
+    task->waiting_for_notify = false;
+    task->notify_count = 0;
+    task->running = false;
+    task->finished = false;
+    {
+        std::lock_guard<std::mutex> held(cpu);
+        tasks.push_back(task);
+    }
+    std::thread(task_main, task).detach();
+    if (created) *created = task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stack_depth, void* params,
+                       UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(code, name, stack_depth, params, priority, created, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current_task ? current_task : &loop_task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    host_advance_us((uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    HostTask* task = current_task;
+    if (!task) return 0;
+    std::unique_lock<std::mutex> held(cpu);
+    if (task->notify_count == 0 && ticks_to_wait > 0) {
+        task->wake_us = ticks_to_wait == portMAX_DELAY
+                            ? UINT64_MAX
+                            : now_us + (uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000;
+        task->waiting_for_notify = true;
+        block(held);
+        task->waiting_for_notify = false;
+    }
+    uint32_t count = task->notify_count;
+    if (count > 0) task->notify_count = clear_on_exit ? 0 : count - 1;
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (task && task != &loop_task) task->notify_count++;  // Runs at the next host_run_tasks()
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount() {
+    return now_us / 1000 / portTICK_PERIOD_MS;
+}
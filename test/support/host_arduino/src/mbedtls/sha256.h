@@ -0,0 +1,13 @@
+#pragma once
+#include <stddef.h>
+
+// mbedtls 2.x SHA-256 API over the host's OpenSSL (host_mbedtls.cpp)
+typedef struct {
+    void* md;  // EVP_MD_CTX
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len);
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]);
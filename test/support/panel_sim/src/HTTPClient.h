@@ -0,0 +1,19 @@
+#pragma once
+#include <WiFi.h>
+
+// No HTTP server in the simulation: every GET is refused
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient {
+public:
+    bool begin(const char* url) {
+        (void)url;
+        return true;
+    }
+    void setTimeout(uint16_t timeout_ms) { (void)timeout_ms; }
+    int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+    int getSize() { return -1; }
+    WiFiClient* getStreamPtr() { return nullptr; }
+    void end() {}
+};
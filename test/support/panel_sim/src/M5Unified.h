@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+// ======= Simulated M5Stack Core2 =======
+// The LCD charges virtual time for every pixel it pushes, as the ILI9342C
+// on 40 MHz SPI does (RGB565, 0.4 us per pixel), and keeps the text printed
+// since the last full clear so tests can read the screen. Buttons are
+// pressed with sim_press() and show up at the next M5.update().
+
+#define TFT_BLACK 0x0000
+#define TFT_WHITE 0xFFFF
+#define TFT_RED 0xF800
+#define TFT_GREEN 0x07E0
+#define TFT_YELLOW 0xFFE0
+#define TFT_ORANGE 0xFDA0
+#define TFT_DARKGRAY 0x7BEF
+
+const uint32_t SIM_LCD_NS_PER_PIXEL = 400;
+const uint32_t SIM_M5_UPDATE_US = 300;  // Touch controller and power chip polled over I2C
+
+class SimLcd : public Print {
+public:
+    size_t write(uint8_t c) override;
+    void setRotation(int rotation) { (void)rotation; }
+    void fillScreen(uint32_t color);
+    void fillRect(int x, int y, int w, int h, uint32_t color);
+    void setTextSize(int size) { text_size = size; }
+    void setTextColor(uint32_t fg) { (void)fg; }
+    void setTextColor(uint32_t fg, uint32_t bg) { (void)fg; (void)bg; }
+    void setCursor(int x, int y) { (void)x; (void)y; }
+    void sleep() { asleep = true; }
+    void wakeup() { asleep = false; }
+    void waitDMA() {}
+    int width() { return 320; }
+    int height() { return 240; }
+    using Print::write;
+
+    std::string text;       // Printed since the last fillScreen()
+    uint32_t frames = 0;    // fillScreen() calls
+    uint64_t pixels = 0;    // Pushed since boot
+    bool asleep = false;
+
+private:
+    void push(uint64_t count);
+
+    int text_size = 1;
+};
+
+class SimButton {
+public:
+    bool wasPressed() const { return pressed; }
+    bool isPressed() const { return pressed; }
+
+    bool pressed = false;  // For this loop() iteration
+    int pending = 0;       // Presses not yet seen by M5.update()
+};
+
+struct SimConfig {
+    unsigned long serial_baudrate;
+};
+
+class SimM5 {
+public:
+    SimConfig config() { return SimConfig{115200}; }
+    void begin(const SimConfig& cfg) { (void)cfg; }
+    void update();
+
+    SimLcd Lcd;
+    SimLcd& Display = Lcd;
+    SimButton BtnA;
+    SimButton BtnB;
+    SimButton BtnC;
+};
+
+extern SimM5 M5;
+
+enum SimButtonId { SIM_BTN_A, SIM_BTN_B, SIM_BTN_C };
+
+// Queue a press; each M5.update() delivers at most one per button
+void sim_press(SimButtonId button);
@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+#include <memory>
+
+// ======= Simulated WiFi =======
+// The station is always associated. WiFiClient connects to whichever
+// SimBroker listens on the host and port it is given; connecting takes one
+// RTT of virtual time, like the TCP handshake, and fails after one RTT when
+// that broker is down.
+
+#define WL_CONNECTED 3
+
+struct SimSocket;
+
+class WiFiClient : public Client {
+public:
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeout_ms);
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    int setNoDelay(bool on) {
+        (void)on;
+        return 0;
+    }
+    // Arduino-ESP32 2.x: the WiFiClient timeout is in seconds
+    void setTimeout(uint32_t seconds) { Stream::setTimeout(seconds * 1000); }
+    using Print::write;
+
+private:
+    std::shared_ptr<SimSocket> socket;
+};
+
+class SimWiFi {
+public:
+    void begin(const char* ssid, const char* password) {
+        (void)ssid;
+        (void)password;
+    }
+    int status() { return WL_CONNECTED; }
+    IPAddress localIP() { return IPAddress(192, 168, 1, 50); }
+    int8_t RSSI() { return rssi; }
+    void macAddress(uint8_t* mac) { memcpy(mac, sim_mac, 6); }
+
+    int8_t rssi = -60;
+    uint8_t sim_mac[6] = {0x24, 0x0a, 0xc4, 0x5e, 0x71, 0x02};
+};
+
+extern SimWiFi WiFi;
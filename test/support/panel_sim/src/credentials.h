@@ -0,0 +1,11 @@
+#pragma once
+
+// Simulation credentials; the broker addresses are SimBroker names
+#define WIFI_SSID "sim"
+#define WIFI_PASSWORD "sim"
+#define MQTT_SERVER "broker-a"
+#define MQTT_PORT 1883
+#define MQTT_STANDBY_SERVER "broker-b"
+#define MQTT_STANDBY_PORT 1883
+#define MQTT_USER ""
+#define MQTT_PASSWORD ""
@@ -0,0 +1,16 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    const char* label;
+} esp_partition_t;
+
+// The simulated flash has nothing in it
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size);
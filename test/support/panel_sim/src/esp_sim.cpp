@@ -0,0 +1,51 @@
+#include <string.h>
+#include <esp_ota_ops.h>
+
+// ======= ESP-IDF Stand-ins =======
+
+static const esp_partition_t app0 = {0x10000, 0x300000, "app0"};
+static const esp_partition_t app1 = {0x310000, 0x300000, "app1"};
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+    if (offset + size > partition->size) return ESP_FAIL;
+    memset(dst, 0xFF, size);  // Erased flash
+    return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    return &app0;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start) {
+    (void)start;
+    return &app1;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* handle) {
+    (void)partition;
+    (void)image_size;
+    *handle = 1;
+    return ESP_FAIL;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    (void)handle;
+    (void)data;
+    (void)size;
+    return ESP_FAIL;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    (void)handle;
+    return ESP_FAIL;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    (void)partition;
+    return ESP_FAIL;
+}
@@ -0,0 +1,46 @@
+#include <M5Unified.h>
+#include "host.h"
+
+SimM5 M5;
+
+void SimLcd::push(uint64_t count) {
+    pixels += count;
+    host_advance_us(count * SIM_LCD_NS_PER_PIXEL / 1000);
+}
+
+size_t SimLcd::write(uint8_t c) {
+    if (c != '\r') text += (char)c;
+    if (c != '\n' && c != '\r') push(6 * 8 * text_size * text_size);  // One 6x8 glyph cell
+    return 1;
+}
+
+void SimLcd::fillScreen(uint32_t color) {
+    (void)color;
+    text.clear();
+    frames++;
+    push(320 * 240);
+}
+
+void SimLcd::fillRect(int x, int y, int w, int h, uint32_t color) {
+    (void)x;
+    (void)y;
+    (void)color;
+    push((uint64_t)w * h);
+}
+
+static void deliver(SimButton& button) {
+    button.pressed = button.pending > 0;
+    if (button.pressed) button.pending--;
+}
+
+void SimM5::update() {
+    host_advance_us(SIM_M5_UPDATE_US);
+    deliver(BtnA);
+    deliver(BtnB);
+    deliver(BtnC);
+}
+
+void sim_press(SimButtonId button) {
+    SimButton& b = button == SIM_BTN_A ? M5.BtnA : button == SIM_BTN_B ? M5.BtnB : M5.BtnC;
+    b.pending++;
+}
@@ -0,0 +1,53 @@
+#include "panel_sim.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+
+static bool booted = false;
+
+// The firmware aborts on a failed self-check (HEAP_ALLOC_CHECK) after
+// printing why on Serial; show the end of that before the process dies
+static void print_serial_on_abort(int sig) {
+    const std::string& out = host_serial_output();
+    size_t from = out.size() > 2048 ? out.size() - 2048 : 0;
+    fprintf(stderr, "\n--- Serial before abort ---\n%s\n", out.c_str() + from);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+void sim_boot() {
+    if (booted) return;
+    booted = true;
+    signal(SIGABRT, print_serial_on_abort);
+    setup();
+}
+
+void sim_run_ms(uint32_t ms) {
+    uint64_t end = host_now_us() + (uint64_t)ms * 1000;
+    while (host_now_us() < end) {
+        loop();
+    }
+}
+
+bool sim_run_until(const std::function<bool()>& done, uint32_t timeout_ms) {
+    uint64_t end = host_now_us() + (uint64_t)timeout_ms * 1000;
+    while (!done()) {
+        if (host_now_us() >= end) return false;
+        loop();
+    }
+    return true;
+}
+
+const char* sim_client_id() {
+    static char id[24];
+    const uint8_t* mac = WiFi.sim_mac;
+    snprintf(id, sizeof(id), "M5Core2-%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return id;
+}
+
+uint64_t sim_percentile(std::vector<uint64_t>& samples, int pct) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    size_t index = (samples.size() - 1) * pct / 100;
+    return samples[index];
+}
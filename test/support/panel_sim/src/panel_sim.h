@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <WiFi.h>
+#include <functional>
+#include "host.h"
+#include "sim_broker.h"
+
+// ======= Panel Simulation =======
+// Runs the firmware's own setup() and loop() on the host against simulated
+// brokers, display and buttons, all on the virtual clock. Each test binary
+// is one panel: the firmware's globals are initialised once per process.
+
+void setup();
+void loop();
+
+// setup(), once per process
+void sim_boot();
+
+// Run loop() for `ms` of virtual time
+void sim_run_ms(uint32_t ms);
+
+// Run loop() until `done` returns true; false if `timeout_ms` passed first
+bool sim_run_until(const std::function<bool()>& done, uint32_t timeout_ms);
+
+// The panel's MQTT client id, "M5Core2-<mac>"
+const char* sim_client_id();
+
+// Microsecond percentile of `samples`, which it sorts
+uint64_t sim_percentile(std::vector<uint64_t>& samples, int pct);
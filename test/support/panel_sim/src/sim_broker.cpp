@@ -0,0 +1,365 @@
+#include "sim_broker.h"
+#include <algorithm>
+#include "host.h"
+
+static std::vector<SimBroker*>& all_brokers() {
+    static std::vector<SimBroker*> brokers;
+    return brokers;
+}
+
+bool sim_topic_matches(const std::string& filter, const std::string& topic) {
+    size_t f = 0;
+    size_t t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#') return true;
+        if (filter[f] == '+') {
+            while (t < topic.size() && topic[t] != '/') t++;
+            f++;
+            continue;
+        }
+        if (t >= topic.size() || filter[f] != topic[t]) return false;
+        f++;
+        t++;
+    }
+    return t == topic.size();
+}
+
+// ======= Wire Helpers =======
+
+static std::string encode_length(size_t remaining) {
+    std::string out;
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        out += (char)(digit | (remaining > 0 ? 0x80 : 0));
+    } while (remaining > 0);
+    return out;
+}
+
+static std::string packet(uint8_t first_byte, const std::string& body) {
+    return std::string(1, (char)first_byte) + encode_length(body.size()) + body;
+}
+
+static std::string u16(uint16_t value) {
+    return std::string(1, (char)(value >> 8)) + (char)(value & 0xFF);
+}
+
+// Reads a length-prefixed string at `pos`; false if it runs past `body`
+static bool read_string(const std::string& body, size_t& pos, std::string* out) {
+    if (pos + 2 > body.size()) return false;
+    size_t len = (uint8_t)body[pos] << 8 | (uint8_t)body[pos + 1];
+    if (pos + 2 + len > body.size()) return false;
+    *out = body.substr(pos + 2, len);
+    pos += 2 + len;
+    return true;
+}
+
+static bool read_u16(const std::string& body, size_t& pos, uint16_t* out) {
+    if (pos + 2 > body.size()) return false;
+    *out = (uint8_t)body[pos] << 8 | (uint8_t)body[pos + 1];
+    pos += 2;
+    return true;
+}
+
+// ======= Sockets =======
+
+static void queue(std::vector<SimSocket::Segment>& segments, uint64_t at_us, const std::string& bytes) {
+    SimSocket::Segment segment = {at_us, bytes};
+    auto later = std::upper_bound(segments.begin(), segments.end(), segment,
+                                  [](const SimSocket::Segment& a, const SimSocket::Segment& b) {
+                                      return a.at_us < b.at_us;
+                                  });
+    segments.insert(later, segment);
+}
+
+void SimSocket::client_write(const uint8_t* buf, size_t size) {
+    if (!open || half_open) return;
+    broker->segment_count++;
+    uint64_t start = max(host_now_us(), uplink_free_at_us);
+    uplink_free_at_us = start + (uint64_t)size * 8 * 1000000 / broker->uplink_bps;
+    queue(to_broker, uplink_free_at_us + broker->rtt_us / 2, std::string((const char*)buf, size));
+}
+
+void SimSocket::close() {
+    open = false;
+    to_broker.clear();
+    to_client.clear();
+}
+
+// ======= Broker =======
+
+SimBroker::SimBroker(const char* host, uint16_t port, uint32_t rtt_us)
+    : broker_host(host), broker_port(port), rtt_us(rtt_us) {
+    all_brokers().push_back(this);
+}
+
+SimBroker::~SimBroker() {
+    for (size_t i = 0; i < sockets.size(); i++) sockets[i]->close();
+    std::vector<SimBroker*>& brokers = all_brokers();
+    brokers.erase(std::remove(brokers.begin(), brokers.end(), this), brokers.end());
+}
+
+void SimBroker::set_up(bool new_up) {
+    pump();
+    up = new_up;
+    if (up) return;
+    for (size_t i = 0; i < sockets.size(); i++) sockets[i]->close();
+    sockets.clear();
+}
+
+void SimBroker::set_half_open(bool half_open) {
+    pump();
+    for (size_t i = 0; i < sockets.size(); i++) {
+        sockets[i]->half_open = half_open;
+        if (half_open) {
+            sockets[i]->to_broker.clear();
+            sockets[i]->to_client.clear();
+        }
+    }
+}
+
+std::shared_ptr<SimSocket> SimBroker::open(const char* host, uint16_t port, uint32_t* rtt_us) {
+    *rtt_us = 0;
+    for (SimBroker* broker : all_brokers()) {
+        if (broker->broker_host != host || broker->broker_port != port) continue;
+        *rtt_us = broker->rtt_us;  // The SYN/ACK, or the RST from a stopped broker
+        if (!broker->up) return nullptr;
+        std::shared_ptr<SimSocket> socket = std::make_shared<SimSocket>();
+        socket->broker = broker;
+        broker->sockets.push_back(socket);
+        return socket;
+    }
+    return nullptr;
+}
+
+uint64_t SimBroker::send(SimSocket& socket, const std::string& bytes, uint64_t at_us) {
+    if (!socket.open || socket.half_open) return 0;
+    if (downlink_bps > 0) {
+        uint64_t share = downlink_bps / sockets.size();
+        at_us = max(at_us, socket.downlink_free_at_us) + (uint64_t)bytes.size() * 8 * 1000000 / share;
+        socket.downlink_free_at_us = at_us;
+    }
+    queue(socket.to_client, at_us + rtt_us / 2, bytes);
+    if ((uint8_t)bytes[0] >> 4 == 3) {
+        SimTraffic& sent = traffic[socket.client_id];
+        sent.messages++;
+        sent.bytes += bytes.size();
+    }
+    return at_us + rtt_us / 2;
+}
+
+void SimBroker::route(const std::string& topic, const std::string& payload, uint64_t at_us) {
+    std::string publish = packet(0x30, u16(topic.size()) + topic + payload);
+    for (size_t i = 0; i < sockets.size(); i++) {
+        SimSocket& socket = *sockets[i];
+        for (size_t f = 0; f < socket.filters.size(); f++) {
+            if (sim_topic_matches(socket.filters[f], topic)) {
+                uint64_t arrives = send(socket, publish, at_us);
+                if (arrives) deliveries[std::make_pair(socket.client_id, topic)] = arrives;
+                break;
+            }
+        }
+    }
+}
+
+void SimBroker::publish(const char* topic, const char* payload, bool retain) {
+    pump();
+    if (retain) {
+        retained.erase(std::remove_if(retained.begin(), retained.end(),
+                                      [topic](const std::pair<std::string, std::string>& r) { return r.first == topic; }),
+                       retained.end());
+        if (payload[0]) retained.push_back(std::make_pair(std::string(topic), std::string(payload)));
+    }
+    route(topic, payload, host_now_us());
+}
+
+void SimBroker::handle(SimSocket& socket, uint8_t type, uint8_t flags, const std::string& body, uint64_t at_us) {
+    size_t pos = 0;
+    switch (type) {
+        case 1: {  // CONNECT
+            std::string protocol;
+            std::string client_id;
+            if (!read_string(body, pos, &protocol) || pos + 4 > body.size()) break;
+            pos += 4;  // Level, flags, keepalive
+            if (!read_string(body, pos, &client_id)) break;
+            // A second connection with the same id takes over, as on a real broker
+            for (size_t i = 0; i < sockets.size(); i++) {
+                if (sockets[i].get() != &socket && sockets[i]->client_id == client_id) sockets[i]->close();
+            }
+            socket.client_id = client_id;
+            connect_count++;
+            send(socket, packet(0x20, u16(0)), at_us);
+            return;
+        }
+        case 3: {  // PUBLISH
+            SimPublish message;
+            message.qos = (flags >> 1) & 3;
+            message.retain = flags & 1;
+            message.client_id = socket.client_id;
+            message.at_us = at_us;
+            uint16_t packet_id = 0;
+            if (!read_string(body, pos, &message.topic)) break;
+            if (message.qos > 0 && !read_u16(body, pos, &packet_id)) break;
+            message.payload = body.substr(pos);
+            log.push_back(message);
+            if (message.retain) {
+                retained.erase(std::remove_if(retained.begin(), retained.end(),
+                                              [&message](const std::pair<std::string, std::string>& r) {
+                                                  return r.first == message.topic;
+                                              }),
+                               retained.end());
+                if (!message.payload.empty()) retained.push_back(std::make_pair(message.topic, message.payload));
+            }
+            if (message.qos == 1) send(socket, packet(0x40, u16(packet_id)), at_us);
+            route(message.topic, message.payload, at_us);
+            return;
+        }
+        case 8: {  // SUBSCRIBE
+            uint16_t packet_id;
+            if (flags != 0x2 || !read_u16(body, pos, &packet_id)) break;
+            std::string codes;
+            std::vector<std::string> added;
+            while (pos < body.size()) {
+                std::string filter;
+                if (!read_string(body, pos, &filter) || pos >= body.size()) {
+                    socket.close();
+                    return;
+                }
+                uint8_t qos = body[pos++];
+                if (std::find(socket.filters.begin(), socket.filters.end(), filter) == socket.filters.end()) {
+                    socket.filters.push_back(filter);
+                }
+                added.push_back(filter);
+                codes += (char)min(qos, (uint8_t)1);
+            }
+            if (added.empty()) break;
+            subscribe_count++;
+            send(socket, packet(0x90, u16(packet_id) + codes), at_us);
+            for (size_t r = 0; r < retained.size(); r++) {
+                for (size_t f = 0; f < added.size(); f++) {
+                    if (!sim_topic_matches(added[f], retained[r].first)) continue;
+                    const std::string& topic = retained[r].first;
+                    send(socket, packet(0x31, u16(topic.size()) + topic + retained[r].second), at_us);
+                    break;
+                }
+            }
+            return;
+        }
+        case 10: {  // UNSUBSCRIBE
+            uint16_t packet_id;
+            if (flags != 0x2 || !read_u16(body, pos, &packet_id)) break;
+            while (pos < body.size()) {
+                std::string filter;
+                if (!read_string(body, pos, &filter)) {
+                    socket.close();
+                    return;
+                }
+                socket.filters.erase(std::remove(socket.filters.begin(), socket.filters.end(), filter),
+                                     socket.filters.end());
+            }
+            send(socket, packet(0xB0, u16(packet_id)), at_us);
+            return;
+        }
+        case 4:  // PUBACK for QoS 1 deliveries; everything goes out at QoS 0
+            return;
+        case 12:  // PINGREQ
+            send(socket, packet(0xD0, ""), at_us);
+            return;
+        case 14:  // DISCONNECT
+            socket.close();
+            return;
+        default:
+            break;
+    }
+    // Anything unexpected or malformed: a real broker drops the connection
+    socket.close();
+}
+
+void SimBroker::pump() {
+    uint64_t now = host_now_us();
+    for (size_t i = 0; i < sockets.size(); i++) {
+        SimSocket& socket = *sockets[i];
+        while (socket.open && !socket.to_broker.empty() && socket.to_broker[0].at_us <= now) {
+            SimSocket::Segment segment = socket.to_broker[0];
+            socket.to_broker.erase(socket.to_broker.begin());
+            socket.broker_rx += segment.bytes;
+            for (;;) {
+                // Fixed header: type and flags, then up to four length bytes
+                const std::string& rx = socket.broker_rx;
+                size_t remaining = 0;
+                size_t header = 1;
+                bool complete = false;
+                for (int shift = 0; header < rx.size() && header <= 4; shift += 7) {
+                    uint8_t digit = rx[header++];
+                    remaining |= (size_t)(digit & 0x7F) << shift;
+                    if (!(digit & 0x80)) {
+                        complete = true;
+                        break;
+                    }
+                }
+                if (!complete || rx.size() < header + remaining) {
+                    if (header > 4 && !complete) socket.close();
+                    break;
+                }
+                uint8_t first = rx[0];
+                std::string body = rx.substr(header, remaining);
+                socket.broker_rx.erase(0, header + remaining);
+                handle(socket, first >> 4, first & 0x0F, body, segment.at_us);
+                if (!socket.open) break;
+            }
+        }
+        while (socket.open && !socket.to_client.empty() && socket.to_client[0].at_us <= now) {
+            socket.client_rx += socket.to_client[0].bytes;
+            socket.to_client.erase(socket.to_client.begin());
+        }
+    }
+    // Forget connections both ends have given up on
+    sockets.erase(std::remove_if(sockets.begin(), sockets.end(),
+                                 [](const std::shared_ptr<SimSocket>& s) { return !s->open; }),
+                  sockets.end());
+}
+
+void SimBroker::pump_all() {
+    // Twice, so a publish routed to a socket already pumped is delivered too
+    for (int pass = 0; pass < 2; pass++) {
+        for (SimBroker* broker : all_brokers()) broker->pump();
+    }
+}
+
+const std::vector<SimPublish>& SimBroker::received() {
+    pump_all();
+    return log;
+}
+
+void SimBroker::clear_received() {
+    pump_all();
+    log.clear();
+}
+
+std::vector<std::string> SimBroker::subscriptions(const char* client_id) {
+    pump_all();
+    for (size_t i = 0; i < sockets.size(); i++) {
+        if (sockets[i]->open && sockets[i]->client_id == client_id) return sockets[i]->filters;
+    }
+    return std::vector<std::string>();
+}
+
+uint64_t SimBroker::delivered_at(const char* client_id, const char* topic) {
+    pump_all();
+    auto delivery = deliveries.find(std::make_pair(std::string(client_id), std::string(topic)));
+    return delivery == deliveries.end() ? 0 : delivery->second;
+}
+
+SimTraffic SimBroker::delivered(const char* client_id) {
+    pump_all();
+    auto sent = traffic.find(client_id);
+    return sent == traffic.end() ? SimTraffic{0, 0} : sent->second;
+}
+
+bool SimBroker::connected(const char* client_id) {
+    pump_all();
+    for (size_t i = 0; i < sockets.size(); i++) {
+        if (sockets[i]->open && sockets[i]->client_id == client_id) return true;
+    }
+    return false;
+}
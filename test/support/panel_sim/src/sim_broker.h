@@ -0,0 +1,135 @@
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ======= Simulated MQTT Broker =======
+// An in-process MQTT 3.1.1 broker that the simulated WiFiClient connects
+// to by host and port. It parses packets on its own, independently of the
+// firmware's codec, so it can catch the firmware sending something wrong.
+// Bytes a client writes queue behind each other on its uplink (2 Mbit/s
+// unless set) and arrive half an RTT after they are sent; the broker's
+// replies arrive half an RTT after it sends them, after queueing on the
+// downlink if one is set. All on the virtual clock; nothing happens between calls, the broker catches up lazily
+// whenever either side looks.
+//
+// Handles CONNECT, SUBSCRIBE and UNSUBSCRIBE with wildcards, PUBLISH at
+// QoS 0 and 1 (delivered onward at QoS 0), retained messages, PINGREQ and
+// DISCONNECT.
+
+struct SimPublish {
+    std::string topic;
+    std::string payload;
+    std::string client_id;
+    uint8_t qos;
+    bool retain;
+    uint64_t at_us;  // When it reached the broker
+};
+
+// PUBLISH packets the broker has sent a client, retained replays included
+struct SimTraffic {
+    uint32_t messages;
+    uint64_t bytes;
+};
+
+struct SimSocket;
+
+class SimBroker {
+public:
+    SimBroker(const char* host, uint16_t port, uint32_t rtt_us = 2000);
+    ~SimBroker();
+
+    const char* host() const { return broker_host.c_str(); }
+    uint16_t port() const { return broker_port; }
+
+    // A down broker drops its connections and refuses new ones
+    void set_up(bool up);
+    bool is_up() const { return up; }
+    void set_rtt_us(uint32_t rtt) { rtt_us = rtt; }
+    uint32_t rtt() const { return rtt_us; }
+    void set_uplink_bps(uint32_t bps) { uplink_bps = bps; }
+    // Unlimited unless set. Open sockets share it equally, as TCP flows
+    // through one bottleneck do, and each queues behind its own earlier bytes
+    void set_downlink_bps(uint32_t bps) { downlink_bps = bps; }
+
+    // Existing connections stay open on both ends but nothing gets through,
+    // like a NAT entry that has silently expired
+    void set_half_open(bool half_open);
+
+    // Publish from outside, e.g. a sensor, to every matching subscription
+    void publish(const char* topic, const char* payload, bool retain = false);
+
+    // Everything clients published, in arrival order
+    const std::vector<SimPublish>& received();
+    void clear_received();
+
+    // When the last PUBLISH on `topic` reached `client_id`'s socket, 0 if none has
+    uint64_t delivered_at(const char* client_id, const char* topic);
+    SimTraffic delivered(const char* client_id);
+
+    // Filters currently held for `client_id`
+    std::vector<std::string> subscriptions(const char* client_id);
+    bool connected(const char* client_id);
+
+    uint32_t connects() const { return connect_count; }
+    uint32_t subscribe_packets() const { return subscribe_count; }
+    // Client writes, each one segment on a TCP_NODELAY socket
+    uint32_t segments() const { return segment_count; }
+
+    // Catch up with everything due by now; the socket side calls this too
+    static void pump_all();
+
+    // Used by WiFiClient
+    static std::shared_ptr<SimSocket> open(const char* host, uint16_t port, uint32_t* rtt_us);
+
+private:
+    friend struct SimSocket;
+    void pump();
+    void handle(SimSocket& socket, uint8_t type, uint8_t flags, const std::string& body, uint64_t at_us);
+    void route(const std::string& topic, const std::string& payload, uint64_t at_us);
+    // When `bytes` will reach the client, 0 if they never will
+    uint64_t send(SimSocket& socket, const std::string& bytes, uint64_t at_us);
+
+    std::string broker_host;
+    uint16_t broker_port;
+    uint32_t rtt_us;
+    uint32_t uplink_bps = 2000000;
+    uint32_t downlink_bps = 0;
+    bool up = true;
+    std::vector<std::shared_ptr<SimSocket>> sockets;
+    std::vector<SimPublish> log;
+    std::map<std::pair<std::string, std::string>, uint64_t> deliveries;  // Client id and topic
+    std::map<std::string, SimTraffic> traffic;
+    std::vector<std::pair<std::string, std::string>> retained;
+    uint32_t connect_count = 0;
+    uint32_t subscribe_count = 0;
+    uint32_t segment_count = 0;
+};
+
+// Both directions of one TCP connection
+struct SimSocket {
+    struct Segment {
+        uint64_t at_us;
+        std::string bytes;
+    };
+
+    SimBroker* broker;
+    bool open = true;
+    bool half_open = false;
+    uint64_t uplink_free_at_us = 0;  // When the client's earlier writes have been sent
+    uint64_t downlink_free_at_us = 0;  // When the broker's earlier replies have been sent
+    std::vector<Segment> to_broker;
+    std::vector<Segment> to_client;
+    std::string broker_rx;  // Arrived at the broker, not yet a whole packet
+    std::string client_rx;  // Arrived at the client, not yet read
+    std::string client_id;
+    std::vector<std::string> filters;
+
+    void client_write(const uint8_t* buf, size_t size);
+    void close();
+};
+
+// MQTT topic filter match with + and #
+bool sim_topic_matches(const std::string& filter, const std::string& topic);
@@ -0,0 +1,68 @@
+#include <WiFi.h>
+#include "host.h"
+#include "sim_broker.h"
+
+SimWiFi WiFi;
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, 3000);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeout_ms) {
+    stop();
+    SimBroker::pump_all();
+    uint32_t rtt_us;
+    socket = SimBroker::open(host, port, &rtt_us);
+    // No broker at all on that address: nothing answers until the timeout
+    host_advance_us(rtt_us ? rtt_us : (uint64_t)timeout_ms * 1000);
+    return socket ? 1 : 0;
+}
+
+size_t WiFiClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    if (!connected()) return 0;
+    socket->client_write(buf, size);
+    return size;
+}
+
+int WiFiClient::available() {
+    if (!socket) return 0;
+    SimBroker::pump_all();
+    return socket->client_rx.size();
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    if (available() == 0) return -1;
+    size_t n = min(size, socket->client_rx.size());
+    memcpy(buf, socket->client_rx.data(), n);
+    socket->client_rx.erase(0, n);
+    return n;
+}
+
+int WiFiClient::peek() {
+    return available() > 0 ? (uint8_t)socket->client_rx[0] : -1;
+}
+
+void WiFiClient::stop() {
+    if (socket) socket->close();
+    socket.reset();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!socket) return 0;
+    SimBroker::pump_all();
+    // Like lwIP, unread data keeps a closed socket readable
+    return socket->open || !socket->client_rx.empty();
+}
@@ -0,0 +1,139 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <host_client.h>
+#include "fault_client.h"
+#include "mqtt_session.h"
+
+// ======= Fault Client Tests =======
+// MqttSession over FaultClient over an in-memory socket. Whatever the fault,
+// the bytes that reach the socket must still parse as whole MQTT packets.
+
+static const uint8_t CONNACK[] = {0x20, 0x02, 0x00, 0x00};
+
+static HostClient wire;
+static FaultClient fault(wire);
+static uint8_t rx[256];
+static uint8_t tx[32];  // Small, so longer publishes are streamed as header + payload
+static MqttSession session(fault, rx, sizeof(rx), tx, sizeof(tx));
+
+struct Published {
+    int count;
+    int bad_payloads;
+};
+
+// Parses everything the socket received; false if it isn't whole packets
+static bool parse_sent(Published* out) {
+    *out = {0, 0};
+    const uint8_t* p = (const uint8_t*)wire.sent.data();
+    size_t left = wire.sent.size();
+    while (left > 0) {
+        MqttHeader header;
+        if (mqtt_parse_header(p, left, &header) != MQTT_PARSE_OK) return false;
+        size_t packet = header.header_len + header.remaining;
+        if (packet > left) return false;
+        if (header.type == MQTT_PKT_PUBLISH) {
+            MqttPublish message;
+            if (mqtt_parse_publish(header, p + header.header_len, &message) != MQTT_PARSE_OK) return false;
+            if (!message.topic.equals("t")) return false;
+            for (size_t i = 0; i < message.payload.len; i++) {
+                if (message.payload.data[i] != (uint8_t)i) {
+                    out->bad_payloads++;
+                    break;
+                }
+            }
+            out->count++;
+        }
+        p += packet;
+        left -= packet;
+    }
+    return true;
+}
+
+void setUp() {
+    fault.set_fault(FAULT_NONE, 0);
+    session.disconnect();
+    wire.sent.clear();
+    wire.incoming.clear();
+    wire.receive(CONNACK, sizeof(CONNACK));
+    session.set_server("broker", 1883);
+    TEST_ASSERT_TRUE(session.connect("test"));
+    randomSeed(54);
+}
+
+void tearDown() {}
+
+void test_loss_drops_whole_packets() {
+    static uint8_t payload[200];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = i;
+
+    fault.set_fault(FAULT_PACKET_LOSS, 50);
+    uint32_t dropped_before = fault.dropped_publishes();
+    const int sends = 400;
+    for (int i = 0; i < sends; i++) {
+        size_t length = (i % 3 == 0) ? 8 : 20 + i % 180;  // Mix of buffered and streamed
+        TEST_ASSERT_TRUE(session.publish("t", payload, length, false));
+    }
+
+    Published published;
+    TEST_ASSERT_TRUE_MESSAGE(parse_sent(&published), "socket stream is not whole MQTT packets");
+    TEST_ASSERT_EQUAL_INT(0, published.bad_payloads);
+    uint32_t dropped = fault.dropped_publishes() - dropped_before;
+    TEST_ASSERT_EQUAL_INT(sends, published.count + (int)dropped);
+    TEST_ASSERT_GREATER_THAN(sends / 4, (int)dropped);
+    TEST_ASSERT_GREATER_THAN(sends / 4, published.count);
+}
+
+void test_half_open_swallows_streamed_publish() {
+    uint8_t payload[100] = {};
+    fault.set_fault(FAULT_HALF_OPEN, 0);
+    size_t sent_before = wire.sent.size();
+    uint32_t dropped_before = fault.dropped_publishes();
+    TEST_ASSERT_TRUE(session.publish("t", payload, sizeof(payload), false));
+    TEST_ASSERT_EQUAL_size_t(sent_before, wire.sent.size());
+    TEST_ASSERT_EQUAL_UINT32(1, fault.dropped_publishes() - dropped_before);
+}
+
+void test_fault_cleared_mid_packet_finishes_the_drop() {
+    uint8_t payload[100];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = i;
+    uint8_t header[8];
+    size_t n = mqtt_encode_publish_header(header, sizeof(header), "t", sizeof(payload), 0, false, 0);
+
+    fault.set_fault(FAULT_HALF_OPEN, 0);
+    TEST_ASSERT_EQUAL_size_t(n, fault.write(header, n));
+    fault.set_fault(FAULT_NONE, 0);
+    TEST_ASSERT_EQUAL_size_t(sizeof(payload), fault.write(payload, sizeof(payload)));
+    TEST_ASSERT_TRUE(session.publish("t", payload, 10, false));
+
+    Published published;
+    TEST_ASSERT_TRUE(parse_sent(&published));
+    TEST_ASSERT_EQUAL_INT(1, published.count);
+}
+
+void test_reconnect_forgets_a_dropped_packet() {
+    uint8_t header[8];
+    size_t n = mqtt_encode_publish_header(header, sizeof(header), "t", 100, 0, false, 0);
+
+    // Header of a streamed publish swallowed, then the connection goes before its payload
+    fault.set_fault(FAULT_HALF_OPEN, 0);
+    fault.write(header, n);
+    fault.set_fault(FAULT_NONE, 0);
+    session.disconnect();
+    fault.stop();
+    wire.sent.clear();
+    wire.receive(CONNACK, sizeof(CONNACK));
+    TEST_ASSERT_TRUE(session.connect("test"));
+
+    MqttHeader connect;
+    TEST_ASSERT_EQUAL_INT(MQTT_PARSE_OK, mqtt_parse_header((const uint8_t*)wire.sent.data(), wire.sent.size(), &connect));
+    TEST_ASSERT_EQUAL_INT(MQTT_PKT_CONNECT, connect.type);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_loss_drops_whole_packets);
+    RUN_TEST(test_half_open_swallows_streamed_publish);
+    RUN_TEST(test_fault_cleared_mid_packet_finishes_the_drop);
+    RUN_TEST(test_reconnect_forgets_a_dropped_packet);
+    return UNITY_END();
+}
@@ -0,0 +1,72 @@
+#include <Arduino.h>
+#include <host.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap_monitor.h"
+
+// ======= Heap Monitor Tests =======
+// Runs in the native-alloc-check environment, which links malloc, calloc
+// and realloc through the heap monitor's wrappers. The tests share the
+// monitor's state and run in order: setup, warm-up, steady state.
+
+static void* volatile last_block;
+
+// Not inlined, so every allocation has the same caller
+__attribute__((noinline)) static void allocate(size_t bytes) {
+    last_block = malloc(bytes);
+    free(last_block);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_setup_allocations_are_not_counted() {
+    allocate(64);
+    heap_monitor_mark_steady_state();
+    TEST_ASSERT_EQUAL_UINT32(0, heap_steady_state_allocations());
+    TEST_ASSERT_TRUE(heap_monitor_check());
+}
+
+void test_warm_up_allocations_are_counted_not_failed() {
+    host_advance_ms(HEAP_ALLOC_WARMUP_MS / 2);
+    allocate(32);
+    TEST_ASSERT_EQUAL_UINT32(1, heap_steady_state_allocations());
+    TEST_ASSERT_TRUE(heap_monitor_check());
+}
+
+void test_allowed_scope_is_not_counted() {
+    host_advance_ms(HEAP_ALLOC_WARMUP_MS);
+    {
+        HeapAllocAllowed allow_alloc;
+        allocate(128);
+        last_block = calloc(4, 16);
+        last_block = realloc(last_block, 256);
+        free(last_block);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, heap_steady_state_allocations());
+    TEST_ASSERT_TRUE(heap_monitor_check());
+}
+
+void test_allocation_after_warm_up_fails_once() {
+    allocate(48);
+    TEST_ASSERT_EQUAL_UINT32(2, heap_steady_state_allocations());
+    TEST_ASSERT_FALSE(heap_monitor_check());
+    TEST_ASSERT_TRUE(heap_monitor_check());
+
+    // Both allocations came from allocate(), so they share one call site
+    char json[256];
+    heap_monitor_format(json, sizeof(json));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"loop_allocs\":2"));
+    TEST_ASSERT_NOT_NULL(strstr(json, ":[2,80]"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_setup_allocations_are_not_counted);
+    RUN_TEST(test_warm_up_allocations_are_counted_not_failed);
+    RUN_TEST(test_allowed_scope_is_not_counted);
+    RUN_TEST(test_allocation_after_warm_up_fails_once);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <PubSubClient.h>
+#include <chrono>
+#include <vector>
+#include "mqtt_session.h"
+
+// ======= MQTT Throughput Benchmark =======
+// MqttSession against PubSubClient 2.8, the library it replaced, on the same
+// in-memory streams: inbound publishes at QoS 0 and 1 (QoS 1 answered with a
+// PUBACK), and outbound QoS 0 publishes. Run with `pio test -e native-bench`;
+// it prints ns per message and fails only if MqttSession is slower by more
+// than timing noise.
+
+static const char* DOOR_TOPIC = "home/m5stack/core2/fridge_door/status";
+static const int REPEATS = 5;  // Best of, to keep scheduler noise out
+static const double NOISE_MARGIN = 1.5;  // Small outbound publishes cost about the same in both
+
+// Reads from a position instead of erasing what was read, so the socket
+// costs the same per byte however much is queued
+class BenchClient : public Client {
+public:
+    std::vector<uint8_t> incoming;
+    size_t pos = 0;
+    size_t written = 0;
+    bool is_connected = false;
+
+    int connect(IPAddress ip, uint16_t port) override {
+        (void)ip;
+        (void)port;
+        return is_connected = true;
+    }
+    int connect(const char* host, uint16_t port) override {
+        (void)host;
+        (void)port;
+        return is_connected = true;
+    }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override {
+        asm volatile("" : : "r"(buf) : "memory");  // Keep the encoding from being optimised away
+        written += size;
+        return size;
+    }
+    int available() override { return is_connected ? incoming.size() - pos : 0; }
+    int read() override { return pos < incoming.size() ? incoming[pos++] : -1; }
+    int read(uint8_t* buf, size_t size) override {
+        size_t n = min(size, incoming.size() - pos);
+        memcpy(buf, incoming.data() + pos, n);
+        pos += n;
+        return n;
+    }
+    int peek() override { return pos < incoming.size() ? incoming[pos] : -1; }
+    void flush() override {}
+    void stop() override { is_connected = false; }
+    uint8_t connected() override { return is_connected; }
+    operator bool() override { return is_connected; }
+    using Print::write;
+};
+
+static BenchClient wire;
+static uint8_t rx[512];
+static uint8_t tx[256];
+static MqttSession session(wire, rx, sizeof(rx), tx, sizeof(tx));
+static PubSubClient pubsub(wire);
+static size_t messages;
+static volatile size_t sink;
+
+static void on_pubsub_message(char* topic, uint8_t* payload, unsigned int length) {
+    (void)payload;
+    messages++;
+    sink += (strcmp(topic, DOOR_TOPIC) == 0) + length;
+}
+
+static void on_session_message(const MqttPublish& message) {
+    messages++;
+    sink += message.topic.equals(DOOR_TOPIC) + message.payload.len;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void setUp() {
+    pubsub.disconnect();
+    session.disconnect();
+    wire = BenchClient();
+    pubsub.setServer("broker", 1883);
+    pubsub.setCallback(on_pubsub_message);
+    pubsub.setBufferSize(256);
+    session.set_server("broker", 1883);
+    session.set_callback(on_session_message);
+    // One CONNACK each
+    static const uint8_t connacks[] = {0x20, 0x02, 0x00, 0x00, 0x20, 0x02, 0x00, 0x00};
+    wire.incoming.assign(connacks, connacks + sizeof(connacks));
+    TEST_ASSERT_TRUE(pubsub.connect("bench"));
+    TEST_ASSERT_TRUE(session.connect("bench"));
+    TEST_ASSERT_EQUAL(wire.incoming.size(), wire.pos);
+}
+
+void tearDown() {}
+
+static void report(const char* direction, size_t payload_len, int qos, double pubsub_s, double session_s, int n) {
+    char line[160];
+    snprintf(line, sizeof(line), "%s payload=%3u qos=%d  PubSubClient %6.1f ns/msg  MqttSession %6.1f ns/msg  x%.1f",
+             direction, (unsigned)payload_len, qos, pubsub_s / n * 1e9, session_s / n * 1e9, pubsub_s / session_s);
+    TEST_MESSAGE(line);
+}
+
+void test_inbound_throughput() {
+    const int n = 200000;
+    const size_t payload_lens[] = {6, 64, 200};
+    for (size_t payload_len : payload_lens) {
+        for (int qos = 0; qos <= 1; qos++) {
+            std::vector<uint8_t> payload(payload_len, 'x');
+            std::vector<uint8_t> stream;
+            uint8_t packet[300];
+            for (int i = 0; i < n; i++) {
+                size_t len = mqtt_encode_publish(packet, sizeof(packet), DOOR_TOPIC, payload.data(), payload_len,
+                                                 qos, false, 1 + i % 60000);
+                stream.insert(stream.end(), packet, packet + len);
+            }
+
+            double pubsub_best = 1e9, session_best = 1e9;
+            for (int rep = 0; rep < REPEATS; rep++) {
+                wire.incoming = stream;
+                wire.pos = 0;
+                messages = 0;
+                auto start = std::chrono::steady_clock::now();
+                while (wire.pos < wire.incoming.size()) pubsub.loop();
+                pubsub_best = min(pubsub_best, seconds_since(start));
+                TEST_ASSERT_EQUAL(n, messages);
+
+                wire.pos = 0;
+                messages = 0;
+                start = std::chrono::steady_clock::now();
+                while (wire.pos < wire.incoming.size()) session.loop();
+                session_best = min(session_best, seconds_since(start));
+                TEST_ASSERT_EQUAL(n, messages);
+            }
+            report("in ", payload_len, qos, pubsub_best, session_best, n);
+            TEST_ASSERT_TRUE(session_best < pubsub_best * NOISE_MARGIN);
+        }
+    }
+}
+
+void test_outbound_throughput() {
+    const int n = 1000000;
+    const size_t payload_lens[] = {6, 64, 200};
+    for (size_t payload_len : payload_lens) {
+        std::vector<uint8_t> payload(payload_len, 'x');
+        double pubsub_best = 1e9, session_best = 1e9;
+        for (int rep = 0; rep < REPEATS; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; i++) pubsub.publish(DOOR_TOPIC, payload.data(), payload_len, false);
+            pubsub_best = min(pubsub_best, seconds_since(start));
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; i++) session.publish(DOOR_TOPIC, payload.data(), payload_len, false);
+            session_best = min(session_best, seconds_since(start));
+        }
+        report("out", payload_len, 0, pubsub_best, session_best, n);
+        TEST_ASSERT_TRUE(session_best < pubsub_best * NOISE_MARGIN);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_inbound_throughput);
+    RUN_TEST(test_outbound_throughput);
+    return UNITY_END();
+}
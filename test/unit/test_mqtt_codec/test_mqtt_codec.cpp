@@ -0,0 +1,232 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <host.h>
+#include <host_client.h>
+#include <vector>
+#include "mqtt_session.h"
+
+// ======= MQTT Codec Fuzz Tests =======
+// Encode/parse round trips, random bytes through every parser, and
+// MqttSession fed valid streams with random damage and random read sizes.
+// Parsers get heap copies sized exactly, so a build with
+// -fsanitize=address reports any read past the bytes they were given.
+// FUZZ_ITERATIONS scales the run; the default keeps `pio test` quick.
+
+#ifndef FUZZ_ITERATIONS
+#define FUZZ_ITERATIONS 20000
+#endif
+
+static uint8_t random_byte() {
+    return random(256);
+}
+
+static void random_topic(char* topic, size_t max_len) {
+    size_t len = 1 + random(max_len);
+    for (size_t i = 0; i < len; i++) topic[i] = 'a' + random(26);
+    topic[len] = '\0';
+}
+
+void setUp() {
+    randomSeed(74);
+}
+
+void tearDown() {}
+
+void test_publish_round_trip() {
+    for (long i = 0; i < FUZZ_ITERATIONS; i++) {
+        char topic[80];
+        random_topic(topic, 70);
+        uint8_t payload[300];
+        size_t payload_len = random(sizeof(payload));
+        for (size_t k = 0; k < payload_len; k++) payload[k] = random_byte();
+        uint8_t qos = random(2);
+        bool retain = random(2);
+        uint16_t packet_id = 1 + random(65535);
+
+        uint8_t out[400];
+        size_t size = random(sizeof(out));
+        size_t needed = mqtt_publish_size(strlen(topic), payload_len, qos);
+        size_t n = mqtt_encode_publish(out, size, topic, payload, payload_len, qos, retain, packet_id);
+        if (needed > size) {
+            TEST_ASSERT_EQUAL(0, n);
+            continue;
+        }
+        TEST_ASSERT_EQUAL(needed, n);
+
+        MqttHeader header;
+        TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_header(out, n, &header));
+        TEST_ASSERT_EQUAL(n, header.header_len + header.remaining);
+        for (size_t cut = 0; cut < header.header_len; cut++) {
+            MqttHeader partial;
+            TEST_ASSERT_EQUAL(MQTT_PARSE_INCOMPLETE, mqtt_parse_header(out, cut, &partial));
+        }
+
+        MqttPublish message;
+        TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_publish(header, out + header.header_len, &message));
+        TEST_ASSERT_TRUE(message.topic.equals(topic));
+        TEST_ASSERT_EQUAL(payload_len, message.payload.len);
+        if (payload_len > 0) TEST_ASSERT_EQUAL_MEMORY(payload, message.payload.data, payload_len);
+        TEST_ASSERT_EQUAL(qos, message.qos);
+        TEST_ASSERT_EQUAL(retain, message.retain);
+        TEST_ASSERT_EQUAL(qos ? packet_id : 0, message.packet_id);
+    }
+}
+
+void test_control_packets_round_trip() {
+    for (long i = 0; i < FUZZ_ITERATIONS / 10; i++) {
+        uint8_t out[128];
+        uint16_t packet_id = 1 + random(65535);
+        char filter[64];
+        random_topic(filter, 60);
+
+        size_t n = mqtt_encode_subscribe(out, sizeof(out), packet_id, filter, 1);
+        MqttHeader header;
+        TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_header(out, n, &header));
+        TEST_ASSERT_EQUAL(MQTT_PKT_SUBSCRIBE, header.type);
+        TEST_ASSERT_EQUAL(0x02, header.flags);
+        TEST_ASSERT_EQUAL(n, header.header_len + header.remaining);
+
+        uint16_t parsed_id;
+        n = mqtt_encode_ack(out, sizeof(out), MQTT_PKT_PUBACK, packet_id);
+        TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_header(out, n, &header));
+        TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_ack(header, out + header.header_len, &parsed_id));
+        TEST_ASSERT_EQUAL(packet_id, parsed_id);
+
+        n = mqtt_encode_connect(out, sizeof(out), filter, "user", "secret", 15, true);
+        TEST_ASSERT_NOT_EQUAL(0, n);
+        TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_header(out, n, &header));
+        TEST_ASSERT_EQUAL(MQTT_PKT_CONNECT, header.type);
+        TEST_ASSERT_EQUAL(n, header.header_len + header.remaining);
+    }
+}
+
+// Random bytes, biased towards valid first bytes, through every parser
+void test_parsers_stay_inside_the_buffer() {
+    static const uint8_t first_bytes[] = {0x30, 0x32, 0x40, 0x90, 0xB0, 0xD0, 0x20, 0xFF};
+    for (long i = 0; i < FUZZ_ITERATIONS; i++) {
+        size_t n = random(64);
+        uint8_t* buf = (uint8_t*)malloc(n ? n : 1);
+        for (size_t k = 0; k < n; k++) {
+            buf[k] = random(4) ? random_byte() : first_bytes[random(sizeof(first_bytes))];
+        }
+
+        MqttHeader header;
+        if (mqtt_parse_header(buf, n, &header) == MQTT_PARSE_OK && header.header_len + header.remaining <= n) {
+            const uint8_t* body = buf + header.header_len;
+            const uint8_t* end = body + header.remaining;
+            MqttPublish message;
+            if (mqtt_parse_publish(header, body, &message) == MQTT_PARSE_OK) {
+                TEST_ASSERT_TRUE(message.topic.data + message.topic.len <= end);
+                TEST_ASSERT_TRUE(message.payload.data + message.payload.len == end);
+            }
+            bool session_present;
+            uint8_t return_code;
+            uint16_t packet_id;
+            MqttView codes;
+            mqtt_parse_connack(header, body, &session_present, &return_code);
+            mqtt_parse_ack(header, body, &packet_id);
+            if (mqtt_parse_suback(header, body, &packet_id, &codes) == MQTT_PARSE_OK) {
+                TEST_ASSERT_TRUE(codes.data + codes.len <= end);
+            }
+        }
+        free(buf);
+    }
+}
+
+// ======= Session =======
+static HostClient wire;
+static uint8_t rx[256];
+static uint8_t tx[128];
+static MqttSession session(wire, rx, sizeof(rx), tx, sizeof(tx));
+static size_t delivered;
+
+static void check_message(const MqttPublish& message) {
+    // Touch every byte, so a view past the receive buffer shows up under ASan
+    uint32_t sum = 0;
+    for (size_t i = 0; i < message.topic.len; i++) sum += message.topic.data[i];
+    for (size_t i = 0; i < message.payload.len; i++) sum += message.payload.data[i];
+    (void)sum;
+    TEST_ASSERT_TRUE(message.topic.data >= rx && message.topic.data + message.topic.len <= rx + sizeof(rx));
+    delivered++;
+}
+
+// A PUBLISH (sometimes larger than rx), PUBACK, SUBACK or PINGRESP
+static void queue_valid_packet() {
+    static uint8_t packet[700];
+    static uint8_t payload[600];
+    size_t n = 0;
+    int kind = random(6);
+    if (kind < 3) {
+        char topic[48];
+        random_topic(topic, 40);
+        size_t len = random(kind == 2 ? 600 : 40);
+        for (size_t i = 0; i < len; i++) payload[i] = random_byte();
+        n = mqtt_encode_publish(packet, sizeof(packet), topic, payload, len, random(2), random(2),
+                                1 + random(65535));
+    } else if (kind == 3) {
+        n = mqtt_encode_ack(packet, sizeof(packet), MQTT_PKT_PUBACK, random(65536));
+    } else if (kind == 4) {
+        const uint8_t suback[] = {0x90, 0x03, 0x00, 0x01, (uint8_t)(random(2) ? 0x00 : 0x80)};
+        memcpy(packet, suback, sizeof(suback));
+        n = sizeof(suback);
+    } else {
+        n = mqtt_encode_empty(packet, sizeof(packet), MQTT_PKT_PINGRESP);
+    }
+    wire.receive(packet, n);
+}
+
+static void damage_stream() {
+    int mutations = random(4);
+    for (int i = 0; i < mutations && wire.incoming.size() > 4; i++) {
+        size_t at = 4 + random(wire.incoming.size() - 4);  // The CONNACK stays intact
+        switch (random(3)) {
+            case 0: wire.incoming[at] = random_byte(); break;
+            case 1: wire.incoming.erase(at, 1); break;
+            case 2: wire.incoming.insert(at, 1, (char)random_byte()); break;
+        }
+    }
+}
+
+void test_session_survives_damaged_streams() {
+    static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    session.set_server("broker", 1883);
+    session.set_callback(check_message);
+    int sessions = 0;
+    delivered = 0;
+    for (long i = 0; i < FUZZ_ITERATIONS / 20; i++) {
+        session.disconnect();
+        wire.incoming.clear();
+        wire.sent.clear();
+        wire.receive(connack, sizeof(connack));
+        int packets = 1 + random(20);
+        for (int k = 0; k < packets; k++) queue_valid_packet();
+        damage_stream();
+
+        wire.read_limit = 1 + random(300);
+        if (!session.connect("fuzz")) continue;
+        sessions++;
+        const uint8_t command[8] = {};
+        session.publish("cmd/x", command, sizeof(command), false, 1);
+        for (int k = 0; k < 2000 && session.connected() && !wire.incoming.empty(); k++) {
+            wire.read_limit = 1 + random(300);
+            session.loop();
+            host_advance_ms(1);
+        }
+    }
+    MqttSessionStats stats = session.stats();
+    char line[160];
+    snprintf(line, sizeof(line), "%d sessions, %lu messages, %lu oversized, %lu malformed", sessions,
+             (unsigned long)delivered, (unsigned long)stats.oversized, (unsigned long)stats.malformed);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, sessions);
+    TEST_ASSERT_GREATER_THAN(0, delivered);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_publish_round_trip);
+    RUN_TEST(test_control_packets_round_trip);
+    RUN_TEST(test_parsers_stay_inside_the_buffer);
+    RUN_TEST(test_session_survives_damaged_streams);
+    return UNITY_END();
+}
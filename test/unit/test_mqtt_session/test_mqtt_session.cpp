@@ -0,0 +1,211 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <host.h>
+#include <host_client.h>
+#include <string>
+#include <vector>
+#include "mqtt_session.h"
+
+// ======= MQTT Session Tests =======
+// MqttSession against an in-memory socket: what it hands the callback, what
+// it writes back, and how it treats late, refused and malformed traffic.
+
+static const uint8_t CONNACK[] = {0x20, 0x02, 0x00, 0x00};
+
+static HostClient wire;
+static uint8_t rx[256];
+static uint8_t tx[64];
+static MqttSession session(wire, rx, sizeof(rx), tx, sizeof(tx));
+static std::vector<std::string> received;  // "topic=payload length"
+
+static void record_message(const MqttPublish& message) {
+    received.push_back(std::string((const char*)message.topic.data, message.topic.len) + "=" +
+                       std::to_string(message.payload.len));
+}
+
+static void queue_publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos,
+                          uint16_t packet_id) {
+    static uint8_t packet[1024];
+    size_t n = mqtt_encode_publish(packet, sizeof(packet), topic, payload, length, qos, false, packet_id);
+    TEST_ASSERT_NOT_EQUAL(0, n);
+    wire.receive(packet, n);
+}
+
+static void loop_until_drained() {
+    for (int i = 0; i < 2000 && !wire.incoming.empty(); i++) session.loop();
+}
+
+// Packet id of the QoS 1 publish at the start of `sent`
+static uint16_t sent_packet_id() {
+    const uint8_t* p = (const uint8_t*)wire.sent.data();
+    MqttHeader header;
+    TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_header(p, wire.sent.size(), &header));
+    MqttPublish message;
+    TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_publish(header, p + header.header_len, &message));
+    return message.packet_id;
+}
+
+static void connect() {
+    wire.receive(CONNACK, sizeof(CONNACK));
+    TEST_ASSERT_TRUE(session.connect("test"));
+    wire.sent.clear();
+}
+
+void setUp() {
+    session.disconnect();
+    host_advance_ms(MQTT_INFLIGHT_EXPIRY);  // Anything left in flight expires on the next loop()
+    wire.sent.clear();
+    wire.incoming.clear();
+    wire.read_limit = 0;
+    received.clear();
+    session.set_server("broker", 1883);
+    session.set_keepalive(15);
+    session.set_callback(record_message);
+    connect();
+    session.loop();
+    wire.sent.clear();
+}
+
+void tearDown() {}
+
+void test_connect_sends_credentials() {
+    session.disconnect();
+    wire.sent.clear();
+    wire.receive(CONNACK, sizeof(CONNACK));
+    TEST_ASSERT_TRUE(session.connect("id", "user", "secret"));
+    TEST_ASSERT_EQUAL_HEX8(0x10, (uint8_t)wire.sent[0]);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, wire.sent.find("secret"));
+    TEST_ASSERT_EQUAL(MQTT_STATE_CONNECTED, session.state());
+}
+
+void test_refused_connack_sets_state() {
+    session.disconnect();
+    const uint8_t refused[] = {0x20, 0x02, 0x00, 0x05};
+    wire.receive(refused, sizeof(refused));
+    TEST_ASSERT_FALSE(session.connect("id"));
+    TEST_ASSERT_EQUAL(5, session.state());
+}
+
+// A packet larger than rx is skipped and the ones around it still arrive,
+// however the socket splits the stream
+void test_oversized_packet_is_skipped() {
+    static uint8_t big[600];
+    const size_t limits[] = {1, 7, 100, 0};
+    for (size_t limit : limits) {
+        received.clear();
+        wire.read_limit = limit;
+        queue_publish("a/1", (const uint8_t*)"x", 1, 1, 7);
+        queue_publish("big", big, sizeof(big), 0, 0);
+        queue_publish("a/2", (const uint8_t*)"yy", 2, 0, 0);
+        wire.sent.clear();
+        loop_until_drained();
+
+        TEST_ASSERT_EQUAL(2, received.size());
+        TEST_ASSERT_EQUAL_STRING("a/1=1", received[0].c_str());
+        TEST_ASSERT_EQUAL_STRING("a/2=2", received[1].c_str());
+        // PUBACK for packet 7
+        TEST_ASSERT_EQUAL(4, wire.sent.size());
+        TEST_ASSERT_EQUAL_HEX8(0x40, (uint8_t)wire.sent[0]);
+        TEST_ASSERT_EQUAL(7, (uint8_t)wire.sent[3]);
+    }
+    TEST_ASSERT_EQUAL(4, session.stats().oversized);
+}
+
+// Everything received is handled in one loop() call
+void test_loop_handles_every_complete_packet() {
+    for (int i = 0; i < 20; i++) queue_publish("a/b", (const uint8_t*)"1", 1, 0, 0);
+    session.loop();
+    TEST_ASSERT_EQUAL(20, received.size());
+}
+
+void test_qos1_publish_retried_until_puback() {
+    TEST_ASSERT_TRUE(session.publish("cmd/lamp", (const uint8_t*)"ON", 2, false, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x32, (uint8_t)wire.sent[0]);
+    uint16_t packet_id = sent_packet_id();
+    TEST_ASSERT_EQUAL(1, session.stats().inflight);
+
+    wire.sent.clear();
+    host_advance_ms(MQTT_RETRY_INTERVAL);
+    session.loop();
+    TEST_ASSERT_EQUAL_HEX8(0x3A, (uint8_t)wire.sent[0]);  // DUP set
+    TEST_ASSERT_EQUAL(packet_id, sent_packet_id());
+
+    uint8_t ack[4];
+    mqtt_encode_ack(ack, sizeof(ack), MQTT_PKT_PUBACK, packet_id);
+    wire.receive(ack, sizeof(ack));
+    session.loop();
+    TEST_ASSERT_EQUAL(0, session.stats().inflight);
+}
+
+void test_full_inflight_table_refuses() {
+    uint32_t refused = session.stats().inflight_full;
+    std::vector<uint16_t> ids;
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+        wire.sent.clear();
+        TEST_ASSERT_TRUE(session.publish("cmd/lamp", (const uint8_t*)"ON", 2, false, 1));
+        uint16_t id = sent_packet_id();
+        for (uint16_t other : ids) TEST_ASSERT_NOT_EQUAL(other, id);
+        ids.push_back(id);
+    }
+    TEST_ASSERT_FALSE(session.publish("cmd/lamp", (const uint8_t*)"ON", 2, false, 1));
+    TEST_ASSERT_EQUAL(refused + 1, session.stats().inflight_full);
+}
+
+void test_inflight_resent_after_reconnect_then_expired() {
+    uint32_t retransmits = session.stats().retransmits;
+    uint32_t expired = session.stats().expired;
+    for (int i = 0; i < 3; i++) session.publish("cmd/lamp", (const uint8_t*)"ON", 2, false, 1);
+    session.disconnect();
+    connect();
+    TEST_ASSERT_EQUAL(retransmits + 3, session.stats().retransmits);
+
+    host_advance_ms(MQTT_INFLIGHT_EXPIRY);
+    session.loop();
+    TEST_ASSERT_EQUAL(0, session.stats().inflight);
+    TEST_ASSERT_EQUAL(expired + 3, session.stats().expired);
+}
+
+// Larger than tx: header from tx, payload straight from the caller
+void test_large_publish_is_streamed_whole() {
+    static uint8_t payload[1000];
+    TEST_ASSERT_TRUE(session.publish("home/m5stack/core2/log/abc", payload, sizeof(payload), false));
+    MqttHeader header;
+    TEST_ASSERT_EQUAL(MQTT_PARSE_OK, mqtt_parse_header((const uint8_t*)wire.sent.data(), wire.sent.size(), &header));
+    TEST_ASSERT_EQUAL(wire.sent.size(), header.header_len + header.remaining);
+}
+
+void test_keepalive_ping_then_timeout() {
+    host_advance_ms(15000);
+    session.loop();
+    TEST_ASSERT_EQUAL(2, wire.sent.size());
+    TEST_ASSERT_EQUAL_HEX8(0xC0, (uint8_t)wire.sent[0]);
+
+    host_advance_ms(15000);
+    session.loop();
+    TEST_ASSERT_FALSE(session.connected());
+    TEST_ASSERT_EQUAL(MQTT_STATE_CONNECTION_TIMEOUT, session.state());
+}
+
+void test_malformed_packet_drops_connection() {
+    uint32_t malformed = session.stats().malformed;
+    const uint8_t bad[] = {0x30, 0x03, 0x00, 0x05, 'a'};  // Topic longer than the packet
+    wire.receive(bad, sizeof(bad));
+    session.loop();
+    TEST_ASSERT_FALSE(session.connected());
+    TEST_ASSERT_EQUAL(malformed + 1, session.stats().malformed);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_connect_sends_credentials);
+    RUN_TEST(test_refused_connack_sets_state);
+    RUN_TEST(test_oversized_packet_is_skipped);
+    RUN_TEST(test_loop_handles_every_complete_packet);
+    RUN_TEST(test_qos1_publish_retried_until_puback);
+    RUN_TEST(test_full_inflight_table_refuses);
+    RUN_TEST(test_inflight_resent_after_reconnect_then_expired);
+    RUN_TEST(test_large_publish_is_streamed_whole);
+    RUN_TEST(test_keepalive_ping_then_timeout);
+    RUN_TEST(test_malformed_packet_drops_connection);
+    return UNITY_END();
+}
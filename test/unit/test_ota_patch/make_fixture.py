@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Regenerate ota_fixture.h: a signed delta between two generated images.
+
+Usage: make_fixture.py > ota_fixture.h
+
+The images come from the same generator as test_ota_patch.cpp, so only the
+delta and the public keys are stored. Fresh throwaway keys are made each run.
+"""
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "..", "tools"))
+import ota_delta  # noqa: E402
+
+IMAGE_SIZE = 12000
+
+
+def image(seed, size):
+    x = seed
+    out = bytearray()
+    for _ in range(size):
+        x = (x * 1103515245 + 12345) & 0xFFFFFFFF
+        out.append((x >> 16) & 0xFF)
+    return bytes(out)
+
+
+def old_image():
+    return image(61, IMAGE_SIZE)
+
+
+def new_image():
+    old = old_image()
+    patched = bytearray(old[3000:6000])
+    for i in range(0, len(patched), 97):
+        patched[i] = (patched[i] + 1) & 0xFF
+    inserted = b"signed delta OTA host test, version 2\n"
+    return old[:3000] + bytes(patched) + inserted + old[8000:] + old[6000:8000]
+
+
+def public_key(key_path):
+    pem = subprocess.run(["openssl", "ec", "-in", key_path, "-pubout"], stdout=subprocess.PIPE,
+                         stderr=subprocess.DEVNULL, check=True).stdout.decode()
+    return "".join('    "%s\\n"\n' % line for line in pem.strip().splitlines())
+
+
+def c_array(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + " ".join("0x%02x," % b for b in data[i:i + 16]))
+    return "\n".join(rows)
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp:
+        key, other = os.path.join(tmp, "key.pem"), os.path.join(tmp, "other.pem")
+        for path in (key, other):
+            subprocess.run(["openssl", "ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", path],
+                           check=True)
+        delta = ota_delta.diff(old_image(), new_image(), key)
+        assert ota_delta.apply(old_image(), delta, key) == new_image()
+        print("#pragma once")
+        print("// Generated by make_fixture.py; do not edit")
+        print("#include <stdint.h>\n")
+        print("static const char* const FIXTURE_KEY =\n%s;\n" % public_key(key).rstrip())
+        print("static const char* const FIXTURE_OTHER_KEY =\n%s;\n" % public_key(other).rstrip())
+        print("static const uint8_t FIXTURE_DELTA[] = {\n%s\n};" % c_array(delta))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,33 @@
+#pragma once
+// Generated by make_fixture.py; do not edit
+#include <stdint.h>
+
+static const char* const FIXTURE_KEY =
+    "-----BEGIN PUBLIC KEY-----\n"
+    "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAEzXH0M1yBGGMLrurMzMY8/859Yl5Y\n"
+    "3toGTIQ0mtoTHKib7uhjND5egdKKxy65J+S4o+RilNKuaD8rP87ZhRoo3A==\n"
+    "-----END PUBLIC KEY-----\n";
+
+static const char* const FIXTURE_OTHER_KEY =
+    "-----BEGIN PUBLIC KEY-----\n"
+    "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAESJShb9taoJWcbM3Qg2lDTQsL9d8D\n"
+    "MIAG+v1nt1c2tducpVW2Fsygo3P4PML3dGhofvDeLy8HGk1bsehC8mh4mw==\n"
+    "-----END PUBLIC KEY-----\n";
+
+static const uint8_t FIXTURE_DELTA[] = {
+    0x4d, 0x35, 0x44, 0x32, 0xe0, 0x2e, 0x00, 0x00, 0x06, 0x2f, 0x00, 0x00, 0xdd, 0x93, 0xc3, 0x48,
+    0x72, 0x7f, 0x49, 0xe2, 0x58, 0x0c, 0xb9, 0x45, 0xd0, 0x02, 0x36, 0x93, 0xac, 0x9c, 0x71, 0xca,
+    0xbb, 0x98, 0x41, 0x03, 0x8d, 0x9b, 0xd3, 0x8b, 0x64, 0xe5, 0x2a, 0x92, 0xc0, 0x76, 0x39, 0x00,
+    0x5d, 0x66, 0xa3, 0xb9, 0x95, 0x70, 0xe9, 0x98, 0x1c, 0x1f, 0x43, 0xdd, 0xe7, 0x5f, 0x95, 0x3c,
+    0x2f, 0xe5, 0x0a, 0x42, 0x4a, 0x3b, 0x62, 0xa3, 0xbb, 0xaf, 0xba, 0x74, 0x47, 0x30, 0x45, 0x02,
+    0x21, 0x00, 0xc5, 0x55, 0xe3, 0x5f, 0xe5, 0x84, 0x3f, 0x87, 0xee, 0xc5, 0xef, 0x6c, 0x6f, 0x0b,
+    0xb5, 0x4e, 0xc3, 0x59, 0x22, 0x2c, 0xc3, 0xe7, 0x52, 0xca, 0x66, 0x0a, 0xec, 0x8a, 0x60, 0x00,
+    0x4b, 0xe4, 0x02, 0x20, 0x3c, 0x51, 0xa8, 0x0a, 0xc4, 0x90, 0x53, 0xd3, 0xc1, 0x55, 0x7b, 0x74,
+    0x7d, 0x9c, 0x53, 0xda, 0xa2, 0x4d, 0x37, 0x65, 0x8c, 0xc4, 0x93, 0x8a, 0x8e, 0xcd, 0x89, 0x9a,
+    0x47, 0x16, 0xf2, 0x20, 0x00, 0xff, 0x01, 0x00, 0xf0, 0x2e, 0xb8, 0x17, 0x01, 0x01, 0xc1, 0x60,
+    0x00, 0x2f, 0x00, 0x2f, 0x00, 0x2f, 0x00, 0x2f, 0x00, 0x2e, 0x59, 0x00, 0xff, 0x02, 0x26, 0x73,
+    0x69, 0x67, 0x6e, 0x65, 0x64, 0xff, 0x20, 0x64, 0x65, 0x6c, 0x74, 0x61, 0x20, 0x4f, 0xff, 0x54,
+    0x41, 0x20, 0x68, 0x6f, 0x73, 0x74, 0x20, 0xff, 0x74, 0x65, 0x73, 0x74, 0x2c, 0x20, 0x76, 0x65,
+    0xff, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x32, 0x0a, 0xff, 0x01, 0xc0, 0x3e, 0xa0, 0x1f, 0xa0,
+    0x1f, 0x00, 0xff, 0x01, 0xf0, 0x2e, 0xd0, 0x0f, 0xd0, 0x0f, 0x00, 0x01, 0x00,
+};
@@ -0,0 +1,144 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <host_client.h>
+#include <string>
+#include <vector>
+#include "ota_patch.h"
+#include "ota_fixture.h"
+
+// ======= Delta Patch Tests =======
+// Applies the signed fixture delta from make_fixture.py to a base image in
+// memory, then checks that unsigned, re-signed, tampered, truncated and
+// misapplied deltas are all rejected before or while writing.
+
+static const size_t IMAGE_SIZE = 12000;
+static const size_t SIGNED_SIZE = 76;
+
+static std::vector<uint8_t> base;
+static std::vector<uint8_t> written;
+
+// Same generator as make_fixture.py
+static std::vector<uint8_t> image(uint32_t seed, size_t size) {
+    std::vector<uint8_t> out;
+    uint32_t x = seed;
+    for (size_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        out.push_back((x >> 16) & 0xff);
+    }
+    return out;
+}
+
+static std::vector<uint8_t> new_image() {
+    std::vector<uint8_t> old = image(61, IMAGE_SIZE);
+    std::vector<uint8_t> out(old.begin(), old.begin() + 3000);
+    for (size_t i = 3000; i < 6000; i++) {
+        out.push_back(old[i] + ((i - 3000) % 97 == 0 ? 1 : 0));
+    }
+    const char* inserted = "signed delta OTA host test, version 2\n";
+    out.insert(out.end(), inserted, inserted + strlen(inserted));
+    out.insert(out.end(), old.begin() + 8000, old.end());
+    out.insert(out.end(), old.begin() + 6000, old.begin() + 8000);
+    return out;
+}
+
+static bool read_base(void* arg, size_t offset, uint8_t* dst, size_t len) {
+    (void)arg;
+    if (offset + len > base.size()) return false;
+    memcpy(dst, base.data() + offset, len);
+    return true;
+}
+
+static bool write_image(void* arg, const uint8_t* data, size_t len) {
+    (void)arg;
+    written.insert(written.end(), data, data + len);
+    return true;
+}
+
+static const OtaPatchIo io = {read_base, write_image, nullptr};
+
+// Runs a delta through begin and apply as ota_delta_apply() does
+static OtaResult apply(const std::string& delta, size_t length, const char* key) {
+    HostClient stream;
+    stream.is_connected = true;
+    stream.receive(delta.data(), delta.size());
+    stream.setTimeout(0);
+    OtaPatchHeader header;
+    OtaResult result = ota_patch_begin(stream, length, key, io, &header);
+    if (result != OTA_OK) return result;
+    return ota_patch_apply(header, io);
+}
+
+static OtaResult apply(const std::string& delta, const char* key = FIXTURE_KEY) {
+    return apply(delta, delta.size(), key);
+}
+
+static std::string fixture() {
+    return std::string((const char*)FIXTURE_DELTA, sizeof(FIXTURE_DELTA));
+}
+
+void setUp() {
+    base = image(61, IMAGE_SIZE);
+    written.clear();
+}
+
+void tearDown() {}
+
+void test_signed_delta_applies() {
+    TEST_ASSERT_EQUAL_STRING("ok", ota_result_name(apply(fixture())));
+    std::vector<uint8_t> expected = new_image();
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), written.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), written.data(), expected.size());
+}
+
+void test_unsigned_delta_is_rejected() {
+    std::string delta = fixture();
+    delta[SIGNED_SIZE] = 0;  // sig_len
+    TEST_ASSERT_EQUAL_INT(OTA_BAD_SIGNATURE, apply(delta));
+    TEST_ASSERT_EQUAL_INT(OTA_BAD_SIGNATURE, apply(fixture(), nullptr));
+    TEST_ASSERT_EQUAL_UINT32(0, written.size());
+}
+
+void test_other_key_is_rejected() {
+    TEST_ASSERT_EQUAL_INT(OTA_BAD_SIGNATURE, apply(fixture(), FIXTURE_OTHER_KEY));
+    TEST_ASSERT_EQUAL_UINT32(0, written.size());
+}
+
+void test_tampered_header_is_rejected() {
+    for (size_t i = 4; i < SIGNED_SIZE; i += 9) {
+        std::string delta = fixture();
+        delta[i] ^= 0x01;
+        TEST_ASSERT_EQUAL_INT(OTA_BAD_SIGNATURE, apply(delta));
+    }
+    std::string old_format = fixture();
+    old_format[3] = '1';  // Unsigned "M5D1" deltas
+    TEST_ASSERT_EQUAL_INT(OTA_BAD_HEADER, apply(old_format));
+    TEST_ASSERT_EQUAL_UINT32(0, written.size());
+}
+
+void test_wrong_base_is_rejected() {
+    base[IMAGE_SIZE / 2] ^= 0xff;
+    TEST_ASSERT_EQUAL_INT(OTA_BASE_MISMATCH, apply(fixture()));
+    TEST_ASSERT_EQUAL_UINT32(0, written.size());
+}
+
+void test_corrupt_ops_fail_verification() {
+    const size_t header_size = SIGNED_SIZE + 1 + OTA_SIG_MAX;
+    for (size_t i = header_size; i < sizeof(FIXTURE_DELTA); i += 7) {
+        std::string delta = fixture();
+        delta[i] ^= 0x20;
+        written.clear();
+        TEST_ASSERT_NOT_EQUAL(OTA_OK, apply(delta));
+    }
+    TEST_ASSERT_EQUAL_INT(OTA_STREAM_ERROR, apply(fixture(), sizeof(FIXTURE_DELTA) - 10, FIXTURE_KEY));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_signed_delta_applies);
+    RUN_TEST(test_unsigned_delta_is_rejected);
+    RUN_TEST(test_other_key_is_rejected);
+    RUN_TEST(test_tampered_header_is_rejected);
+    RUN_TEST(test_wrong_base_is_rejected);
+    RUN_TEST(test_corrupt_ops_fail_verification);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "state_store.h"
+
+// ======= State Store Tests =======
+// Version bookkeeping per setter; a reader held off by a write the write
+// hook keeps open; then a reader thread taking snapshots while this thread
+// writes as fast as it can. Every write flips one device bit between
+// bumping the sequence and bumping the versions, so a copy that overlapped
+// a write shows up as bits that do not match the versions. On a single
+// core the writes rarely overlap a copy, so the last test proves little
+// there and the held write carries the retry path.
+
+static void expect_bump(const UiState& before, StateSlice slice) {
+    const UiState& now = state_current();
+    TEST_ASSERT_EQUAL_UINT32(before.version + 1, now.version);
+    for (int i = 0; i < SLICE_COUNT; i++) {
+        uint32_t expected = before.slice_version[i] + (i == slice ? 1 : 0);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected, now.slice_version[i], "slice version");
+    }
+}
+
+static void expect_no_bump(const UiState& before) {
+    TEST_ASSERT_EQUAL_MEMORY(&before, &state_current(), sizeof(UiState));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_each_setter_bumps_its_slice() {
+    UiState before = state_current();
+    state_set_menu(before.menu + 1, 0, 0);
+    expect_bump(before, SLICE_MENU);
+
+    before = state_current();
+    state_set_device(3, !state_device_on(before, 3));
+    expect_bump(before, SLICE_DEVICES);
+
+    before = state_current();
+    state_set_door(1, !state_door_open(before, 1));
+    expect_bump(before, SLICE_DOORS);
+
+    before = state_current();
+    state_set_alert_flash(!before.alert_flash_hidden);
+    expect_bump(before, SLICE_ALERT_FLASH);
+
+    // Alert text lives elsewhere, so every call counts as a change
+    before = state_current();
+    state_alerts_changed();
+    expect_bump(before, SLICE_ALERTS);
+}
+
+void test_unchanged_value_bumps_nothing() {
+    UiState before = state_current();
+    state_set_menu(before.menu, before.selected_index, before.scroll_offset);
+    state_set_device(3, state_device_on(before, 3));
+    state_set_door(1, state_door_open(before, 1));
+    state_set_alert_flash(before.alert_flash_hidden);
+    expect_no_bump(before);
+}
+
+void test_out_of_range_index_ignored() {
+    UiState before = state_current();
+    state_set_device(-1, true);
+    state_set_device(STATE_MAX_DEVICES, true);
+    state_set_door(-1, true);
+    state_set_door(STATE_MAX_DOORS, true);
+    expect_no_bump(before);
+}
+
+void test_snapshot_matches_current() {
+    state_set_menu(2, 5, 1);
+    state_set_device(7, true);
+    UiState copy;
+    state_snapshot(&copy);
+    TEST_ASSERT_EQUAL_MEMORY(&state_current(), &copy, sizeof(UiState));
+}
+
+static std::thread held_reader;
+static std::atomic<bool> held_reader_done(false);
+static bool returned_mid_write;
+static UiState held_copy;
+
+// Runs mid-write: starts a reader and gives it time it can only spend retrying
+static void hold_write() {
+    held_reader = std::thread([] {
+        state_snapshot(&held_copy);
+        held_reader_done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    returned_mid_write = held_reader_done;  // Asserted once the reader is joined
+}
+
+void test_snapshot_waits_out_a_write() {
+    UiState before = state_current();
+    state_set_write_hook(hold_write);
+    state_set_door(2, !state_door_open(before, 2));
+    state_set_write_hook(nullptr);
+    held_reader.join();
+    TEST_ASSERT_FALSE_MESSAGE(returned_mid_write, "snapshot returned during a write");
+    // The write as a whole, never the state before it or half of it
+    TEST_ASSERT_EQUAL_MEMORY(&state_current(), &held_copy, sizeof(UiState));
+    TEST_ASSERT_NOT_EQUAL(before.doors_open, held_copy.doors_open);
+}
+
+// Device bits after `writes` flips from all off: one pass turns devices
+// 0..31 on in order, the next turns them off in the same order
+static uint32_t devices_after(uint32_t writes) {
+    uint32_t j = writes % STATE_MAX_DEVICES;
+    uint32_t low = j ? 0xFFFFFFFFUL >> (STATE_MAX_DEVICES - j) : 0;
+    return (writes / STATE_MAX_DEVICES) % 2 ? ~low : low;
+}
+
+// A torn copy either splits the device bits from the version bumps or
+// catches the store and device versions out of step
+static bool consistent(const UiState& s, const UiState& base) {
+    uint32_t writes = s.slice_version[SLICE_DEVICES] - base.slice_version[SLICE_DEVICES];
+    return s.version - base.version == writes && s.devices_on == devices_after(writes);
+}
+
+void test_snapshot_never_torn() {
+    for (int i = 0; i < STATE_MAX_DEVICES; i++) state_set_device(i, false);
+    const UiState base = state_current();
+    const uint32_t writes = 2000000;
+
+    std::atomic<bool> done(false);
+    uint32_t snapshots = 0, torn = 0, unguarded = 0, unguarded_torn = 0;
+    std::thread reader([&] {
+        UiState s;
+        while (!done.load(std::memory_order_relaxed)) {
+            state_snapshot(&s);
+            snapshots++;
+            if (!consistent(s, base)) torn++;
+            // The same copy without the sequence check, to show the race is real
+            memcpy(&s, (const void*)&state_current(), sizeof(s));
+            unguarded++;
+            if (!consistent(s, base)) unguarded_torn++;
+        }
+    });
+    for (uint32_t k = 0; k < writes; k++) {
+        int i = k % STATE_MAX_DEVICES;
+        state_set_device(i, !state_device_on(state_current(), i));
+    }
+    done = true;
+    reader.join();
+
+    char line[128];
+    snprintf(line, sizeof(line), "%lu snapshots, %lu torn; %lu unguarded copies, %lu torn",
+             (unsigned long)snapshots, (unsigned long)torn, (unsigned long)unguarded,
+             (unsigned long)unguarded_torn);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_GREATER_THAN(0, snapshots);
+    TEST_ASSERT_EQUAL_UINT32(writes, state_current().version - base.version);
+    TEST_ASSERT_EQUAL_UINT32(base.slice_version[SLICE_MENU], state_current().slice_version[SLICE_MENU]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_each_setter_bumps_its_slice);
+    RUN_TEST(test_unchanged_value_bumps_nothing);
+    RUN_TEST(test_out_of_range_index_ignored);
+    RUN_TEST(test_snapshot_matches_current);
+    RUN_TEST(test_snapshot_waits_out_a_write);
+    RUN_TEST(test_snapshot_never_torn);
+    return UNITY_END();
+}
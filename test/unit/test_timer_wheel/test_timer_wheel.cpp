@@ -0,0 +1,163 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "timer_wheel.h"
+
+// ======= Timer Wheel Tests =======
+// Correctness on virtual time, then a benchmark of arm, cancel and advance
+// at 100 to 100k armed timers. Per-operation cost should not grow with the
+// number armed; the benchmark prints the figures and fails only on growth
+// far beyond timing noise.
+
+static TimerWheel wheel;
+static unsigned long now_ms;
+
+struct Probe {
+    Timer timer;
+    unsigned long deadline_ms;
+    unsigned long fired_ms;  // 0 = not fired
+    bool cancelled;
+};
+
+static void record_fire(void* arg) {
+    Probe& p = *(Probe*)arg;
+    TEST_ASSERT_EQUAL_UINT32(0, p.fired_ms);
+    p.fired_ms = now_ms;
+}
+
+static void run_until(unsigned long end_ms, unsigned long step_ms) {
+    while (now_ms < end_ms) {
+        now_ms += step_ms;
+        wheel.advance(now_ms);
+    }
+}
+
+void setUp() {
+    now_ms = 1000;
+    wheel = TimerWheel();
+    wheel.begin(now_ms);
+    randomSeed(58);
+}
+
+void tearDown() {}
+
+void test_random_timers_fire_within_a_tick() {
+    const int n = 20000;
+    std::vector<Probe> probes(n);
+    for (int i = 0; i < n; i++) {
+        Probe& p = probes[i];
+        p = Probe();
+        unsigned long delay = random(TIMER_WHEEL_SPAN * TIMER_TICK_MS / 2);
+        p.deadline_ms = now_ms + delay;
+        wheel.arm(p.timer, delay, record_fire, &p);
+    }
+    for (int i = 0; i < n; i += 3) {
+        probes[i].cancelled = true;
+        wheel.cancel(probes[i].timer);
+    }
+    run_until(now_ms + TIMER_WHEEL_SPAN * TIMER_TICK_MS / 2 + 1000, 37);
+
+    for (int i = 0; i < n; i++) {
+        const Probe& p = probes[i];
+        if (p.cancelled) {
+            TEST_ASSERT_EQUAL_UINT32(0, p.fired_ms);
+            continue;
+        }
+        TEST_ASSERT_NOT_EQUAL(0, p.fired_ms);
+        TEST_ASSERT_GREATER_OR_EQUAL(p.deadline_ms, p.fired_ms + 37);  // advance() granularity
+        TEST_ASSERT_LESS_OR_EQUAL(p.deadline_ms + TIMER_TICK_MS + 37, p.fired_ms);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.armed_count());
+}
+
+void test_rearm_replaces_the_deadline() {
+    Probe p = Probe();
+    wheel.arm(p.timer, 5000, record_fire, &p);
+    run_until(now_ms + 3000, 100);
+    wheel.arm(p.timer, 5000, record_fire, &p);  // Pushed back, like a door that reports again
+    p.deadline_ms = now_ms + 5000;
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.armed_count());
+    run_until(p.deadline_ms - 200, 100);
+    TEST_ASSERT_EQUAL_UINT32(0, p.fired_ms);
+    run_until(p.deadline_ms + 200, 100);
+    TEST_ASSERT_NOT_EQUAL(0, p.fired_ms);
+}
+
+void test_millis_wraparound() {
+    now_ms = 0xFFFFFFFFUL - 250;
+    wheel = TimerWheel();
+    wheel.begin(now_ms);
+    Probe p = Probe();
+    wheel.arm(p.timer, 500, record_fire, &p);
+    for (int i = 0; i < 10; i++) {
+        now_ms += 100;  // Wraps
+        wheel.advance(now_ms);
+    }
+    TEST_ASSERT_NOT_EQUAL(0, p.fired_ms);
+}
+
+// ======= Benchmark =======
+
+static void no_op(void*) {}
+
+struct BenchResult {
+    double arm_ns;
+    double cancel_ns;
+    double tick_ns;  // advance() per 100 ms tick over six virtual hours
+};
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start, long ops) {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+static BenchResult bench(int n) {
+    std::vector<Timer> timers(n);
+    std::vector<unsigned long> delays(n);
+    for (int i = 0; i < n; i++) delays[i] = random(TIMER_WHEEL_SPAN * TIMER_TICK_MS);
+    BenchResult r;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) wheel.arm(timers[i], delays[i], no_op, nullptr);
+    r.arm_ns = elapsed_ns(start, n);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i += 2) wheel.cancel(timers[i]);
+    r.cancel_ns = elapsed_ns(start, n / 2);
+
+    const unsigned long six_hours = 6UL * 3600 * 1000;
+    start = std::chrono::steady_clock::now();
+    for (unsigned long t = 0; t < six_hours; t += TIMER_TICK_MS) {
+        now_ms += TIMER_TICK_MS;
+        wheel.advance(now_ms);
+    }
+    r.tick_ns = elapsed_ns(start, six_hours / TIMER_TICK_MS);
+
+    for (int i = 0; i < n; i++) wheel.cancel(timers[i]);
+    return r;
+}
+
+void test_benchmark_cost_is_flat() {
+    const int sizes[] = {100, 1000, 10000, 100000};
+    BenchResult results[4];
+    for (int i = 0; i < 4; i++) {
+        results[i] = bench(sizes[i]);
+        char line[128];
+        snprintf(line, sizeof(line), "n=%6d: arm %.1f ns, cancel %.1f ns, advance %.1f ns/tick incl. fired timers",
+                 sizes[i], results[i].arm_ns, results[i].cancel_ns, results[i].tick_ns);
+        TEST_MESSAGE(line);
+    }
+    // 1000x more timers; cache misses may cost a few times more per operation, not 1000x
+    TEST_ASSERT_LESS_THAN(results[0].arm_ns * 10 + 100, results[3].arm_ns);
+    TEST_ASSERT_LESS_THAN(results[0].cancel_ns * 10 + 100, results[3].cancel_ns);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_random_timers_fire_within_a_tick);
+    RUN_TEST(test_rearm_replaces_the_deadline);
+    RUN_TEST(test_millis_wraparound);
+    RUN_TEST(test_benchmark_cost_is_flat);
+    return UNITY_END();
+}
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Decode log chunks shipped by the panel on home/m5stack/core2/log/<mac>.
+
+Usage: log_unpack.py chunk.bin [...]
+       mosquitto_sub -C 1 -N -t 'home/m5stack/core2/log/<mac>' | log_unpack.py
+
+A chunk starts with 'T' (plain text) or 'Z' (LZSS: a flag byte precedes
+every 8 items, bit set = literal byte, bit clear = 2-byte match with a
+12-bit distance and 4-bit length - 3).
+"""
+import sys
+
+
+def lzss_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        flags = data[i]
+        i += 1
+        for bit in range(8):
+            if i >= len(data):
+                break
+            if flags & (1 << bit):
+                out.append(data[i])
+                i += 1
+            else:
+                code = (data[i] << 8) | data[i + 1]
+                i += 2
+                dist = (code >> 4) + 1
+                length = (code & 0x0F) + 3
+                for _ in range(length):
+                    out.append(out[-dist])
+    return bytes(out)
+
+
+def decode_chunk(chunk):
+    if chunk[:1] == b"Z":
+        return lzss_decode(chunk[1:])
+    if chunk[:1] == b"T":
+        return chunk[1:]
+    raise ValueError("unknown chunk format %r" % chunk[:1])
+
+
+def main():
+    if len(sys.argv) == 1:
+        sys.stdout.buffer.write(decode_chunk(sys.stdin.buffer.read()))
+        return
+    for path in sys.argv[1:]:
+        with open(path, "rb") as f:
+            sys.stdout.buffer.write(decode_chunk(f.read()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+"""Generate and apply binary deltas for delta OTA updates.
+
+Usage: ota_delta.py keygen signing.pem
+       ota_delta.py diff  old.bin new.bin out.delta --key signing.pem
+       ota_delta.py apply old.bin in.delta out.bin [--key signing.pem]
+
+keygen writes an ECDSA P-256 private key and prints the OTA_SIGNING_KEY
+define for credentials.h; keep the .pem off the panel. old.bin is the image
+running on the panel (.pio/build/<env>/firmware.bin of the deployed
+version). Serve out.delta over HTTP and publish its URL to
+home/m5stack/core2/ota; the panel checks the signature, patches the inactive
+OTA partition in a streaming fashion and boots it only if the SHA-256
+matches. Signing and verification use the openssl command line tool.
+
+Format (little endian):
+    "M5D2" | u32 old_size | u32 new_size | sha256(old) | sha256(new)
+        | u8 sig_len | sig (72 bytes, zero padded) | LZSS(ops)
+    0x00                          END
+    0x01 old_off len  <diff>      ADD: new = old[old_off:old_off+len] + diff
+    0x02 len <bytes>              INSERT literal bytes
+sig is the DER ECDSA signature over the first 76 bytes, made with SHA-256.
+Integers are LEB128 varints. <diff> is a sequence of (zero_run, count,
+count bytes) covering len bytes; diff bytes are added modulo 256, in the
+spirit of bsdiff, so code that only moved stays cheap. The op stream is
+LZSS-compressed with the same format as shipped logs (see log_unpack.py), so
+the panel decodes it with a 4 KB window.
+"""
+import hashlib
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from log_unpack import lzss_decode  # noqa: E402
+
+MAGIC = b"M5D2"
+SIGNED_SIZE = 76  # magic, sizes and both hashes
+SIG_MAX = 72      # DER ECDSA P-256 signature
+HEADER_SIZE = SIGNED_SIZE + 1 + SIG_MAX
+OP_END, OP_ADD, OP_INSERT = 0, 1, 2
+SEED = 8        # bytes hashed to find candidate matches
+MIN_MATCH = 24  # shorter approximate matches are sent as literals
+DIVERGE = 64    # stop extending once the score drops this far below its best
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def lzss_encode(data, window=4096, max_len=18, min_len=3, chain=16):
+    """Greedy LZSS matching the firmware decoder: flag byte per 8 items,
+    bit set = literal, bit clear = 12-bit distance / 4-bit length match."""
+    out = bytearray()
+    chains = {}
+    i, n = 0, len(data)
+
+    def remember(pos):
+        if pos + min_len <= n:
+            chains.setdefault(data[pos:pos + min_len], []).append(pos)
+
+    while i < n:
+        flag_pos = len(out)
+        out.append(0)
+        for bit in range(8):
+            if i >= n:
+                break
+            best_len = best_dist = 0
+            for cand in reversed(chains.get(data[i:i + min_len], [])[-chain:]):
+                if i - cand > window:
+                    break
+                length = 0
+                while length < max_len and i + length < n and data[cand + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, i - cand
+                    if length == max_len:
+                        break
+            if best_len >= min_len:
+                code = ((best_dist - 1) << 4) | (best_len - min_len)
+                out += bytes([code >> 8, code & 0xFF])
+                for k in range(best_len):
+                    remember(i + k)
+                i += best_len
+            else:
+                out[flag_pos] |= 1 << bit
+                remember(i)
+                out.append(data[i])
+                i += 1
+    return bytes(out)
+
+
+def read_varint(data, pos):
+    n = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        n |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return n, pos
+
+
+def extend(old, new, i, j):
+    """Length of the approximate match new[i:] ~ old[j:] maximizing 2*matches - length."""
+    best = best_len = score = 0
+    k = 0
+    limit = min(len(new) - i, len(old) - j)
+    while k < limit:
+        score += 1 if new[i + k] == old[j + k] else -1
+        k += 1
+        if score > best:
+            best, best_len = score, k
+        elif score < best - DIVERGE:
+            break
+    return best_len
+
+
+def encode_diff(old, new, i, j, length):
+    out = bytearray()
+    k = 0
+    while k < length:
+        run = 0
+        while k + run < length and new[i + k + run] == old[j + k + run]:
+            run += 1
+        k += run
+        lits = bytearray()
+        while k < length and new[i + k] != old[j + k]:
+            lits.append((new[i + k] - old[j + k]) & 0xFF)
+            k += 1
+        out += varint(run) + varint(len(lits)) + lits
+    return bytes(out)
+
+
+def openssl(*args, data=None):
+    return subprocess.run(("openssl",) + args, input=data, stdout=subprocess.PIPE,
+                          check=True).stdout
+
+
+def keygen(key_path):
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", key_path)
+    os.chmod(key_path, 0o600)
+    public = openssl("ec", "-in", key_path, "-pubout").decode()
+    lines = public.strip().splitlines()
+    print("#define OTA_SIGNING_KEY \\")
+    for line in lines[:-1]:
+        print('    "%s\\n" \\' % line)
+    print('    "%s\\n"' % lines[-1])
+
+
+def sign(key_path, signed):
+    sig = openssl("dgst", "-sha256", "-sign", key_path, data=signed)
+    if len(sig) > SIG_MAX:
+        raise ValueError("%s is not a P-256 key" % key_path)
+    return bytes([len(sig)]) + sig.ljust(SIG_MAX, b"\0")
+
+
+def verify(key_path, header):
+    sig_len = header[SIGNED_SIZE]
+    with tempfile.NamedTemporaryFile() as sig:
+        sig.write(header[SIGNED_SIZE + 1:SIGNED_SIZE + 1 + sig_len])
+        sig.flush()
+        try:
+            openssl("dgst", "-sha256", "-prverify", key_path, "-signature", sig.name,
+                    data=header[:SIGNED_SIZE])
+        except subprocess.CalledProcessError:
+            raise ValueError("signature does not verify with %s" % key_path)
+
+
+def diff(old, new, key_path):
+    index = {}
+    for j in range(len(old) - SEED, -1, -1):
+        index[old[j:j + SEED]] = j  # keeps the first occurrence
+
+    ops = bytearray()
+    literal = bytearray()
+    shift = 0  # old offset minus new offset of the previous match
+    i = 0
+
+    def flush_literal():
+        if literal:
+            ops.extend(bytes([OP_INSERT]) + varint(len(literal)) + literal)
+            literal.clear()
+
+    while i < len(new):
+        best_j, best_len = -1, 0
+        predicted = i + shift
+        if 0 <= predicted < len(old):
+            best_j, best_len = predicted, extend(old, new, i, predicted)
+        if best_len < MIN_MATCH:
+            j = index.get(new[i:i + SEED], -1)
+            if j >= 0:
+                length = extend(old, new, i, j)
+                if length > best_len:
+                    best_j, best_len = j, length
+        if best_len >= MIN_MATCH:
+            flush_literal()
+            ops.extend(bytes([OP_ADD]) + varint(best_j) + varint(best_len))
+            ops.extend(encode_diff(old, new, i, best_j, best_len))
+            shift = best_j - i
+            i += best_len
+        else:
+            literal.append(new[i])
+            i += 1
+    flush_literal()
+    ops.append(OP_END)
+
+    header = MAGIC + struct.pack("<II", len(old), len(new))
+    header += hashlib.sha256(old).digest() + hashlib.sha256(new).digest()
+    return header + sign(key_path, header) + lzss_encode(bytes(ops))
+
+
+def apply(old, delta, key_path=None):
+    if delta[:4] != MAGIC:
+        raise ValueError("not an M5D2 delta")
+    if key_path:
+        verify(key_path, delta[:HEADER_SIZE])
+    old_size, new_size = struct.unpack_from("<II", delta, 4)
+    old_hash, new_hash = delta[12:44], delta[44:76]
+    if old_size != len(old) or hashlib.sha256(old).digest() != old_hash:
+        raise ValueError("delta was made against a different base image")
+    delta = lzss_decode(delta[HEADER_SIZE:])
+    out = bytearray()
+    pos = 0
+    while True:
+        op = delta[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_INSERT:
+            length, pos = read_varint(delta, pos)
+            out += delta[pos:pos + length]
+            pos += length
+        elif op == OP_ADD:
+            j, pos = read_varint(delta, pos)
+            length, pos = read_varint(delta, pos)
+            k = 0
+            while k < length:
+                run, pos = read_varint(delta, pos)
+                out += old[j + k:j + k + run]
+                k += run
+                count, pos = read_varint(delta, pos)
+                for n in range(count):
+                    out.append((old[j + k + n] + delta[pos + n]) & 0xFF)
+                pos += count
+                k += count
+        else:
+            raise ValueError("bad op 0x%02x at %d" % (op, pos - 1))
+    if len(out) != new_size or hashlib.sha256(out).digest() != new_hash:
+        raise ValueError("patched image failed verification")
+    return bytes(out)
+
+
+def main():
+    args = sys.argv[1:]
+    key_path = None
+    if "--key" in args:
+        k = args.index("--key")
+        key_path = args[k + 1] if k + 1 < len(args) else None
+        del args[k:k + 2]
+    if args[:1] == ["keygen"] and len(args) == 2:
+        keygen(args[1])
+        return
+    if len(args) != 4 or args[0] not in ("diff", "apply") or (args[0] == "diff" and not key_path):
+        sys.exit(__doc__)
+    with open(args[1], "rb") as f:
+        old = f.read()
+    with open(args[2], "rb") as f:
+        second = f.read()
+    if args[0] == "diff":
+        delta = diff(old, second, key_path)
+        apply(old, delta, key_path)  # round-trip before writing
+        with open(args[3], "wb") as f:
+            f.write(delta)
+        print("full image %d bytes, delta %d bytes (%.1f%% of full)" %
+              (len(second), len(delta), 100.0 * len(delta) / len(second)))
+    else:
+        with open(args[3], "wb") as f:
+            f.write(apply(old, second, key_path))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,467 @@
+#!/usr/bin/env python3
+"""Simulate many panels against an MQTT broker for capacity testing.
+
+Usage: panel_load.py [--broker host:port] [--panels 10,50,200]
+                     [--profile typical] [--duration 60] [--user U --password P]
+
+Each simulated panel speaks plain MQTT 3.1.1 over its own TCP connection and
+behaves like the firmware:
+  - subscriptions follow subscriptions.cpp: the always-on set (door sensors,
+    OTA, the panel's RTT loopback, telemetry feeds) packed into as few
+    SUBSCRIBE packets as fit in SUBS_PACKET_SIZE, and the device state
+    topics subscribed and unsubscribed the same way while the Devices screen
+    is up, which is where toggles happen
+  - device commands like toggle_device(), apply_scene() and
+    power_off_all_devices(), at QoS 1 as mqtt_send() sends them
+  - an RTT probe on the loopback topic every LINK_PROBE_INTERVAL
+  - metrics, heap and log telemetry in the firmware's payload formats
+Topics, devices and scenes are read from src/main.cpp so the load follows
+the firmware. One extra client per door sensor plays the sensor and
+publishes OPEN/CLOSED at the profile's rate, and one per device answers
+commands with a retained state like a real device.
+
+For every panel count the tool reports:
+    rtt      RTT probe publish -> echo from the broker, as link_monitor sees it
+    ingest   sensor publish -> arrival at each panel (fan-out lag)
+    lost     sensor messages that never reached a panel, in percent
+    out/s    publishes per second sent by all panels
+    in/s     messages per second delivered to all panels
+    gen_lag  event-loop lag of this tool; if it grows, the generator is the
+             bottleneck, so split the panels over several processes
+Latencies are p50/p99/max in milliseconds.
+"""
+import argparse
+import asyncio
+import os
+import random
+import re
+import struct
+import time
+
+# Per-panel mean seconds between actions, None = never. Sensor rates are per
+# door sensor, shared by all panels.
+PROFILES = {
+    "idle":    {"toggle": None, "scene": None, "all_off": None, "sensor": 60.0},
+    "typical": {"toggle": 60.0, "scene": 300.0, "all_off": 900.0, "sensor": 30.0},
+    "busy":    {"toggle": 5.0, "scene": 20.0, "all_off": 120.0, "sensor": 2.0},
+    "storm":   {"toggle": 1.0, "scene": 5.0, "all_off": 10.0, "sensor": 0.5},
+}
+METRICS_INTERVAL = 10.0  # METRICS_INTERVAL_MS
+HEAP_INTERVAL = 60.0     # HEAP_SAMPLE_INTERVAL
+LOG_INTERVAL = 30.0      # LOG_SHIP_FLUSH_MS
+PROBE_INTERVAL = 5.0     # LINK_PROBE_INTERVAL
+DEVICES_DWELL = 10.0     # Mean seconds the Devices screen stays up after a toggle
+KEEPALIVE = 15           # MqttSession default keepalive
+SUBS_PACKET_SIZE = 512   # subscriptions.h
+
+
+# ======= Firmware Tables =======
+def load_panel_config(path):
+    """Pull topics, door sensors, devices and scenes out of main.cpp."""
+    with open(path) as f:
+        src = f.read()
+
+    def block(name):
+        m = re.search(r"\b%s\[\]\s*=\s*\{(.*?)\n\};" % name, src, re.S)
+        if not m:
+            raise ValueError("%s[] not found in %s" % (name, path))
+        return m.group(1)
+
+    topics = dict(re.findall(r'const char\* (\w+_topic) = "([^"]+)"', src))
+    # Per-panel topics are "<prefix><mac>", filled in by setup()
+    panel_topics = dict(re.findall(r'snprintf\((\w+_topic), sizeof\(\1\), "([^"%]+)%s"', src))
+    sensors = re.findall(r'\{"[^"]+",\s*"([^"]+)"', block("door_sensors"))
+    devices = re.findall(r'\{"[^"]+",\s*"([^"]+)",\s*"([^"]+)"', block("devices"))
+    feeds = re.findall(r'^\s*"([^"]+)"', block("telemetry_subscriptions"), re.M)
+    scenes = [(name, targets or None) for name, targets in
+              re.findall(r'\{"([^"]+)",\s*(?:"([^"]*)"|nullptr)\}', block("scenes"))]
+    return {"topics": topics, "panel_topics": panel_topics, "sensors": sensors, "devices": devices,
+            "feeds": feeds, "scenes": scenes}
+
+
+# ======= MQTT 3.1.1 =======
+def encode_length(n):
+    out = bytearray()
+    while True:
+        byte, n = n % 128, n // 128
+        out.append(byte | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def mqtt_string(s):
+    data = s.encode() if isinstance(s, str) else s
+    return struct.pack(">H", len(data)) + data
+
+
+def packet(first_byte, body):
+    return bytes([first_byte]) + encode_length(len(body)) + body
+
+
+def connect_packet(client_id, user, password):
+    flags = 0x02  # clean session
+    payload = mqtt_string(client_id)
+    if user:
+        flags |= 0x80
+        payload += mqtt_string(user)
+        if password:
+            flags |= 0x40
+            payload += mqtt_string(password)
+    return packet(0x10, mqtt_string("MQTT") + bytes([4, flags]) + struct.pack(">H", KEEPALIVE) + payload)
+
+
+def publish_packet(topic, payload, retain=False, packet_id=0):
+    """QoS 1 when given a packet id, else QoS 0."""
+    if packet_id:
+        return packet(0x32 | (1 if retain else 0), mqtt_string(topic) + struct.pack(">H", packet_id) + payload)
+    return packet(0x30 | (1 if retain else 0), mqtt_string(topic) + payload)
+
+
+def batched_packets(first_byte, next_id, topics, with_qos):
+    """SUBSCRIBE or UNSUBSCRIBE packets filled up to SUBS_PACKET_SIZE, like
+    send_batched() in subscriptions.cpp."""
+    out = []
+    body = b""
+    for topic in topics:
+        entry = mqtt_string(topic) + (b"\x00" if with_qos else b"")
+        if body and len(packet(first_byte, struct.pack(">H", 0) + body + entry)) > SUBS_PACKET_SIZE:
+            out.append(packet(first_byte, struct.pack(">H", next_id()) + body))
+            body = b""
+        body += entry
+    if body:
+        out.append(packet(first_byte, struct.pack(">H", next_id()) + body))
+    return out
+
+
+async def read_packet(reader):
+    header = (await reader.readexactly(1))[0]
+    length, shift = 0, 0
+    while True:
+        byte = (await reader.readexactly(1))[0]
+        length |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    return header, await reader.readexactly(length)
+
+
+async def mqtt_connect(host, port, client_id, user, password):
+    reader, writer = await asyncio.open_connection(host, port)
+    writer.write(connect_packet(client_id, user, password))
+    header, body = await read_packet(reader)
+    if header >> 4 != 2 or body[1] != 0:
+        raise ConnectionError("%s: CONNACK rc=%d" % (client_id, body[1] if len(body) > 1 else -1))
+    return reader, writer
+
+
+# ======= Statistics =======
+class Stats:
+    def __init__(self):
+        self.rtt_ms = []
+        self.ingest_ms = []
+        self.gen_lag_ms = []
+        self.published = 0
+        self.received = 0
+        self.sensor_sent = 0
+        self.sensor_received = 0
+        self.window = (float("inf"), float("inf"))  # Sensor send times that count
+        self.errors = 0
+
+
+def summary(samples):
+    if not samples:
+        return "-"
+    s = sorted(samples)
+    return "%.1f/%.1f/%.1f" % (s[len(s) // 2], s[min(len(s) - 1, len(s) * 99 // 100)], s[-1])
+
+
+def next_delay(mean):
+    return random.expovariate(1.0 / mean)
+
+
+# ======= Sensors =======
+class Sensor:
+    """Plays one door sensor. Payloads carry a sequence number after the
+    state so panels can look up the send time even if messages are dropped."""
+
+    def __init__(self, index, topic):
+        self.client_id = "load-sensor-%d" % index
+        self.topic = topic
+        self.sent_at = []
+
+    async def run(self, args, stats, stop, measure):
+        mean = PROFILES[args.profile]["sensor"]
+        _, writer = await mqtt_connect(args.host, args.port, self.client_id, args.user, args.password)
+        is_open = False
+        while not stop.is_set():
+            await asyncio.sleep(next_delay(mean))
+            is_open = not is_open
+            seq = len(self.sent_at)
+            now = time.monotonic()
+            self.sent_at.append(now)
+            if stats.window[0] <= now < stats.window[1]:
+                stats.sensor_sent += 1
+            writer.write(publish_packet(self.topic, b"%s %d" % (b"OPEN" if is_open else b"CLOSED", seq)))
+        writer.close()
+
+
+# ======= Devices =======
+class Device:
+    """Plays one device: answers each command on its control topic with a
+    retained ON/OFF on its state topic, which panels on the Devices screen
+    follow."""
+
+    def __init__(self, index, control_topic, state_topic):
+        self.client_id = "load-device-%d" % index
+        self.control_topic = control_topic
+        self.state_topic = state_topic
+
+    async def run(self, args, stats, stop, measure):
+        reader, writer = await mqtt_connect(args.host, args.port, self.client_id, args.user, args.password)
+        writer.write(batched_packets(0x82, lambda: 1, [self.control_topic], True)[0])
+        writer.write(publish_packet(self.state_topic, b"OFF", retain=True))
+        while not stop.is_set():
+            header, body = await read_packet(reader)
+            if header >> 4 != 3:
+                continue
+            topic_len = struct.unpack(">H", body[:2])[0]
+            writer.write(publish_packet(self.state_topic, body[2 + topic_len:], retain=True))
+        writer.close()
+
+
+# ======= Panels =======
+class Panel:
+    def __init__(self, index, config, sensors):
+        mac = "02%010x" % index  # Locally administered, like a real MAC in setup()
+        self.client_id = "M5Core2-" + mac
+        self.config = config
+        self.topics = dict(config["topics"])
+        self.topics.update({name: prefix + mac for name, prefix in config["panel_topics"].items()})
+        self.sensors = {s.topic: s for s in sensors}
+        self.active = [False] * len(config["devices"])
+        self.packet_id = 0
+        self.probe_seq = 0
+        self.probe_sent = {}
+        self.on_devices_screen = False
+
+    def next_packet_id(self):
+        self.packet_id = self.packet_id % 65535 + 1
+        return self.packet_id
+
+    def always_topics(self):
+        """SUB_ALWAYS topics in the order setup() registers them."""
+        return (self.config["sensors"] + [self.topics["ota_topic"], self.topics["rtt_topic"]] +
+                self.config["feeds"])
+
+    def state_topics(self):
+        return [state for _, state in self.config["devices"]]
+
+    def set_devices_screen(self, up):
+        """Packets subs_set_screen() sends when the Devices screen comes or goes."""
+        if up == self.on_devices_screen:
+            return []
+        self.on_devices_screen = up
+        return batched_packets(0xA2 if not up else 0x82, self.next_packet_id, self.state_topics(), up)
+
+    def command(self, topic, payload):
+        return publish_packet(topic, payload, packet_id=self.next_packet_id())
+
+    def set_device(self, i, on):
+        if self.active[i] == on:
+            return []
+        self.active[i] = on
+        return [self.command(self.config["devices"][i][0], b"ON" if on else b"OFF")]
+
+    def toggle_device(self):
+        i = random.randrange(len(self.active))
+        return self.set_devices_screen(True) + self.set_device(i, not self.active[i])
+
+    def apply_scene(self):
+        name, targets = random.choice(self.config["scenes"])
+        if targets is None:
+            return [self.command(self.topics["scenes_control_topic"], name.encode())]
+        out = []
+        for i, target in enumerate(targets[:len(self.active)]):
+            if target != "-":
+                out += self.set_device(i, target == "1")
+        return out
+
+    def power_off_all(self):
+        out = []
+        for i in range(len(self.active)):
+            out += self.set_device(i, False)
+        return out
+
+    def probe(self):
+        """Loopback publish like monitor_link(): "<seq> <micros>" at QoS 0."""
+        self.probe_seq += 1
+        now = time.monotonic()
+        self.probe_sent[self.probe_seq] = now
+        payload = b"%d %d" % (self.probe_seq, int(now * 1e6) & 0xFFFFFFFF)
+        return [publish_packet(self.topics["rtt_topic"], payload)]
+
+    def telemetry(self, kind):
+        """Payloads as metrics_format() and heap_monitor_format() write them."""
+        topics = self.topics
+        if kind == "metrics":
+            return [publish_packet(topics["metrics_topic"],
+                                   b'{"loop_hz":%d,"loop_p99_us":%d,"in_ps":%d,"out_ps":%d,"redraws":%d,'
+                                   b'"reconnects":0,"rssi":-60,"heap":180000,"uptime":%d}' %
+                                   (random.randint(100, 500), random.randint(200, 20000), random.randint(0, 50),
+                                    random.randint(0, 50), random.randint(0, 10), int(time.monotonic())))]
+        if kind == "heap":
+            return [publish_packet(topics["heap_status_topic"],
+                                   b'{"free":180000,"largest":110000,"min_free":170000,"frag":12}',
+                                   retain=True)]
+        return [publish_packet(topics["log_topic"], b"Z" + os.urandom(400))]
+
+    async def reader_task(self, reader, stats):
+        rtt_topic = self.topics["rtt_topic"]
+        while True:
+            header, body = await read_packet(reader)
+            if header >> 4 != 3:  # PUBACK, SUBACK and UNSUBACK need no answer
+                continue
+            now = time.monotonic()
+            topic_len = struct.unpack(">H", body[:2])[0]
+            topic = body[2:2 + topic_len].decode()
+            payload = body[2 + topic_len:]  # Delivered at QoS 0, no packet id
+            stats.received += 1
+            if topic == rtt_topic:
+                sent_at = self.probe_sent.pop(int(payload.split()[0]), None)
+                if sent_at is not None and stats.window[0] <= sent_at < stats.window[1]:
+                    stats.rtt_ms.append((now - sent_at) * 1000.0)
+                continue
+            sensor = self.sensors.get(topic)
+            if sensor is not None:
+                sent_at = sensor.sent_at[int(payload.split()[-1])]
+                if stats.window[0] <= sent_at < stats.window[1]:
+                    stats.sensor_received += 1
+                    stats.ingest_ms.append((now - sent_at) * 1000.0)
+
+    async def run(self, args, stats, stop, measure):
+        reader, writer = await mqtt_connect(args.host, args.port, self.client_id, args.user, args.password)
+        # Same packets as subs_connected() with the screen asleep
+        for p in batched_packets(0x82, self.next_packet_id, self.always_topics(), True):
+            writer.write(p)
+        reading = asyncio.ensure_future(self.reader_task(reader, stats))
+
+        profile = PROFILES[args.profile]
+        now = time.monotonic()
+        due = {}
+        for action in ("toggle", "scene", "all_off"):
+            if profile[action]:
+                due[action] = now + next_delay(profile[action])
+        intervals = {"metrics": METRICS_INTERVAL, "heap": HEAP_INTERVAL, "log": LOG_INTERVAL, "probe": PROBE_INTERVAL}
+        for kind, interval in intervals.items():
+            due[kind] = now + random.uniform(0, interval)
+
+        try:
+            while not stop.is_set() and not reading.done():
+                action = min(due, key=due.get)
+                await asyncio.sleep(max(0.0, due[action] - time.monotonic()))
+                if action == "toggle":
+                    msgs = self.toggle_device()
+                    due["leave"] = time.monotonic() + next_delay(DEVICES_DWELL)
+                elif action == "leave":
+                    msgs = self.set_devices_screen(False)
+                    del due["leave"]
+                elif action == "scene":
+                    msgs = self.apply_scene()
+                elif action == "all_off":
+                    msgs = self.power_off_all()
+                elif action == "probe":
+                    msgs = self.probe()
+                else:
+                    msgs = self.telemetry(action)
+                for p in msgs:
+                    writer.write(p)
+                if measure.is_set():
+                    stats.published += sum(1 for p in msgs if p[0] >> 4 == 3)
+                if action in intervals:
+                    due[action] += intervals[action]
+                elif action != "leave":
+                    due[action] = time.monotonic() + next_delay(profile[action])
+                await writer.drain()
+        except (ConnectionError, asyncio.IncompleteReadError):
+            stats.errors += 1
+        if reading.done() and reading.exception() is not None:
+            stats.errors += 1
+        reading.cancel()
+        writer.close()
+
+
+# ======= Runner =======
+async def monitor_lag(stats, stop, measure):
+    while not stop.is_set():
+        start = time.monotonic()
+        await asyncio.sleep(0.05)
+        if measure.is_set():
+            stats.gen_lag_ms.append((time.monotonic() - start - 0.05) * 1000.0)
+
+
+async def run_step(args, config, num_panels):
+    stats = Stats()
+    stop, measure = asyncio.Event(), asyncio.Event()
+    sensors = [Sensor(i, topic) for i, topic in enumerate(config["sensors"])]
+    devices = [Device(i, control, state) for i, (control, state) in enumerate(config["devices"])]
+    panels = [Panel(i, config, sensors) for i in range(num_panels)]
+
+    # Connect panels in batches so the ramp does not itself look like a storm
+    tasks = [asyncio.ensure_future(d.run(args, stats, stop, measure)) for d in devices]
+    for i, panel in enumerate(panels):
+        tasks.append(asyncio.ensure_future(panel.run(args, stats, stop, measure)))
+        if i % 20 == 19:
+            await asyncio.sleep(0.05)
+    await asyncio.sleep(1.0)
+    tasks += [asyncio.ensure_future(s.run(args, stats, stop, measure)) for s in sensors]
+    tasks.append(asyncio.ensure_future(monitor_lag(stats, stop, measure)))
+
+    await asyncio.sleep(args.warmup)
+    received_before = stats.received
+    measure.set()
+    start = time.monotonic()
+    stats.window = (start, start + args.duration)
+    await asyncio.sleep(args.duration)
+    elapsed = time.monotonic() - start
+    received = stats.received - received_before
+    measure.clear()
+    await asyncio.sleep(1.0)  # Let in-flight sensor messages arrive
+    stop.set()
+    await asyncio.sleep(0.2)
+    for task in tasks:
+        task.cancel()
+    await asyncio.gather(*tasks, return_exceptions=True)
+
+    expected = stats.sensor_sent * num_panels
+    lost = 100.0 * max(0, expected - stats.sensor_received) / expected if expected else 0.0
+    print("%6d %17s %17s %6.1f %9.0f %9.0f %17s %6d" % (
+        num_panels, summary(stats.rtt_ms), summary(stats.ingest_ms), lost,
+        stats.published / elapsed, received / elapsed, summary(stats.gen_lag_ms), stats.errors), flush=True)
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--broker", default="127.0.0.1:1883", help="host:port")
+    parser.add_argument("--panels", default="10,50,100,200", help="comma-separated panel counts")
+    parser.add_argument("--profile", default="typical", choices=sorted(PROFILES))
+    parser.add_argument("--duration", type=float, default=60.0, help="measured seconds per step")
+    parser.add_argument("--warmup", type=float, default=5.0, help="seconds before measuring")
+    parser.add_argument("--user", default="")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--source", default=os.path.join(root, "src", "main.cpp"))
+    args = parser.parse_args()
+    args.host, _, port = args.broker.rpartition(":")
+    args.port = int(port)
+
+    config = load_panel_config(args.source)
+    print("profile %s, %d devices, %d scenes, %d door sensors, %.0f s per step" % (
+        args.profile, len(config["devices"]), len(config["scenes"]), len(config["sensors"]), args.duration))
+    print("%6s %17s %17s %6s %9s %9s %17s %6s" % (
+        "panels", "rtt ms", "ingest ms", "lost%", "out/s", "in/s", "gen_lag ms", "errors"))
+    for n in [int(x) for x in args.panels.split(",")]:
+        asyncio.run(run_step(args, config, n))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Convert a trace dump captured from the panel's Serial output into
+Chrome/Perfetto trace JSON.
+
+Usage: trace_to_chrome.py serial.log > trace.json
+
+Send 't' over Serial to make the firmware print a dump. Timestamps are
+32-bit CPU cycle counts; consecutive events are assumed to be less than one
+counter wrap apart (about 17 s at 240 MHz).
+"""
+import json
+import sys
+
+
+def parse(lines):
+    events = []
+    freq_mhz = None
+    last = None
+    offset = 0
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            fields = dict(f.split("=", 1) for f in line.split()[2:])
+            freq_mhz = float(fields["freq_mhz"])
+            last, offset = None, 0
+            continue
+        if freq_mhz is None:
+            continue
+        if line == "TRACE END":
+            freq_mhz = None
+            continue
+        parts = line.split()
+        if len(parts) != 4:
+            continue
+        cycles, phase, core, name = int(parts[0]), parts[1], int(parts[2]), parts[3]
+        if last is not None and cycles < last:
+            offset += 1 << 32
+        last = cycles
+        events.append({
+            "name": name,
+            "ph": phase,
+            "ts": (cycles + offset) / freq_mhz,
+            "pid": 1,
+            "tid": core,
+        })
+    if events:
+        base = events[0]["ts"]
+        for ev in events:
+            ev["ts"] = round(ev["ts"] - base, 3)
+    return events
+
+
+def main():
+    src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    with src:
+        events = parse(src)
+    json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()